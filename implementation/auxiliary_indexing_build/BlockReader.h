@@ -0,0 +1,20 @@
+// BlockReader.h
+#ifndef BLOCKREADER_H
+#define BLOCKREADER_H
+
+#include <cstddef>
+
+// Sequential source of CSV bytes, handed out one block at a time
+class BlockReader {
+public:
+    virtual ~BlockReader() = default;
+
+    // Copy the next block (at most blockSize() bytes) into dest; returns the
+    // number of bytes copied, 0 at the end of the input or after an error
+    virtual size_t read(char* dest) = 0;
+    virtual size_t blockSize() const = 0;
+    // Whether the input ended on an error (already logged) rather than at its end
+    virtual bool failed() const = 0;
+};
+
+#endif // BLOCKREADER_H
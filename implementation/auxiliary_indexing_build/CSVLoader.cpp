@@ -1,43 +1,53 @@
 // CSVLoader.cpp
 #include "CSVLoader.h"
+#include "ColumnCache.h"
+#include "RowOffsetIndex.h"
+#include "SchemaInference.h"
+#include "TableFiles.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
-#include <sstream>
 #include <iostream>
 #include <filesystem>
+#include <limits>
 
 namespace fs = std::filesystem;
+#include <limits>
 
-CSVLoader::CSVLoader(const std::string& filename) : filename_(filename) {}
+// Rows per batch of the schema sample when it reads every record
+static const size_t FULL_SAMPLE_BATCH_ROWS = 1 << 16;
+
+CSVLoader::CSVLoader(const std::string& filename, const CSVLoadOptions& options)
+    : CSVLoader(filename, options, std::make_shared<MemoryBudget>(options.memory_budget, options.spill_directory),
+                nullptr) {
+    owns_budget_ = true;
+}
+
+CSVLoader::CSVLoader(const std::string& filename, const CSVLoadOptions& options, std::shared_ptr<MemoryBudget> budget,
+                     const TableSchema* schema)
+    : filename_(filename), options_(options), budget_(std::move(budget)), owns_budget_(false),
+      table_(budget_.get()), table_schema_(schema != nullptr), schema_final_(false), data_materialized_(false),
+      data_bytes_(0) {
+    if (schema != nullptr) {
+        schema_ = *schema;
+    }
+}
 
 bool CSVLoader::createIndex(const std::string& column) {
-    if (std::find(headers_.begin(), headers_.end(), column) == headers_.end()) {
+    // Before load() the headers are unknown; the column is validated and the
+    // key type chosen from the inferred schema once the file has been parsed
+    if (!headers_.empty() && std::find(headers_.begin(), headers_.end(), column) == headers_.end()) {
         std::cerr << "Column '" << column << "' does not exist in CSV." << std::endl;
         return false;
     }
-
-    // Determine key type based on column data
-    // For simplicity, assume string type. Implement dynamic type detection as needed
-    KeyType key_type = KeyType::STRING; // Change based on your requirements
-    std::string index_filename = column + ".btree";
-
-    // Check if index file already exists
-    if (fs::exists(index_filename)) {
-        // Load existing index
-        auto btree = std::make_shared<BTree>(index_filename, key_type);
-        if (!btree->load()) {
-            std::cerr << "Failed to load existing B-tree index: " << index_filename << std::endl;
-            return false;
-        }
-        indexes_[column] = btree;
-        std::cout << "Loaded existing B-tree index for column: " << column << std::endl;
-    } else {
-        // Create a new B-tree index
-        auto btree = std::make_shared<BTree>(index_filename, key_type);
-        btree->initialize(); // Initialize B-tree (create root node, etc.)
-        indexes_[column] = btree;
-        std::cout << "Initialized new B-tree index for column: " << column << std::endl;
+    if (std::find(index_columns_.begin(), index_columns_.end(), column) == index_columns_.end()) {
+        index_columns_.push_back(column);
+    }
+    if (table_.numColumns() > 0) {
+        buildIndexes();
     }
-
     return true;
 }
 
@@ -49,65 +59,1452 @@ std::shared_ptr<BTree> CSVLoader::getIndex(const std::string& column) const {
     return nullptr;
 }
 
+// Choose the B-tree key type matching a column's inferred type
+static KeyType keyTypeFor(const Column& column) {
+    switch (column.getType()) {
+        case ColumnType::INT64:
+            // KeyValue holds int; wider integer columns are keyed as double
+            for (size_t row = 0; row < column.size(); ++row) {
+                int64_t value = column.getInt(row);
+                if (!column.isMissing(row) &&
+                    (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())) {
+                    return KeyType::DOUBLE;
+                }
+            }
+            return KeyType::INTEGER;
+        case ColumnType::DOUBLE:
+            return KeyType::DOUBLE;
+        default:
+            return KeyType::STRING;
+    }
+}
+
+// Convert a cell to a key of the given type
+static KeyValue keyFor(const Column& column, size_t row, KeyType key_type) {
+    switch (key_type) {
+        case KeyType::INTEGER:
+            return static_cast<int>(column.getInt(row));
+        case KeyType::DOUBLE:
+            return column.getType() == ColumnType::INT64 ? static_cast<double>(column.getInt(row))
+                                                         : column.getDouble(row);
+        default:
+            return column.toString(row);
+    }
+}
+
+CSVLoader::~CSVLoader() {
+    // The budget may be shared with the other files of a table
+    clearData();
+}
+
+void CSVLoader::reset() {
+    table_.clear();
+    headers_.clear();
+    field_columns_.clear();
+    field_predicates_.clear();
+    partition_keys_.clear();
+    partition_columns_.clear();
+    mapping_.reset();
+    batch_.reset();
+    tail_.reset();
+    if (!table_schema_) {
+        schema_.clear();
+        schema_final_ = false;
+    }
+    clearData();
+    stats_ = CSVLoadStats();
+    if (owns_budget_) {
+        budget_->resetPeak();
+    }
+}
+
+bool CSVLoader::sampleSchema(const TableSchema& partition_types) {
+    if (table_schema_) {
+        return true;
+    }
+    schema_.clear();
+    schema_final_ = false;
+    if (!options_.infer_schema) {
+        return true;
+    }
+    // Read the leading records as text: every column, no predicates, and on
+    // from one file to the next like batches
+    CSVLoadOptions sample_options;
+    sample_options.infer_schema = false;
+    sample_options.dictionary_max_entries = 0;
+    sample_options.read_ahead_blocks = 0;
+    sample_options.decompression_threads = 1;
+    CSVLoader sampler(filename_, sample_options);
+    const size_t sample_rows = options_.schema_sample_rows;
+    if (!sampler.openBatches(sample_rows > 0 ? sample_rows : FULL_SAMPLE_BATCH_ROWS)) {
+        return false;
+    }
+
+    // The CSV columns come first, then the partition keys; a duplicated name
+    // counts its last column, the one queries and predicates read
+    const size_t num_fields = sampler.field_columns_.size();
+    std::unordered_map<std::string, CellCounts> counts;
+    uint64_t rows = 0;
+    bool more;
+    do {
+        more = sampler.nextBatch();
+        const ColumnTable& batch = sampler.getTable();
+        for (size_t idx = 0; idx < num_fields && idx < batch.numColumns(); ++idx) {
+            const Column& column = batch.getColumn(idx);
+            if (batch.findColumn(column.getName()) != static_cast<int>(idx)) {
+                continue;
+            }
+            CellCounts& column_counts = counts[column.getName()];
+            for (size_t row = 0; row < column.size(); ++row) {
+                if (!column.isMissing(row)) {
+                    column_counts.add(column.getString(row));
+                }
+            }
+        }
+        rows += batch.numRows();
+    } while (more && sample_rows == 0);
+    const BatchState& state = *sampler.batch_;
+    if (state.failed || (state.reader && state.at_eof && state.reader->failed())) {
+        return false;
+    }
+
+    for (const auto& entry : counts) {
+        schema_[entry.first] = entry.second.type();
+    }
+    // Appended records land past the sample only if it was cut short
+    schema_final_ = sample_rows > 0 && rows >= sample_rows;
+    for (const auto& entry : partition_types) {
+        if (std::find(sampler.headers_.begin(), sampler.headers_.begin() + num_fields, entry.first) ==
+            sampler.headers_.begin() + num_fields) {
+            schema_[entry.first] = entry.second;
+        }
+    }
+    return true;
+}
+
+const ColumnType* CSVLoader::schemaType(const std::string& column) const {
+    static const ColumnType text = ColumnType::STRING;
+    if (!options_.infer_schema) {
+        return &text;
+    }
+    // Elements of an unordered_map stay where they are as it grows
+    auto it = schema_.find(column);
+    return it != schema_.end() ? &it->second : nullptr;
+}
+
+void CSVLoader::enforceBudget() {
+    stats_.columns_spilled += budget_->enforce(table_);
+}
+
+void CSVLoader::recordMemoryStats() {
+    stats_.memory_bytes = budget_->currentBytes();
+    stats_.memory_peak_bytes = budget_->peakBytes();
+    stats_.spilled_bytes = budget_->spilledBytes();
+}
+
 bool CSVLoader::load() {
-    std::ifstream file(filename_);
+    auto start = std::chrono::steady_clock::now();
+
+    reset();
+    bool ok;
+    if (isMultiFileTable(filename_)) {
+        ok = loadFiles();
+    }
+    else {
+        ok = options_.use_cache ? loadCached() : loadParsed();
+    }
+
+    if (ok) {
+        indexes_.clear();
+        buildIndexes();
+    }
+
+    stats_.rows_loaded = table_.numRows();
+    recordMemoryStats();
+    stats_.load_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+bool CSVLoader::loadStream() {
+    // Read fixed-size blocks and tokenize every complete record in them;
+    // a partial record at the end of a block is carried into the next one.
+    // The reader fetches (or inflates) the following blocks while this one is parsed.
+    std::unique_ptr<BlockReader> file = openReader(filename_);
+    if (!file) {
+        return false;
+    }
+    const size_t block_size = file->blockSize();
+    std::vector<char> buffer;
+    size_t filled = 0;
+    uint64_t records = 0;
+    bool have_headers = false;
+    while (true) {
+        buffer.resize(filled + block_size);
+        size_t got = file->read(buffer.data() + filled);
+        filled += got;
+        stats_.bytes_read += got;
+        bool at_eof = (got == 0);
+
+        const char* begin = buffer.data();
+        const char* end = begin + filled;
+        if (!have_headers) {
+            // The header record may itself contain quoted line breaks
+            const char* header_end = scanner_.findRecordStart(begin, end, false);
+            if (header_end == end && !at_eof) {
+                continue;
+            }
+            if (filled == 0) {
+                // Corrupt compressed data reads as nothing; the reader reported it
+                if (!file->failed()) {
+                    std::cerr << "Empty CSV file: " << filename_ << std::endl;
+                }
+                return false;
+            }
+            parseHeaders(begin, header_end);
+            initColumns(table_, false);
+            have_headers = true;
+            begin = header_end;
+        }
+
+        const char* complete = end;
+        if (!at_eof) {
+            // Stop after the last record delimiter that is not inside quotes
+            complete = scanner_.findLastRecordEnd(begin, end);
+        }
+        ParseResult result = parseRange(begin, complete, table_, false, records);
+        records += result.records;
+        stats_.bytes_skipped += result.bytes_skipped;
+        stats_.rows_filtered += result.rows_filtered;
+        enforceBudget();
+
+        // Keep the unparsed tail at the front of the buffer
+        filled = end - complete;
+        memmove(buffer.data(), complete, filled);
+        if (at_eof) {
+            break;
+        }
+    }
+
+    // A read error or corrupt compressed data must not pass for the end of the file
+    if (file->failed()) {
+        return false;
+    }
+    file.reset();
+    stats_.chunks_parsed = 1;
+    stats_.records = records;
+    // Appends to a compressed file cannot be parsed on their own
+    if (!stats_.compressed) {
+        rememberTail(records, stats_.bytes_read);
+    }
+    return true;
+}
+
+std::unique_ptr<BlockReader> CSVLoader::openReader(const std::string& filename) {
+    if (detectCompression(filename) != Compression::NONE) {
+        std::unique_ptr<CompressedReader> reader(new CompressedReader(1 << 20, options_.decompression_threads));
+        if (!reader->open(filename)) {
+            return nullptr;
+        }
+        stats_.compressed = true;
+        return reader;
+    }
+    std::unique_ptr<ReadAheadReader> reader(new ReadAheadReader(1 << 20, options_.read_ahead_blocks));
+    if (!reader->open(filename)) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return nullptr;
+    }
+    stats_.io_uring = reader->usesIoUring();
+    return reader;
+}
+
+bool CSVLoader::loadParsed() {
+    if (!sampleSchema(TableSchema())) {
+        return false;
+    }
+    // The chunked parallel parser works on the mapped file, which compressed input cannot be
+    bool mapped = (options_.mode == LoadMode::MMAP || options_.num_threads > 1) &&
+                  detectCompression(filename_) == Compression::NONE;
+    bool ok = mapped ? loadMapped() : loadStream();
+    if (ok) {
+        finalizeColumns();
+    }
+    return ok;
+}
+
+bool CSVLoader::loadCached() {
+    ColumnCache cache(filename_);
+    if (!cache.fingerprint()) {
+        return loadParsed();
+    }
+    auto keep = [this](const std::string& header) { return isRequired(header); };
+    // A file of a multi-file table is cached as text, as a load without inference would be
+    bool typed = options_.infer_schema && !table_schema_;
+    if (cache.read(table_, headers_, keep, typed, options_.schema_sample_rows, options_.dictionary_max_entries)) {
+        stats_.cache_hit = true;
+        stats_.bytes_read = cache.getFingerprint().size;
+        // The cache holds every record, so the last row id is the last record
+        stats_.records = table_.numRows() > 0 ? table_.getRowId(table_.numRows() - 1) + 1 : 0;
+        enforceBudget();
+        return true;
+    }
+
+    // Missing or stale: parse every column and row so the cache serves any query
+    CSVLoadOptions requested = options_;
+    options_.columns.clear();
+    options_.predicates.clear();
+    bool ok = loadParsed();
+    options_ = requested;
+    if (!ok) {
+        return false;
+    }
+    cache.write(table_, typed, options_.schema_sample_rows, options_.dictionary_max_entries);
+
+    // Apply the requested projection to the full table
+    ColumnTable projected(table_.getResource());
+    projected.reserve(table_.numRows());
+    for (uint64_t row_id : table_.getRowIds()) {
+        projected.appendRowId(row_id);
+    }
+    for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+        if (isRequired(table_.getColumn(idx).getName())) {
+            projected.addColumn(std::move(table_.getColumn(idx)));
+        }
+    }
+    table_ = std::move(projected);
+    // The parsed fields no longer line up with the projected table
+    tail_.reset();
+    return true;
+}
+
+bool CSVLoader::loadRows(const std::vector<uint64_t>& row_ids) {
+    auto start = std::chrono::steady_clock::now();
+    reset();
+
+    if (isMultiFileTable(filename_)) {
+        std::cerr << "Row lookups need a single CSV file: " << filename_ << std::endl;
+        return false;
+    }
+    if (detectCompression(filename_) != Compression::NONE) {
+        std::cerr << "Row lookups need an uncompressed file: " << filename_ << std::endl;
+        return false;
+    }
+    if (!sampleSchema(TableSchema())) {
+        return false;
+    }
+    RowOffsetIndex index(filename_);
+    if (!index.openOrBuild()) {
+        std::cerr << "Failed to build row offset index for: " << filename_ << std::endl;
+        return false;
+    }
+    std::ifstream file(filename_, std::ios::binary);
     if (!file.is_open()) {
         std::cerr << "Failed to open file: " << filename_ << std::endl;
         return false;
     }
+    std::vector<char> buffer(index.headerEnd());
+    if (!file.read(buffer.data(), buffer.size())) {
+        std::cerr << "Failed to read headers from: " << filename_ << std::endl;
+        return false;
+    }
+    parseHeaders(buffer.data(), buffer.data() + buffer.size());
+    initColumns(table_, false);
+    stats_.bytes_read = buffer.size();
 
-    std::string line;
-    // Read headers
-    if (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string cell;
-        while (std::getline(ss, cell, ',')) {
-            headers_.push_back(cell);
+    std::vector<uint64_t> sorted(row_ids);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    for (size_t i = 0; i < sorted.size();) {
+        // Consecutive rows are one contiguous read
+        size_t run = 1;
+        while (i + run < sorted.size() && sorted[i + run] == sorted[i] + run) {
+            run++;
+        }
+        uint64_t begin, end;
+        if (!index.rowRange(sorted[i], run, begin, end)) {
+            std::cerr << "Row " << sorted[i] << " is out of range for: " << filename_ << std::endl;
+            return false;
+        }
+        buffer.resize(end - begin);
+        file.seekg(begin);
+        if (!file.read(buffer.data(), buffer.size())) {
+            std::cerr << "Failed to read rows from: " << filename_ << std::endl;
+            return false;
+        }
+        ParseResult result = parseRange(buffer.data(), buffer.data() + buffer.size(), table_, false, sorted[i]);
+        stats_.bytes_read += buffer.size();
+        stats_.bytes_skipped += result.bytes_skipped;
+        stats_.rows_filtered += result.rows_filtered;
+        stats_.chunks_parsed++;
+        i += run;
+        enforceBudget();
+    }
+    finalizeColumns();
+
+    stats_.rows_loaded = table_.numRows();
+    recordMemoryStats();
+    stats_.load_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool CSVLoader::refresh() {
+    if (!tail_ || (options_.infer_schema && !schema_final_)) {
+        return load();
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::ifstream file(filename_, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename_ << std::endl;
+        return false;
+    }
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    uint64_t checksum;
+    bool terminated;
+    // A shrunk or rewritten prefix means the file is no longer the one loaded
+    if (size < tail_->bytes || !tailChecksum(file, tail_->bytes, checksum, terminated) ||
+        checksum != tail_->checksum) {
+        return load();
+    }
+    stats_ = CSVLoadStats();
+    stats_.appended = true;
+    if (size > tail_->bytes) {
+        if (!tail_->terminated) {
+            // The last load parsed a record that may have been cut short
+            return load();
+        }
+        std::vector<char> buffer(size - tail_->bytes);
+        file.seekg(tail_->bytes);
+        if (!file.read(buffer.data(), buffer.size())) {
+            std::cerr << "Failed to read appended rows from: " << filename_ << std::endl;
+            return false;
+        }
+        // Only complete records; a record still being written waits for the next refresh
+        const char* begin = buffer.data();
+        const char* complete = scanner_.findLastRecordEnd(begin, begin + buffer.size());
+        if (complete > begin) {
+            ColumnTable delta;
+            initColumns(delta, false);
+            ParseResult result = parseRange(begin, complete, delta, false, tail_->records);
+            if (!appendConformed(delta)) {
+                return load();
+            }
+            uint64_t consumed = complete - begin;
+            stats_.bytes_read = consumed;
+            stats_.bytes_skipped = result.bytes_skipped;
+            stats_.rows_filtered = result.rows_filtered;
+            stats_.rows_loaded = delta.numRows();
+            stats_.chunks_parsed = 1;
+            rememberTail(tail_->records + result.records, tail_->bytes + consumed);
+            clearData();
+            enforceBudget();
+        }
+    }
+    recordMemoryStats();
+    stats_.load_time_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void CSVLoader::rememberTail(uint64_t records, uint64_t bytes) {
+    std::ifstream file(filename_, std::ios::binary);
+    auto tail = std::make_unique<TailState>();
+    tail->bytes = bytes;
+    tail->records = records;
+    if (!file.is_open() || !tailChecksum(file, bytes, tail->checksum, tail->terminated)) {
+        tail_.reset();
+        return;
+    }
+    tail_ = std::move(tail);
+}
+
+bool CSVLoader::tailChecksum(std::ifstream& file, uint64_t bytes, uint64_t& checksum, bool& terminated) const {
+    // Hashing the whole prefix would cost as much as re-parsing it; the
+    // header and the last records consumed catch rewrites and rotations
+    const uint64_t window = 1 << 16;
+    std::vector<char> head(std::min(bytes, window));
+    std::vector<char> tail(std::min(bytes, window));
+    file.clear();
+    file.seekg(0);
+    file.read(head.data(), head.size());
+    file.seekg(bytes - tail.size());
+    file.read(tail.data(), tail.size());
+    if (!file) {
+        file.clear();
+        return false;
+    }
+    checksum = hashBytes(head.data(), head.size()) ^ (hashBytes(tail.data(), tail.size()) * 31);
+    terminated = !tail.empty() && tail.back() == '\n';
+    return true;
+}
+
+bool CSVLoader::appendConformed(ColumnTable& delta) {
+    // Convert first so that a cell that does not fit leaves the table untouched
+    std::vector<Column> converted;
+    for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+        const Column& column = table_.getColumn(idx);
+        ColumnType delta_type = delta.getColumn(idx).getType();
+        if (column.getType() == ColumnType::DOUBLE && delta_type == ColumnType::INT64) {
+            widenColumn(delta, idx);
+            delta_type = ColumnType::DOUBLE;
+        }
+        converted.emplace_back(column.getName(), column.getType());
+        if (delta_type == column.getType()) {
+            continue;
+        }
+        // A column inferred from the whole table gets the delta's text converted;
+        // one the delta had to widen no longer fits
+        if (delta_type != ColumnType::STRING ||
+            !convertColumn(delta.getColumn(idx), column.getType(), converted.back())) {
+            return false;
+        }
+    }
+    for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+        Column& column = table_.getColumn(idx);
+        const Column& source = delta.getColumn(idx);
+        if (column.getType() != ColumnType::STRING) {
+            column.appendColumn(source.getType() == column.getType() ? source : converted[idx]);
+            continue;
+        }
+        // STRING cells go through appendString, which interns them into the
+        // column's dictionary or copies them next to its mapped cells
+        column.reserve(column.size() + source.size());
+        for (size_t row = 0; row < source.size(); ++row) {
+            if (source.isMissing(row)) {
+                column.appendMissing();
+            }
+            else {
+                column.appendString(source.getString(row));
+            }
+        }
+    }
+    for (uint64_t row_id : delta.getRowIds()) {
+        table_.appendRowId(row_id);
+    }
+    return true;
+}
+
+bool CSVLoader::openBatches(size_t batch_rows) {
+    auto start = std::chrono::steady_clock::now();
+    reset();
+    batch_.reset(new BatchState());
+    BatchState& state = *batch_;
+    state.batch_rows = std::max<size_t>(1, batch_rows);
+    TableListing listing = listTableFiles(filename_, options_.infer_schema);
+    if (listing.files.empty()) {
+        std::cerr << "No CSV files match: " << filename_ << std::endl;
+        batch_.reset();
+        return false;
+    }
+    if (!sampleSchema(listing.partition_types)) {
+        batch_.reset();
+        return false;
+    }
+    prunePartitions(listing, options_.predicates, options_.infer_schema ? schema_ : listing.partition_types);
+    state.files = std::move(listing.files);
+    state.multi_file = isMultiFileTable(filename_);
+    if (state.multi_file) {
+        partition_keys_ = std::move(listing.partition_keys);
+        stats_.partitions_pruned = listing.pruned;
+    }
+    // Every file may be pruned or ruled out by its statistics, which still name the headers
+    if (!openBatchFile() && (state.failed || (headers_.empty() && !readPrunedHeaders()))) {
+        batch_.reset();
+        return false;
+    }
+
+    stats_.load_time_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool CSVLoader::nextBatch() {
+    if (!batch_ || batch_->failed) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    BatchState& state = *batch_;
+    table_.clear();
+    initColumns(table_, false);
+    clearData();
+
+    // Parse whole records until the batch is full; rows dropped by pushed-down
+    // predicates do not count towards it
+    size_t file_first_row = 0;          // First row of the batch from the current file
+    while (table_.numRows() < state.batch_rows) {
+        const char* begin = state.buffer.data() + state.begin;
+        const char* end = state.buffer.data() + state.filled;
+        if (state.at_eof && begin == end) {
+            if (!state.reader || state.reader->failed()) {
+                break;
+            }
+            // Row ids run on into the next file of a multi-file table
+            appendPartitionCells(table_, state.files[state.current_file], table_.numRows() - file_first_row);
+            file_first_row = table_.numRows();
+            if (!openBatchFile()) {
+                break;
+            }
+            continue;
+        }
+        const char* complete = state.at_eof ? end : scanner_.findLastRecordEnd(begin, end);
+        size_t wanted = state.batch_rows - table_.numRows();
+        const char* stop = scanner_.findRecordEnd(begin, complete, wanted);
+        if (stop > begin) {
+            ParseResult result = parseRange(begin, stop, table_, false, state.records);
+            state.records += result.records;
+            state.begin = stop - state.buffer.data();
+            stats_.bytes_skipped += result.bytes_skipped;
+            stats_.rows_filtered += result.rows_filtered;
+            stats_.chunks_parsed++;
+            enforceBudget();
+        }
+        if (stop == complete && !state.at_eof) {
+            readBatchBlock();
+        }
+    }
+
+    if (table_.numRows() > file_first_row) {
+        appendPartitionCells(table_, state.files[state.current_file], table_.numRows() - file_first_row);
+    }
+
+    stats_.records = state.records;
+
+    // Every batch was parsed with the types sampled by openBatches, so a cell
+    // reads the same whichever batch it falls in; columns that were not
+    // sampled stay text. Each batch gets its own dictionaries.
+    for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+        dictionaryEncode(table_, idx, options_.dictionary_max_entries);
+    }
+    enforceBudget();
+
+    stats_.rows_loaded += table_.numRows();
+    recordMemoryStats();
+    stats_.load_time_ms += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    if (state.failed || (state.reader && state.at_eof && state.reader->failed())) {
+        return false;
+    }
+    return table_.numRows() > 0;
+}
+
+bool CSVLoader::openBatchFile() {
+    BatchState& state = *batch_;
+    while (state.next_file < state.files.size()) {
+        const std::string& filename = state.files[state.next_file].path;
+        state.current_file = state.next_file++;
+        if (state.multi_file && !options_.predicates.empty()) {
+            FileStatistics file_stats(filename);
+            if (file_stats.open() && !file_stats.mayMatch(options_.predicates, schema_)) {
+                if (headers_.empty()) {
+                    headers_ = file_stats.getHeaders();
+                    mapHeaders();
+                }
+                state.records += file_stats.numRecords();
+                stats_.files_skipped++;
+                continue;
+            }
+        }
+        state.reader = openReader(filename);
+        if (!state.reader) {
+            state.failed = true;
+            return false;
+        }
+        state.buffer.clear();
+        state.begin = 0;
+        state.filled = 0;
+        state.at_eof = false;
+
+        // Read until the header record is complete
+        const char* header_end;
+        do {
+            readBatchBlock();
+            header_end = scanner_.findRecordStart(state.buffer.data(), state.buffer.data() + state.filled, false);
+        } while (header_end == state.buffer.data() + state.filled && !state.at_eof);
+        if (state.filled == 0) {
+            if (!state.reader->failed()) {
+                std::cerr << "Empty CSV file: " << filename << std::endl;
+            }
+            state.failed = true;
+            return false;
+        }
+        std::vector<std::string> previous = std::move(headers_);
+        headers_.clear();
+        field_columns_.clear();
+        field_predicates_.clear();
+        parseHeaders(state.buffer.data(), header_end);
+        if (!previous.empty() && previous != headers_) {
+            std::cerr << "Headers of " << filename << " do not match the rest of " << filename_ << std::endl;
+            state.failed = true;
+            return false;
+        }
+        state.begin = header_end - state.buffer.data();
+        if (state.multi_file) {
+            stats_.files_loaded++;
         }
-    } else {
+        return true;
+    }
+    state.at_eof = true;
+    return false;
+}
+
+bool CSVLoader::loadFiles() {
+    TableListing listing = listTableFiles(filename_, options_.infer_schema);
+    if (listing.files.empty()) {
+        std::cerr << "No CSV files match: " << filename_ << std::endl;
+        return false;
+    }
+    // Pruning needs the column types, so the sample reads the leading files pruned or not
+    if (!sampleSchema(listing.partition_types)) {
+        return false;
+    }
+    prunePartitions(listing, options_.predicates, options_.infer_schema ? schema_ : listing.partition_types);
+    const std::vector<TableFile>& files = listing.files;
+    partition_keys_ = listing.partition_keys;
+    stats_.partitions_pruned = listing.pruned;
+    if (files.empty()) {
+        if (!readPrunedHeaders()) {
+            return false;
+        }
+        initColumns(table_, false);
+        for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+            dictionaryEncode(table_, idx, options_.dictionary_max_entries);
+        }
+        return true;
+    }
+
+    // Each file is parsed on its own, so the pool parallelizes across files
+    CSVLoadOptions file_options = options_;
+    if (files.size() > 1) {
+        file_options.num_threads = 1;
+        file_options.decompression_threads = 1;
+    }
+    // Dictionaries are built once over the concatenated columns
+    file_options.dictionary_max_entries = 0;
+
+    struct FileLoad {
+        std::unique_ptr<FileStatistics> statistics;
+        std::unique_ptr<CSVLoader> loader;
+        bool skipped = false;
+        bool ok = false;
+        bool collect = false;           // Statistics are taken once the table is typed
+        size_t first_row = 0;           // Rows of the file in table_
+        size_t num_rows = 0;
+        uint64_t records = 0;
+    };
+    std::vector<FileLoad> loads(files.size());
+    // Declared after the per-file state, so the workers stop before it goes away
+    ThreadPool pool(std::min(options_.parallel_files == 0 ? files.size() : options_.parallel_files, files.size()));
+    std::vector<std::future<void>> pending;
+    for (size_t i = 0; i < files.size(); ++i) {
+        pending.push_back(pool.submit([this, &files, &file_options, &loads, i] {
+            FileLoad& load = loads[i];
+            load.statistics.reset(new FileStatistics(files[i].path));
+            bool known = load.statistics->open();
+            if (known && !load.statistics->mayMatch(options_.predicates, schema_)) {
+                load.skipped = true;
+                load.ok = true;
+                return;
+            }
+            // Statistics need every record of the file, so the first query to
+            // filter on a column reads its files unfiltered
+            CSVLoadOptions load_options = file_options;
+            load.collect = options_.infer_schema && !options_.predicates.empty() &&
+                           !(known && load.statistics->covers(options_.predicates));
+            if (load.collect) {
+                load_options.predicates.clear();
+            }
+            load.loader.reset(new CSVLoader(files[i].path, load_options, budget_, &schema_));
+            load.ok = load.loader->load();
+        }));
+    }
+
+    // Concatenate in file order as the files finish
+    uint64_t records = 0;
+    bool all_cached = true;
+    std::vector<std::string> file_headers;
+    for (size_t i = 0; i < files.size(); ++i) {
+        pending[i].get();
+        FileLoad& load = loads[i];
+        if (!load.ok) {
+            std::cerr << "Failed to load table file: " << files[i].path << std::endl;
+            return false;
+        }
+        const std::vector<std::string>& headers =
+            load.skipped ? load.statistics->getHeaders() : load.loader->getHeaders();
+        if (i == 0) {
+            file_headers = headers;
+            headers_ = headers;
+            mapHeaders();
+            initColumns(table_, false);
+        }
+        else if (headers != file_headers) {
+            std::cerr << "Headers of " << files[i].path << " do not match the rest of " << filename_ << std::endl;
+            return false;
+        }
+        if (load.skipped) {
+            records += load.statistics->numRecords();
+            stats_.files_skipped++;
+            continue;
+        }
+
+        const CSVLoadStats& file_stats = load.loader->getStats();
+        const ColumnTable& part = load.loader->getTable();
+        load.first_row = table_.numRows();
+        load.num_rows = part.numRows();
+        load.records = file_stats.records;
+        // Every file was typed with the table's schema; one that had to widen
+        // a column widens it for the whole table
+        for (size_t idx = 0; idx < part.numColumns(); ++idx) {
+            appendCells(table_, idx, part.getColumn(idx));
+        }
+        appendPartitionCells(table_, files[i], part.numRows());
+        for (uint64_t row_id : part.getRowIds()) {
+            table_.appendRowId(row_id + records);
+        }
+        records += file_stats.records;
+        stats_.bytes_read += file_stats.bytes_read;
+        stats_.bytes_skipped += file_stats.bytes_skipped;
+        stats_.rows_filtered += file_stats.rows_filtered;
+        stats_.chunks_parsed += file_stats.chunks_parsed;
+        stats_.io_uring = stats_.io_uring || file_stats.io_uring;
+        stats_.compressed = stats_.compressed || file_stats.compressed;
+        all_cached = all_cached && file_stats.cache_hit;
+        stats_.columns_spilled += file_stats.columns_spilled;
+        stats_.files_loaded++;
+        load.loader.reset();
+        enforceBudget();
+    }
+    stats_.records = records;
+    stats_.cache_hit = stats_.files_loaded > 0 && all_cached;
+
+    // Columns the schema does not give were gathered as text and take the
+    // types of a single-file load of the same rows
+    finalizeColumns();
+    for (const FileLoad& load : loads) {
+        if (load.collect) {
+            load.statistics->update(table_, load.first_row, load.num_rows, file_headers, load.records);
+        }
+    }
+    return true;
+}
+
+bool CSVLoader::readPrunedHeaders() {
+    TableListing listing = listTableFiles(filename_, options_.infer_schema);
+    if (listing.files.empty()) {
+        std::cerr << "No CSV files match: " << filename_ << std::endl;
+        return false;
+    }
+    const std::string& filename = listing.files.front().path;
+    FileStatistics file_stats(filename);
+    if (file_stats.open()) {
+        headers_ = file_stats.getHeaders();
+    }
+    else {
+        // Reads one block of the file for its header record
+        CSVLoadOptions header_options;
+        header_options.infer_schema = false;
+        header_options.read_ahead_blocks = 0;
+        header_options.decompression_threads = 1;
+        CSVLoader header_loader(filename, header_options);
+        if (!header_loader.openBatches(1)) {
+            return false;
+        }
+        headers_ = header_loader.getHeaders();
+    }
+    partition_keys_ = listing.partition_keys;
+    field_columns_.clear();
+    field_predicates_.clear();
+    mapHeaders();
+    return true;
+}
+
+void CSVLoader::readBatchBlock() {
+    BatchState& state = *batch_;
+    // Move the unparsed tail to the front so the buffer stays one block plus a partial record
+    const size_t block_size = state.reader->blockSize();
+    state.filled -= state.begin;
+    if (state.filled > 0) {
+        memmove(state.buffer.data(), state.buffer.data() + state.begin, state.filled);
+    }
+    state.begin = 0;
+    state.buffer.resize(state.filled + block_size);
+    size_t got = state.reader->read(state.buffer.data() + state.filled);
+    state.filled += got;
+    stats_.bytes_read += got;
+    state.at_eof = (got == 0);
+}
+
+// Split the header record; quoted names are unescaped like data cells
+void CSVLoader::parseHeaders(const char* begin, const char* end) {
+    std::string scratch;
+    auto addHeader = [&](const char* cell_begin, const char* cell_end) {
+        headers_.emplace_back(CSVScanner::decodeCell(cell_begin, cell_end, scratch));
+    };
+    scanner_.tokenize(begin, end, addHeader, [&](const char* cell_begin, const char* cell_end) {
+        if (cell_end > cell_begin) {
+            addHeader(cell_begin, cell_end);
+        }
+    });
+    mapHeaders();
+}
+
+void CSVLoader::mapHeaders() {
+    int next_column = 0;
+    for (const auto& header : headers_) {
+        field_columns_.push_back(isRequired(header) ? next_column++ : -1);
+    }
+    // The WHERE clause takes its conjuncts in order and reports the first
+    // error, so a predicate may only drop rows after those before it were
+    // checked too or cannot fail with an error. Predicates on unknown
+    // columns are left to the executor to report.
+    for (const auto& predicate : options_.predicates) {
+        auto it = std::find(headers_.rbegin(), headers_.rend(), predicate.column);
+        if (it != headers_.rend()) {
+            field_predicates_.push_back({ static_cast<size_t>(headers_.rend() - it - 1), &predicate,
+                                          schemaType(predicate.column) });
+        }
+        else if (!predicate.errorFree(schemaType(predicate.column))) {
+            break;
+        }
+    }
+    // A CSV column named like a partition key takes precedence over the directory
+    partition_columns_.clear();
+    for (const auto& key : partition_keys_) {
+        if (std::find(headers_.begin(), headers_.begin() + field_columns_.size(), key) !=
+            headers_.begin() + field_columns_.size()) {
+            partition_columns_.push_back(-1);
+            continue;
+        }
+        partition_columns_.push_back(isRequired(key) ? next_column++ : -1);
+        headers_.push_back(key);
+    }
+}
+
+bool CSVLoader::isRequired(const std::string& header) const {
+    return options_.columns.empty() || options_.columns.count(header) > 0 ||
+           std::find(index_columns_.begin(), index_columns_.end(), header) != index_columns_.end();
+}
+
+bool CSVLoader::loadMapped() {
+    mapping_ = std::make_shared<MappedFile>();
+    if (!mapping_->open(filename_)) {
+        return false;
+    }
+
+    const char* base = mapping_->data();
+    const char* end = base + mapping_->size();
+    if (base == end) {
         std::cerr << "Empty CSV file: " << filename_ << std::endl;
         return false;
     }
 
-    // Read data
-    uint64_t row_num = 0;
-    while (std::getline(file, line)) {
-        std::stringstream ss(line);
-        std::string cell;
-        std::unordered_map<std::string, std::string> row;
-        size_t idx = 0;
-        uint64_t file_offset = file.tellg(); // Optional: Store file offset if needed
-        while (std::getline(ss, cell, ',') && idx < headers_.size()) {
-            row[headers_[idx]] = cell;
-            // Insert into index if applicable
-            if (indexes_.find(headers_[idx]) != indexes_.end()) {
-                auto key_str = cell;
-                // Convert key_str to appropriate type based on index
-                auto btree = indexes_[headers_[idx]];
-                OperandValue key_val;
-                // Example for string type
-                if (btree->getKeyType() == KeyType::STRING) {
-                    key_val = key_str;
+    // Read headers
+    const char* body = scanner_.findRecordStart(base, end, false);
+    parseHeaders(base, body);
+
+    bool reference_mapping = (options_.mode == LoadMode::MMAP);
+    initColumns(table_, reference_mapping);
+
+    // Split the body into byte ranges, each realigned to start on a record boundary
+    size_t num_chunks = std::max<size_t>(1, options_.num_threads);
+    const size_t min_chunk_bytes = 1 << 20;
+    num_chunks = std::min(num_chunks, std::max<size_t>(1, (end - body) / min_chunk_bytes));
+    std::vector<const char*> bounds;
+    bounds.push_back(body);
+    if (num_chunks > 1) {
+        // A newline only ends a record outside quotes, so the quote parity at
+        // each split point is needed; count the quotes of each segment in parallel
+        std::vector<const char*> nominal(num_chunks + 1);
+        nominal[0] = body;
+        for (size_t i = 1; i < num_chunks; ++i) {
+            nominal[i] = body + (end - body) * i / num_chunks - 1;
+        }
+        nominal[num_chunks] = end;
+        std::vector<size_t> quotes(num_chunks, 0);
+        {
+            ThreadPool pool(std::min(options_.num_threads, num_chunks));
+            std::vector<std::future<void>> pending;
+            for (size_t i = 0; i + 1 < num_chunks; ++i) {
+                pending.push_back(pool.submit([this, &nominal, &quotes, i] {
+                    quotes[i] = scanner_.countQuotes(nominal[i], nominal[i + 1]);
+                }));
+            }
+            for (auto& task : pending) {
+                task.get();
+            }
+        }
+        size_t parity = 0;
+        for (size_t i = 1; i < num_chunks; ++i) {
+            parity += quotes[i - 1];
+            const char* chunk_start = scanner_.findRecordStart(nominal[i], end, parity % 2 == 1);
+            if (chunk_start > bounds.back() && chunk_start < end) {
+                bounds.push_back(chunk_start);
+            }
+        }
+    }
+    bounds.push_back(end);
+    stats_.chunks_parsed = bounds.size() - 1;
+
+    uint64_t records = 0;
+    if (bounds.size() == 2) {
+        ParseResult result = parseRange(body, end, table_, reference_mapping, 0);
+        records = result.records;
+        stats_.bytes_skipped += result.bytes_skipped;
+        stats_.rows_filtered += result.rows_filtered;
+    }
+    else {
+        // Parse chunks on the pool, then stitch them back together in file order
+        // Built in place: a copied table would allocate its row ids from the heap
+        std::vector<ColumnTable> fragments;
+        fragments.reserve(bounds.size() - 1);
+        for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+            fragments.emplace_back(table_.getResource());
+        }
+        std::vector<ParseResult> results(fragments.size());
+        {
+            ThreadPool pool(std::min(options_.num_threads, fragments.size()));
+            std::vector<std::future<void>> pending;
+            for (size_t i = 0; i < fragments.size(); ++i) {
+                initColumns(fragments[i], reference_mapping);
+                pending.push_back(pool.submit([this, &bounds, &fragments, &results, i, reference_mapping] {
+                    results[i] = parseRange(bounds[i], bounds[i + 1], fragments[i], reference_mapping, 0);
+                }));
+            }
+            for (auto& task : pending) {
+                task.get();
+            }
+        }
+
+        size_t total_rows = 0;
+        for (size_t i = 0; i < fragments.size(); ++i) {
+            total_rows += fragments[i].numRows();
+            stats_.bytes_skipped += results[i].bytes_skipped;
+            stats_.rows_filtered += results[i].rows_filtered;
+        }
+        table_.reserve(total_rows);
+        for (size_t i = 0; i < fragments.size(); ++i) {
+            // A chunk that had to widen a column widens it for the whole table
+            for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+                if (table_.getColumn(idx).getType() != fragments[i].getColumn(idx).getType()) {
+                    widenColumn(table_.getColumn(idx).getType() == ColumnType::INT64 ? table_ : fragments[i], idx);
                 }
-                // Handle other types (int, double) as needed
-                // Insert key and row number or file offset
-                btree->insert(key_val, row_num); // Assuming row_num as data pointer
+            }
+            // Row ids stay the global data row numbers the index builder relies
+            // on, counting the records dropped by predicates in earlier chunks
+            table_.appendTable(fragments[i], records);
+            records += results[i].records;
+            fragments[i].clear();
+            enforceBudget();
+        }
+    }
+
+    stats_.bytes_read = mapping_->size();
+    stats_.records = records;
+    rememberTail(records, mapping_->size());
+    if (!reference_mapping) {
+        // Cells were copied; the mapping is no longer needed
+        mapping_.reset();
+    }
+    return true;
+}
+
+void CSVLoader::finalizeColumns() {
+    if (!options_.infer_schema && options_.dictionary_max_entries == 0) {
+        return;
+    }
+    if (options_.num_threads <= 1 || table_.numColumns() <= 1) {
+        for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+            finalizeColumn(idx);
+            enforceBudget();
+        }
+        return;
+    }
+    // Columns are independent, so convert them concurrently
+    ThreadPool pool(std::min(options_.num_threads, table_.numColumns()));
+    std::vector<std::future<void>> pending;
+    for (size_t idx = 0; idx < table_.numColumns(); ++idx) {
+        pending.push_back(pool.submit([this, idx] {
+            finalizeColumn(idx);
+        }));
+    }
+    for (auto& task : pending) {
+        task.get();
+    }
+    enforceBudget();
+}
+
+void CSVLoader::finalizeColumn(size_t idx) {
+    if (options_.infer_schema && !table_schema_) {
+        const std::string& name = table_.getColumn(idx).getName();
+        // Sampled columns were typed as they were parsed (see initColumns)
+        if (schema_.count(name) == 0 || table_.findColumn(name) != static_cast<int>(idx)) {
+            inferColumn(table_, idx, options_.schema_sample_rows);
+        }
+    }
+    dictionaryEncode(table_, idx, options_.dictionary_max_entries);
+}
+
+void CSVLoader::initColumns(ColumnTable& table, bool reference_mapping) const {
+    for (size_t field = 0; field < field_columns_.size(); ++field) {
+        if (field_columns_[field] >= 0) {
+            table.addColumn(headers_[field]);
+        }
+    }
+    for (size_t k = 0; k < partition_keys_.size(); ++k) {
+        if (partition_columns_[k] >= 0) {
+            table.addColumn(partition_keys_[k]);
+        }
+    }
+    for (size_t idx = 0; idx < table.numColumns(); ++idx) {
+        const std::string name = table.getColumn(idx).getName();
+        auto type = schema_.find(name);
+        // A column shadowed by a later one of the same name was not sampled
+        if (options_.infer_schema && type != schema_.end() && table.findColumn(name) == static_cast<int>(idx) &&
+            type->second != ColumnType::STRING) {
+            table.replaceColumn(idx, Column(name, type->second, table.getResource()));
+        }
+        else if (reference_mapping) {
+            table.getColumn(idx).setExternalStrings(mapping_);
+        }
+    }
+}
+
+void CSVLoader::appendPartitionCells(ColumnTable& table, const TableFile& file, size_t rows) const {
+    for (size_t k = 0; k < partition_keys_.size(); ++k) {
+        if (partition_columns_[k] < 0) {
+            continue;
+        }
+        Column& column = table.getColumn(partition_columns_[k]);
+        column.reserve(column.size() + rows);
+        auto it = std::find_if(file.partitions.begin(), file.partitions.end(),
+                               [&](const PartitionValue& partition) { return partition.key == partition_keys_[k]; });
+        for (size_t row = 0; row < rows; ++row) {
+            // Files outside any directory of this key, like NULL partitions, have no value
+            if (it == file.partitions.end() || it->missing) {
+                table.getColumn(partition_columns_[k]).appendMissing();
+            }
+            else {
+                appendCell(table, partition_columns_[k], it->value);
+            }
+        }
+    }
+}
+
+CSVLoader::ParseResult CSVLoader::parseRange(const char* begin, const char* end, ColumnTable& table,
+                                             bool reference_mapping, uint64_t first_row) const {
+    const char* base = reference_mapping ? mapping_->data() : nullptr;
+    const size_t num_fields = field_columns_.size();
+    ParseResult result;
+    uint64_t row_num = first_row;
+    size_t idx = 0;
+    std::string scratch;
+
+    auto storeCell = [&](size_t field, const char* cell_begin, const char* cell_end) {
+        if (field_columns_[field] < 0) {
+            // Projected out: the cell is neither decoded nor stored
+            result.bytes_skipped += cell_end - cell_begin;
+            return;
+        }
+        Column& column = table.getColumn(field_columns_[field]);
+        // Quoted cells lose their quotes; only cells with escaped quotes are rewritten
+        std::string_view cell = (cell_begin < cell_end && *cell_begin == '"')
+            ? CSVScanner::decodeCell(cell_begin, cell_end, scratch)
+            : std::string_view(cell_begin, cell_end - cell_begin);
+        if (column.getType() != ColumnType::STRING) {
+            appendCell(table, field_columns_[field], cell);
+        }
+        else if (reference_mapping && cell.data() != scratch.data()) {
+            column.appendStringRef(cell.data() - base, static_cast<uint32_t>(cell.size()));
+        }
+        else {
+            column.appendString(cell);
+        }
+    };
+
+    auto finishRecord = [&](size_t num_cells) {
+        // Short rows leave the remaining cells missing
+        for (size_t field = num_cells; field < num_fields; ++field) {
+            if (field_columns_[field] >= 0) {
+                table.getColumn(field_columns_[field]).appendMissing();
+            }
+        }
+        table.appendRowId(row_num);
+    };
+
+    if (field_predicates_.empty()) {
+        auto appendCell = [&](const char* cell_begin, const char* cell_end) {
+            if (idx < num_fields) {
+                storeCell(idx, cell_begin, cell_end);
+            }
+            idx++;
+        };
+        scanner_.tokenize(begin, end, appendCell, [&](const char* cell_begin, const char* cell_end) {
+            // Like std::getline(ss, cell, ','), an empty final cell (blank line or
+            // trailing delimiter) does not count as a cell
+            if (cell_end > cell_begin) {
+                appendCell(cell_begin, cell_end);
+            }
+            finishRecord(std::min(idx, num_fields));
+            row_num++;
+            idx = 0;
+        });
+    }
+    else {
+        // Hold the cells of a record until the pushed-down predicates have passed
+        std::vector<std::string_view> cells(num_fields);
+        std::string predicate_scratch;
+        auto bufferCell = [&](const char* cell_begin, const char* cell_end) {
+            if (idx < num_fields) {
+                cells[idx] = std::string_view(cell_begin, cell_end - cell_begin);
             }
             idx++;
+        };
+        scanner_.tokenize(begin, end, bufferCell, [&](const char* cell_begin, const char* cell_end) {
+            if (cell_end > cell_begin) {
+                bufferCell(cell_begin, cell_end);
+            }
+            size_t num_cells = std::min(idx, num_fields);
+            if (recordMatches(cells, num_cells, predicate_scratch)) {
+                for (size_t field = 0; field < num_cells; ++field) {
+                    storeCell(field, cells[field].data(), cells[field].data() + cells[field].size());
+                }
+                finishRecord(num_cells);
+            }
+            else {
+                for (size_t field = 0; field < num_cells; ++field) {
+                    result.bytes_skipped += cells[field].size();
+                }
+                result.rows_filtered++;
+            }
+            row_num++;
+            idx = 0;
+        });
+    }
+
+    result.records = row_num - first_row;
+    return result;
+}
+
+bool CSVLoader::recordMatches(const std::vector<std::string_view>& cells, size_t num_cells, std::string& scratch) const {
+    for (const auto& entry : field_predicates_) {
+        // A missing cell is NULL, which fails every comparison
+        if (entry.field >= num_cells) {
+            return false;
+        }
+        const std::string_view& raw = cells[entry.field];
+        std::string_view cell = CSVScanner::decodeCell(raw.data(), raw.data() + raw.size(), scratch);
+        ScanMatch outcome = entry.predicate->match(cell, entry.type);
+        if (outcome == ScanMatch::FAIL) {
+            return false;
+        }
+        if (outcome == ScanMatch::UNKNOWN) {
+            // Kept for the WhereFilter, which reports the error before any later conjunct
+            return true;
+        }
+    }
+    return true;
+}
+
+ScanMatch ScanPredicate::match(std::string_view cell, const ColumnType* type) const {
+    if (type == nullptr) {
+        return ScanMatch::UNKNOWN;
+    }
+    // The value ColumnOperand gives the cell once convertColumn has stored it
+    OperandValue cell_value;
+    switch (*type) {
+        case ColumnType::INT64:
+        case ColumnType::DOUBLE: {
+            // An INT64 column may still widen to DOUBLE; either compares numbers by value
+            int64_t int_value;
+            double double_value;
+            if (parseInt64(cell, int_value) == ParseStatus::OK) {
+                if (int_value >= std::numeric_limits<int>::min() && int_value <= std::numeric_limits<int>::max()) {
+                    cell_value = static_cast<int>(int_value);
+                }
+                else {
+                    cell_value = static_cast<double>(int_value);
+                }
+            }
+            else if (parseDouble(cell, double_value) == ParseStatus::OK) {
+                cell_value = double_value;
+            }
+            else if (cell.empty()) {
+                return ScanMatch::FAIL;
+            }
+            else {
+                cell_value = parseCell(std::string(cell));
+            }
+            break;
         }
-        data_.push_back(row);
-        row_num++;
+        case ColumnType::BOOL: {
+            bool bool_value;
+            if (parseBool(cell, bool_value) == ParseStatus::OK) {
+                cell_value = bool_value;
+            }
+            else if (cell.empty()) {
+                return ScanMatch::FAIL;
+            }
+            else {
+                cell_value = parseCell(std::string(cell));
+            }
+            break;
+        }
+        case ColumnType::STRING:
+            cell_value = std::string(cell);
+            break;
+    }
+    try {
+        return compareValues(cell_value, comparator, value) ? ScanMatch::PASS : ScanMatch::FAIL;
+    }
+    catch (const std::exception&) {
+        // Unsupported comparisons are reported by the WhereFilter
+        return ScanMatch::UNKNOWN;
+    }
+}
+
+bool ScanPredicate::errorFree(const ColumnType* type, bool strays) const {
+    if (type == nullptr) {
+        return false;
+    }
+    // compareValues fails on the kinds of its operands and the comparator
+    // alone, never on their values; NULL cells fail without error
+    std::vector<OperandValue> cell_values;
+    switch (*type) {
+        case ColumnType::INT64:
+        case ColumnType::DOUBLE:
+            cell_values.push_back(0.0);
+            break;
+        case ColumnType::BOOL:
+            cell_values.push_back(false);
+            break;
+        case ColumnType::STRING:
+            cell_values.push_back(std::string());
+            break;
+    }
+    if (strays && *type != ColumnType::STRING) {
+        // A stray cell reads as any kind of value
+        cell_values.insert(cell_values.end(), { OperandValue(0), OperandValue(0.0), OperandValue(false),
+                                                OperandValue(std::string()) });
+    }
+    try {
+        for (const auto& cell_value : cell_values) {
+            compareValues(cell_value, comparator, value);
+        }
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool CSVLoader::loadIndexedRows(const std::string& column, const KeyValue& key) {
+    std::string index_filename = column + ".btree";
+    if (!fs::exists(index_filename)) {
+        std::cerr << "No B-tree index for column: " << column << std::endl;
+        return false;
+    }
+    // The key type is read from the index file
+    BTree btree(index_filename, KeyType::INTEGER);
+    if (!btree.load()) {
+        std::cerr << "Failed to load existing B-tree index: " << index_filename << std::endl;
+        return false;
     }
+    return loadRows(btree.search(key));
+}
 
-    file.close();
+void CSVLoader::buildIndexes() {
+    for (const auto& column : index_columns_) {
+        if (indexes_.count(column)) {
+            continue;
+        }
+        int index = table_.findColumn(column);
+        if (index < 0) {
+            if (std::find(headers_.begin(), headers_.end(), column) != headers_.end()) {
+                // Indexes requested before load() are always part of the projection
+                std::cerr << "Column '" << column << "' was not loaded; create its index before load()." << std::endl;
+            }
+            else {
+                std::cerr << "Column '" << column << "' does not exist in CSV." << std::endl;
+            }
+            continue;
+        }
+        const Column& col = table_.getColumn(index);
+        KeyType key_type = keyTypeFor(col);
+        std::string index_filename = column + ".btree";
+
+        // Check if index file already exists
+        std::shared_ptr<BTree> btree;
+        if (fs::exists(index_filename)) {
+            // Load existing index
+            btree = std::make_shared<BTree>(index_filename, key_type);
+            if (!btree->load() || btree->getKeyType() != key_type) {
+                std::cerr << "Failed to load existing B-tree index: " << index_filename << std::endl;
+                continue;
+            }
+            std::cout << "Loaded existing B-tree index for column: " << column << std::endl;
+        } else {
+            // Create a new B-tree index
+            btree = std::make_shared<BTree>(index_filename, key_type);
+            btree->initialize(); // Initialize B-tree (create root node, etc.)
+            std::cout << "Initialized new B-tree index for column: " << column << std::endl;
+        }
+        indexes_[column] = btree;
+
+        for (size_t row = 0; row < table_.numRows(); ++row) {
+            if (col.isMissing(row)) {
+                continue;
+            }
+            // Insert key and row number as the data pointer
+            btree->insert(keyFor(col, row, key_type), table_.getRowId(row));
+        }
 
-    // Save indexes after building
-    for (auto& [column, btree] : indexes_) {
         if (!btree->save()) {
             std::cerr << "Failed to save B-tree index for column: " << column << std::endl;
             // Handle error as needed
         }
     }
+}
 
-    return true;
+const ColumnTable& CSVLoader::getTable() const {
+    return table_;
+}
+
+// Heap bytes of a row map: its buckets, its nodes, and the strings too long
+// to be kept inline
+static size_t rowMapBytes(const std::unordered_map<std::string, std::string>& row) {
+    auto heapBytes = [](const std::string& text) {
+        return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+    };
+    size_t bytes = row.bucket_count() * sizeof(void*);
+    for (const auto& cell : row) {
+        // A node holds the pair, its next pointer and the cached hash
+        bytes += sizeof(cell) + 2 * sizeof(void*) + heapBytes(cell.first) + heapBytes(cell.second);
+    }
+    return bytes;
+}
+
+const std::vector<std::unordered_map<std::string, std::string>>& CSVLoader::getData() const {
+    if (!data_materialized_) {
+        data_.reserve(table_.numRows());
+        for (size_t row = 0; row < table_.numRows(); ++row) {
+            data_.push_back(table_.materializeRow(row));
+            data_bytes_ += rowMapBytes(data_.back());
+        }
+        data_bytes_ += data_.capacity() * sizeof(data_[0]);
+        budget_->reserveBytes(data_bytes_);
+        data_materialized_ = true;
+    }
+    return data_;
+}
+
+void CSVLoader::clearData() const {
+    budget_->releaseBytes(data_bytes_);
+    data_bytes_ = 0;
+    // Give the memory back rather than keeping the capacity
+    std::vector<std::unordered_map<std::string, std::string>>().swap(data_);
+    data_materialized_ = false;
+}
+
+const std::vector<std::string>& CSVLoader::getHeaders() const {
+    return headers_;
 }
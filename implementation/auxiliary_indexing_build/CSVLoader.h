@@ -2,30 +2,319 @@
 #ifndef CSVLOADER_H
 #define CSVLOADER_H
 
+#include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <memory>
+#include <unordered_set>
+#include "ColumnTable.h"
+#include "MemoryBudget.h"
+#include "MappedFile.h"
 #include "BTree.h"
+#include "CSVScanner.h"
+#include "CompressedReader.h"
+#include "ReadAheadReader.h"
+#include "Operand.h"
+#include "SchemaInference.h"
+#include "TableFiles.h"
+
+// How the CSV file is read
+enum class LoadMode {
+    STREAM,     // Buffered std::ifstream reads, cells copied into the table
+    MMAP        // File mapped once, STRING cells are views into the mapping
+};
+
+// Outcome of a pushed-down comparison on one cell
+enum class ScanMatch {
+    FAIL,       // False, as for every NULL cell
+    PASS,       // True
+    UNKNOWN     // Fails with an error, or the column type is not known; left to the WhereFilter
+};
+
+// A "column <comparator> constant" conjunct of the WHERE clause, checked on
+// the raw field bytes while scanning so that failing rows are never stored
+struct ScanPredicate {
+    std::string column;
+    Comparator comparator;
+    OperandValue value;
+
+    // The comparison the WhereFilter makes on the cell once it is stored in a
+    // column of the given type (null if not known). Empty cells of a numeric
+    // or bool type are NULL there; stray ones compare as their text.
+    ScanMatch match(std::string_view cell, const ColumnType* type) const;
+    // Whether the comparison evaluates without error on every cell of a
+    // column of the given type (null if not known), including stray cells
+    // unless the column is known to have none
+    bool errorFree(const ColumnType* type, bool strays = true) const;
+};
+
+// Options controlling CSVLoader::load
+struct CSVLoadOptions {
+    LoadMode mode = LoadMode::STREAM;
+    // Parser threads; more than one parses byte-range chunks of the mapped
+    // file in parallel (cells are still copied unless mode is MMAP).
+    // Compressed input is always streamed and ignores both.
+    size_t num_threads = 1;
+    // Files of a multi-file table (a directory or glob) loaded concurrently,
+    // each by a single parser thread; 0 uses every core
+    size_t parallel_files = 0;
+    // 1 MiB blocks read ahead of the tokenizer when streaming (load() in
+    // STREAM mode and batches); 0 reads each block only when it is needed
+    size_t read_ahead_blocks = 3;
+    // Threads decompressing gzip (BGZF) or zstd input made of independent
+    // frames of known size; 0 uses every core. Other compressed files are
+    // decompressed by a single thread ahead of the parser.
+    size_t decompression_threads = 0;
+    // Assign each column a type (int64, double, bool, string) after parsing
+    // and store its cells in typed form
+    bool infer_schema = true;
+    // Records read from the start of the table (its files in path order) to
+    // type each column before any row is filtered or stored, so that the
+    // types do not depend on the query; 0 reads every record, an extra pass
+    // over the input. A column without a value in them is STRING.
+    size_t schema_sample_rows = 1000;
+    // STRING columns with at most this many distinct values are stored as
+    // codes into a per-column dictionary; 0 disables dictionary encoding
+    size_t dictionary_max_entries = 4096;
+    // Columns to parse and store (e.g. ElementSelect::getRequiredColumns());
+    // cells of other columns are skipped. Empty loads every column.
+    std::unordered_set<std::string> columns;
+    // Conjuncts rows must satisfy to be stored (e.g. ElementSelect::getScanPredicates())
+    std::vector<ScanPredicate> predicates;
+    // Load from the binary sidecar cache <csv>.colcache when it matches the
+    // file, otherwise parse every column and write it. A cache hit applies
+    // the column projection but not the predicates.
+    bool use_cache = false;
+    // Bytes of column storage kept in memory; past it the least recently used
+    // columns (largest first) are moved to a memory-mapped temporary file.
+    // Checked between streamed blocks, files and finalized columns, so a
+    // mapped or parallel parse may overshoot until it is stitched together.
+    // 0 is unlimited.
+    size_t memory_budget = 0;
+    // Where spill files go; empty uses $TMPDIR or /tmp
+    std::string spill_directory;
+};
+
+// Statistics collected by the most recent CSVLoader::load
+struct CSVLoadStats {
+    uint64_t bytes_read = 0;        // Bytes of CSV input consumed (after decompression)
+    uint64_t rows_loaded = 0;       // Data rows stored in the table
+    double load_time_ms = 0.0;      // Wall-clock time spent in load()
+    size_t chunks_parsed = 0;       // Byte-range chunks the body was split into
+    uint64_t bytes_skipped = 0;     // Cell bytes not stored (projected out or filtered rows)
+    uint64_t rows_filtered = 0;     // Rows dropped by pushed-down predicates
+    bool cache_hit = false;         // Table was read from the sidecar cache
+    bool appended = false;          // refresh() parsed only the bytes appended since the last load
+    bool io_uring = false;          // Read-ahead went through io_uring rather than a reader thread
+    bool compressed = false;        // Input was gzip or zstd, decompressed while parsing
+    uint64_t records = 0;           // Records scanned, stored or not (the next row id)
+    size_t files_loaded = 0;        // Files of a multi-file table that were parsed
+    size_t files_skipped = 0;       // Files whose statistics rule out every row
+    size_t partitions_pruned = 0;   // Partition directories ruled out by key=value
+    uint64_t memory_bytes = 0;      // Table storage (cells, row ids, dictionaries) in memory at the end
+    uint64_t memory_peak_bytes = 0; // Most table storage in memory at once, parse buffers excluded
+    uint64_t spilled_bytes = 0;     // Column storage in the spill file at the end
+    size_t columns_spilled = 0;     // Columns moved to the spill file
+};
 
 class CSVLoader {
 public:
-    CSVLoader(const std::string& filename);
+    // The filename may also name a multi-file table: a directory (its .csv,
+    // .csv.gz and .csv.zst files) or a glob pattern. Its files must share one
+    // header; they are read in name order and row ids run on from one file to
+    // the next. load() and batches skip files whose <csv>.stats sidecar shows
+    // that no row can pass the pushed-down predicates; load() writes the
+    // statistics of the predicate columns when they are missing.
+    // key=value directories (e.g. date=2026-10-01/region=eu/) add virtual
+    // columns after the CSV columns, typed from their directory values;
+    // predicates on them prune whole directories before a file below is opened. Row ids
+    // only count the files left after pruning.
+    CSVLoader(const std::string& filename, const CSVLoadOptions& options = CSVLoadOptions());
+    ~CSVLoader();
     bool load();
+
+    // Tail mode for append-only files: after load(), parse only the records
+    // appended since and add them to the table. Falls back to a full load()
+    // when the consumed prefix changed (size or checksum), the last load ended
+    // in an unterminated record, a new cell does not fit its column type, the
+    // column types could change with the new records (the file held fewer
+    // than schema_sample_rows records), or the table came from the cache, batches, compressed input or several
+    // files. A partial record at the end of the file is left for the next
+    // refresh. Stats cover the appended rows.
+    bool refresh();
+
+    // Streaming mode, used instead of load() for files larger than memory:
+    // openBatches reads the headers, then each nextBatch replaces the table
+    // with the next batch_rows rows (fewer at the end of the file). Column
+    // types are sampled once by openBatches, as load() samples them, and every
+    // batch is converted to them.
+    bool openBatches(size_t batch_rows);
+    // Returns false once the file is exhausted, or on a read error
+    bool nextBatch();
+
+    // Point lookup mode, used instead of load() when the matching row ids are
+    // already known (e.g. B-tree hits): seek to each row through the row
+    // offset index <csv>.rowidx, built on first use, and parse only those
+    // records. Rows are stored in row id order and typed as load() would type
+    // them, from the leading records of the file. Compressed files and multi-file tables cannot be
+    // seeked into and fail.
+    bool loadRows(const std::vector<uint64_t>& row_ids);
+
+    // Columnar storage of the loaded rows (the current batch when streaming)
+    const ColumnTable& getTable() const;
+    // Map-based compatibility view, materialized from the table on first use
+    // and counted in the memory budget while it is held
     const std::vector<std::unordered_map<std::string, std::string>>& getData() const;
     const std::vector<std::string>& getHeaders() const;
+    const CSVLoadStats& getStats() const { return stats_; }
     
-    // New methods
+    // Request a B-tree index on a column; keys are typed from the inferred schema
     bool createIndex(const std::string& column);
     std::shared_ptr<BTree> getIndex(const std::string& column) const;
-    
+    // Fetch only the rows whose column equals key: search the saved B-tree
+    // <column>.btree and read its hits through loadRows()
+    bool loadIndexedRows(const std::string& column, const KeyValue& key);
+
 private:
+    // Insert the loaded rows into the requested indexes and save them
+    void buildIndexes();
+    // Loader of one file of a multi-file table, charging the table's budget,
+    // matching pushed-down predicates with the table's schema and leaving its
+    // columns as text for the table to type
+    CSVLoader(const std::string& filename, const CSVLoadOptions& options, std::shared_ptr<MemoryBudget> budget,
+              const TableSchema* schema);
+
+    // A pushed-down predicate on a CSV field
+    struct FieldPredicate {
+        size_t field;
+        const ScanPredicate* predicate;
+        const ColumnType* type;             // Type of the field's column, null if not sampled
+    };
+
+    // Outcome of parsing one byte range
+    struct ParseResult {
+        uint64_t records = 0;           // Records scanned, stored or not
+        uint64_t bytes_skipped = 0;
+        uint64_t rows_filtered = 0;
+    };
+
+    // Position reached in the file by the last load or refresh
+    struct TailState {
+        uint64_t bytes = 0;                 // Bytes consumed
+        uint64_t records = 0;               // Records consumed (the next row id)
+        uint64_t checksum = 0;              // Hash of the first and last bytes consumed
+        bool terminated = false;            // Consumed bytes end in a record delimiter
+    };
+
+    // Reader state between nextBatch calls
+    struct BatchState {
+        std::vector<TableFile> files;       // Files of the table, one for a single CSV
+        bool multi_file = false;            // The table is a directory or glob
+        size_t next_file = 0;               // Next file to open
+        size_t current_file = 0;            // File the reader is on
+        bool failed = false;                // A file could not be opened or read
+        std::unique_ptr<BlockReader> reader;
+        std::vector<char> buffer;
+        size_t begin = 0;                   // Unparsed bytes are buffer[begin, filled)
+        size_t filled = 0;
+        bool at_eof = false;
+        uint64_t records = 0;               // Records consumed (the next row id)
+        size_t batch_rows = 0;
+    };
+
+    // Drop the table, headers and batch state of a previous load
+    void reset();
+    // Type the columns from the leading records of the table (see
+    // CSVLoadOptions::schema_sample_rows), read as text in a pass of their
+    // own; the partition keys that are not CSV columns take the given types.
+    // Keeps the schema of a file of a multi-file table. False on a read error.
+    bool sampleSchema(const TableSchema& partition_types);
+    // Type a column has once loaded; null if it was not sampled
+    const ColumnType* schemaType(const std::string& column) const;
+    // Spill columns of the table while it is over the memory budget
+    void enforceBudget();
+    // Copy the budget's current, peak and spilled bytes into the stats
+    void recordMemoryStats();
+    // Remember the consumed prefix for refresh()
+    void rememberTail(uint64_t records, uint64_t bytes);
+    // Checksum of the first and last 64 KiB of [0, bytes)
+    bool tailChecksum(std::ifstream& file, uint64_t bytes, uint64_t& checksum, bool& terminated) const;
+    // Append the cells of a freshly parsed table to table_ in its column
+    // types; false (and table_ unchanged) if a cell does not fit
+    bool appendConformed(ColumnTable& delta);
+    // Open the file for block reads, decompressing gzip or zstd input;
+    // null (and logged) on failure
+    std::unique_ptr<BlockReader> openReader(const std::string& filename);
+    // Open the next file of the batch table that its statistics do not rule
+    // out and read its headers; false at the end of the table or on an error
+    // (logged, and the batch state marked failed)
+    bool openBatchFile();
+    // Append the next block of the file to the batch buffer
+    void readBatchBlock();
+    // Load every file of a multi-file table on a thread pool and concatenate them
+    bool loadFiles();
+    // Headers of a multi-file table whose files were all pruned: from the
+    // statistics or the header record of its first file
+    bool readPrunedHeaders();
+    // Append rows cells of the file's partition values to the partition columns
+    void appendPartitionCells(ColumnTable& table, const TableFile& file, size_t rows) const;
+    // Parse the CSV (stream or mapped) and finalize the columns
+    bool loadParsed();
+    bool loadCached();
+    bool loadStream();
+    bool loadMapped();
+    // Infer the types of the columns the schema does not give (which were
+    // parsed as text) and dictionary-encode low-cardinality STRING columns
+    void finalizeColumns();
+    void finalizeColumn(size_t idx);
+    // Split the header record in [begin, end) into headers_ and map the
+    // fields to table columns
+    void parseHeaders(const char* begin, const char* end);
+    // Map headers_ to table columns and predicates to fields, then append
+    // the partition keys that are not CSV columns to headers_
+    void mapHeaders();
+    // Whether a CSV column is stored in the table
+    bool isRequired(const std::string& header) const;
+    // Add one column per required header to an empty table, of its type in
+    // the schema (STRING if it has none)
+    void initColumns(ColumnTable& table, bool reference_mapping) const;
+    // Parse the records in [begin, end) into table, each cell straight into
+    // the storage of its column's type; row ids start at first_row
+    ParseResult parseRange(const char* begin, const char* end, ColumnTable& table,
+                           bool reference_mapping, uint64_t first_row) const;
+    // Check the pushed-down predicates against the cells of one record
+    bool recordMatches(const std::vector<std::string_view>& cells, size_t num_cells, std::string& scratch) const;
+    // Drop the compatibility view and its bytes from the budget
+    void clearData() const;
+
     std::string filename_;
-    std::vector<std::unordered_map<std::string, std::string>> data_;
+    CSVLoadOptions options_;
+    CSVLoadStats stats_;
+    std::shared_ptr<MemoryBudget> budget_;  // Allocates the column storage; outlives table_
+    bool owns_budget_;                      // False for the file loaders of a multi-file table
+    ColumnTable table_;
     std::vector<std::string> headers_;
+    std::vector<int> field_columns_;   // Table column of each CSV field, -1 if skipped
+    std::vector<FieldPredicate> field_predicates_;
+    TableSchema schema_;
+    bool table_schema_;                         // schema_ is the multi-file table's, not sampled here; columns stay text
+    bool schema_final_;                         // Records appended to the file cannot change schema_
+    std::vector<std::string> partition_keys_;   // Partition keys of a multi-file table
+    std::vector<int> partition_columns_;        // Table column of each partition key, -1 if skipped
+    std::shared_ptr<MappedFile> mapping_;
+    std::unique_ptr<BatchState> batch_;
+    std::unique_ptr<TailState> tail_;
+    CSVScanner scanner_;
+    mutable std::vector<std::unordered_map<std::string, std::string>> data_;
+    mutable bool data_materialized_;
     
+    // Columns requested through createIndex()
+    std::vector<std::string> index_columns_;
     // Map of column name to B-tree index
     std::unordered_map<std::string, std::shared_ptr<BTree>> indexes_;
+    mutable size_t data_bytes_;                 // Bytes of data_ reserved in budget_
 };
 
 #endif // CSVLOADER_H
@@ -0,0 +1,174 @@
+// CSVScanner.h
+#ifndef CSVSCANNER_H
+#define CSVSCANNER_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bitmaps of the structural characters in one 64-byte block (bit i = byte i)
+struct StructuralMasks {
+    uint64_t field;     // ',' field delimiters
+    uint64_t record;    // '\n' record delimiters
+    uint64_t quote;     // '"' quote characters
+};
+
+// Block scanning implementations, chosen at runtime
+enum class ScannerKernel {
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+// Vectorized RFC 4180 structural scanner used as the CSV tokenizer.
+// Delimiters inside quoted fields are masked out with a prefix-XOR of the
+// quote bitmap, so quoted commas and line breaks cost no more than plain text.
+class CSVScanner {
+public:
+    static const size_t BLOCK_SIZE = 64;
+
+    // Defaults to the best kernel the running CPU supports
+    CSVScanner();
+    explicit CSVScanner(ScannerKernel kernel);
+
+    // Best kernel supported by the running CPU
+    static ScannerKernel detectKernel();
+    // Whether the running CPU can execute the given kernel
+    static bool isSupported(ScannerKernel kernel);
+    static const char* kernelName(ScannerKernel kernel);
+
+    ScannerKernel getKernel() const { return kernel_; }
+
+    // Scan exactly BLOCK_SIZE bytes (raw masks, quotes not yet applied)
+    StructuralMasks scanBlock(const char* block) const { return scan_(block); }
+
+    // Walk the records in [begin, end), which must start outside quotes.
+    // on_field(cell_begin, cell_end) is called for every ','-terminated cell
+    // and on_record(cell_begin, cell_end) for the cell that ends each record
+    // (possibly empty). Cells are raw: quoted cells still carry their quotes.
+    template <typename FieldFn, typename RecordFn>
+    void tokenize(const char* begin, const char* end, FieldFn&& on_field, RecordFn&& on_record) const;
+
+    // Call on_record_end(pos) with the position just after every record
+    // delimiter in [begin, end), which must start outside quotes
+    template <typename RecordEndFn>
+    void forEachRecordEnd(const char* begin, const char* end, RecordEndFn&& on_record_end) const;
+
+    // Number of '"' characters in [begin, end)
+    size_t countQuotes(const char* begin, const char* end) const;
+
+    // Position just after the first record delimiter at or after begin that
+    // is outside quotes, given the quote state at begin; end if there is none
+    const char* findRecordStart(const char* begin, const char* end, bool in_quotes) const;
+
+    // Position just after the last record delimiter in [begin, end), which
+    // must start outside quotes; begin if there is none
+    const char* findLastRecordEnd(const char* begin, const char* end) const;
+
+    // Position just after the count-th record delimiter in [begin, end), which
+    // must start outside quotes. If fewer records end in the range, count is
+    // lowered to the number found and end is returned.
+    const char* findRecordEnd(const char* begin, const char* end, size_t& count) const;
+
+    // Strip the quotes of a quoted cell and collapse escaped "" pairs. Returns
+    // a view into the cell when no unescaping is needed, else into scratch.
+    static std::string_view decodeCell(const char* cell_begin, const char* cell_end, std::string& scratch);
+
+private:
+    // Masks of a block that may be shorter than BLOCK_SIZE, with quoted
+    // delimiters cleared. in_quotes carries the quote state between blocks.
+    StructuralMasks scanQuoted(const char* block, size_t length, uint64_t& in_quotes) const;
+
+    ScannerKernel kernel_;
+    StructuralMasks (*scan_)(const char*);
+};
+
+// Read one CSV record from a stream, joining physical lines while a quoted
+// field is still open. The record delimiter is not included.
+bool readCSVRecord(std::istream& in, std::string& record);
+
+// Split one record into decoded cells
+std::vector<std::string> splitCSVRecord(std::string_view record);
+
+// Prefix XOR: bit i of the result is the parity of bits 0..i of x
+inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+inline StructuralMasks CSVScanner::scanQuoted(const char* block, size_t length, uint64_t& in_quotes) const {
+    StructuralMasks masks;
+    if (length >= BLOCK_SIZE) {
+        masks = scan_(block);
+    }
+    else {
+        // Pad the tail block; the padding bytes never match
+        char padded[BLOCK_SIZE] = {};
+        memcpy(padded, block, length);
+        masks = scan_(padded);
+    }
+    if (masks.quote != 0 || in_quotes != 0) {
+        // Bits inside a quoted region (opening quote included, closing excluded)
+        uint64_t inside = prefixXor(masks.quote) ^ in_quotes;
+        masks.field &= ~inside;
+        masks.record &= ~inside;
+        in_quotes = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+    }
+    return masks;
+}
+
+template <typename FieldFn, typename RecordFn>
+void CSVScanner::tokenize(const char* begin, const char* end, FieldFn&& on_field, RecordFn&& on_record) const {
+    const char* cell = begin;
+    const char* record_start = begin;
+    uint64_t in_quotes = 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        StructuralMasks masks = scanQuoted(block, end - block, in_quotes);
+        uint64_t bits = masks.field | masks.record;
+        while (bits != 0) {
+            int i = __builtin_ctzll(bits);
+            const char* pos = block + i;
+            if ((masks.record >> i) & 1) {
+                // RFC 4180 records end in CRLF; drop the CR
+                const char* cell_end = (pos > cell && pos[-1] == '\r') ? pos - 1 : pos;
+                on_record(cell, cell_end);
+                record_start = pos + 1;
+            }
+            else {
+                on_field(cell, pos);
+            }
+            cell = pos + 1;
+            bits &= bits - 1;
+        }
+    }
+    // Final record without a trailing newline
+    if (record_start < end) {
+        on_record(cell, end);
+    }
+}
+
+template <typename RecordEndFn>
+void CSVScanner::forEachRecordEnd(const char* begin, const char* end, RecordEndFn&& on_record_end) const {
+    uint64_t in_quotes = 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        size_t length = end - block;
+        uint64_t records = scanQuoted(block, length, in_quotes).record;
+        if (length < BLOCK_SIZE) {
+            records &= (uint64_t(1) << length) - 1;
+        }
+        while (records != 0) {
+            on_record_end(block + __builtin_ctzll(records) + 1);
+            records &= records - 1;
+        }
+    }
+}
+
+#endif // CSVSCANNER_H
@@ -0,0 +1,455 @@
+// ColumnCache.cpp
+#include "ColumnCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+
+// File layout (native endianness, every section padded to 8 bytes):
+//   CacheHeader
+//   row ids                    uint64[num_rows]
+//   per column:
+//     name length, type        uint32, uint32 (type | DICTIONARY_FLAG if encoded)
+//     name                     char[name length]
+//     missing flags            uint8[num_rows]
+//     kept source texts        uint64 count, uint64 rows[count], then the
+//                              texts laid out as STRING
+//     INT64                    int64[num_rows]
+//     DOUBLE                   double[num_rows]
+//     BOOL                     uint8[num_rows]
+//     STRING                   uint64 offsets[num_rows], uint32 lengths[num_rows],
+//                              uint64 blob size, char blob[blob size]
+//     encoded STRING           uint32 codes[num_rows], uint64 dictionary size,
+//                              then the dictionary values laid out as STRING
+static const char CACHE_MAGIC[8] = { 'C', 'S', 'V', 'C', 'A', 'C', 'H', 'E' };
+static const uint32_t CACHE_VERSION = 4;
+static const uint32_t DICTIONARY_FLAG = 0x100;
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t infer_schema;
+    uint64_t sample_rows;
+    uint64_t dictionary_max_entries;
+    CSVFingerprint fingerprint;
+    uint64_t num_rows;
+    uint64_t num_columns;
+};
+
+static size_t padded(size_t size) {
+    return (size + 7) & ~size_t(7);
+}
+
+// 8 bytes per step
+uint64_t hashBytes(const char* data, size_t size) {
+    const uint64_t prime = 0x9E3779B97F4A7C15ull;
+    uint64_t hash = size * prime;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    if (i < size) {
+        memcpy(&tail, data + i, size - i);
+    }
+    hash = (hash ^ tail) * prime;
+    return hash ^ (hash >> 32);
+}
+
+ColumnCache::ColumnCache(const std::string& csv_filename)
+    : csv_filename_(csv_filename), cache_path_(csv_filename + ".colcache") {}
+
+bool ColumnCache::fingerprint() {
+    struct stat st;
+    if (stat(csv_filename_.c_str(), &st) != 0) {
+        return false;
+    }
+    fingerprint_.size = static_cast<uint64_t>(st.st_size);
+    fingerprint_.mtime_sec = static_cast<int64_t>(st.st_mtim.tv_sec);
+    fingerprint_.mtime_nsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+    fingerprint_.content_hash = 0;
+    hashed_ = false;
+    return true;
+}
+
+bool ColumnCache::hashContents() {
+    if (hashed_) {
+        return true;
+    }
+    MappedFile csv;
+    if (!csv.open(csv_filename_)) {
+        return false;
+    }
+    fingerprint_.content_hash = hashBytes(csv.data(), csv.size());
+    hashed_ = true;
+    return true;
+}
+
+// Bounds-checked reader over the mapped cache
+class CacheCursor {
+public:
+    CacheCursor(const char* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+    // Claim the next bytes (padded to 8); nullptr if the file is too short
+    const char* take(size_t bytes) {
+        if (bytes > size_ - pos_) {
+            return nullptr;
+        }
+        const char* result = data_ + pos_;
+        pos_ = std::min(size_, pos_ + padded(bytes));
+        return result;
+    }
+    size_t offset(const char* p) const { return p - data_; }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+// Claim a STRING section of count values; nullptr if it is truncated or corrupt
+static const char* takeStrings(CacheCursor& cursor, size_t count, const uint64_t*& offsets,
+                               const uint32_t*& lengths) {
+    offsets = reinterpret_cast<const uint64_t*>(cursor.take(count * sizeof(uint64_t)));
+    lengths = reinterpret_cast<const uint32_t*>(cursor.take(count * sizeof(uint32_t)));
+    const uint64_t* blob_size = reinterpret_cast<const uint64_t*>(cursor.take(sizeof(uint64_t)));
+    if (offsets == nullptr || lengths == nullptr || blob_size == nullptr) {
+        return nullptr;
+    }
+    const char* blob = cursor.take(*blob_size);
+    for (size_t i = 0; blob != nullptr && i < count; ++i) {
+        if (offsets[i] + lengths[i] > *blob_size) {
+            return nullptr;
+        }
+    }
+    return blob;
+}
+
+bool ColumnCache::read(ColumnTable& table, std::vector<std::string>& headers,
+                       const std::function<bool(const std::string&)>& keep_column,
+                       bool infer_schema, size_t sample_rows, size_t dictionary_max_entries) {
+    struct stat st;
+    if (stat(cache_path_.c_str(), &st) != 0) {
+        return false;
+    }
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->open(cache_path_)) {
+        return false;
+    }
+
+    CacheCursor cursor(mapping->data(), mapping->size());
+    CacheHeader header;
+    const char* p = cursor.take(sizeof(header));
+    if (p == nullptr) {
+        return false;
+    }
+    memcpy(&header, p, sizeof(header));
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.infer_schema != (infer_schema ? 1u : 0u) || header.sample_rows != sample_rows ||
+        header.dictionary_max_entries != dictionary_max_entries ||
+        header.fingerprint.size != fingerprint_.size ||
+        header.fingerprint.mtime_sec != fingerprint_.mtime_sec ||
+        header.fingerprint.mtime_nsec != fingerprint_.mtime_nsec) {
+        return false;
+    }
+    // Size and mtime rule out most stale caches without reading the CSV; the
+    // hash catches a rewrite of the same size within one mtime tick
+    if (!hashContents() || header.fingerprint.content_hash != fingerprint_.content_hash) {
+        return false;
+    }
+
+    // Every row takes at least one missing flag byte per column and an 8-byte row id
+    if (header.num_rows > mapping->size() / sizeof(uint64_t) || header.num_columns > mapping->size()) {
+        return false;
+    }
+    const size_t rows = header.num_rows;
+    const uint64_t* row_ids = reinterpret_cast<const uint64_t*>(cursor.take(rows * sizeof(uint64_t)));
+    if (row_ids == nullptr) {
+        return false;
+    }
+
+    ColumnTable result(table.getResource());
+    result.reserve(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        result.appendRowId(row_ids[row]);
+    }
+    std::vector<std::string> names;
+    for (uint64_t c = 0; c < header.num_columns; ++c) {
+        const uint32_t* meta = reinterpret_cast<const uint32_t*>(cursor.take(2 * sizeof(uint32_t)));
+        if (meta == nullptr) {
+            return false;
+        }
+        bool encoded = (meta[1] & DICTIONARY_FLAG) != 0;
+        uint32_t type_id = meta[1] & ~DICTIONARY_FLAG;
+        if (type_id > static_cast<uint32_t>(ColumnType::STRING) ||
+            (encoded && type_id != static_cast<uint32_t>(ColumnType::STRING))) {
+            return false;
+        }
+        const char* name = cursor.take(meta[0]);
+        const uint8_t* missing = reinterpret_cast<const uint8_t*>(cursor.take(rows));
+        const uint64_t* text_count = reinterpret_cast<const uint64_t*>(cursor.take(sizeof(uint64_t)));
+        if (name == nullptr || missing == nullptr || text_count == nullptr || *text_count > rows) {
+            return false;
+        }
+        const uint64_t* text_rows = reinterpret_cast<const uint64_t*>(cursor.take(*text_count * sizeof(uint64_t)));
+        const uint64_t* text_offsets;
+        const uint32_t* text_lengths;
+        const char* texts = takeStrings(cursor, *text_count, text_offsets, text_lengths);
+        if (text_rows == nullptr || texts == nullptr) {
+            return false;
+        }
+        names.emplace_back(name, meta[0]);
+        ColumnType type = static_cast<ColumnType>(type_id);
+        bool keep = keep_column(names.back());
+
+        Column column(names.back(), type, table.getResource());
+        if (keep) {
+            column.reserve(rows);
+        }
+        switch (type) {
+            case ColumnType::INT64: {
+                const char* values = cursor.take(rows * sizeof(int64_t));
+                if (values == nullptr) {
+                    return false;
+                }
+                for (size_t row = 0; keep && row < rows; ++row) {
+                    int64_t value;
+                    memcpy(&value, values + row * sizeof(int64_t), sizeof(value));
+                    missing[row] ? column.appendMissing() : column.appendInt(value);
+                }
+                break;
+            }
+            case ColumnType::DOUBLE: {
+                const char* values = cursor.take(rows * sizeof(double));
+                if (values == nullptr) {
+                    return false;
+                }
+                for (size_t row = 0; keep && row < rows; ++row) {
+                    double value;
+                    memcpy(&value, values + row * sizeof(double), sizeof(value));
+                    missing[row] ? column.appendMissing() : column.appendDouble(value);
+                }
+                break;
+            }
+            case ColumnType::BOOL: {
+                const uint8_t* values = reinterpret_cast<const uint8_t*>(cursor.take(rows));
+                if (values == nullptr) {
+                    return false;
+                }
+                for (size_t row = 0; keep && row < rows; ++row) {
+                    missing[row] ? column.appendMissing() : column.appendBool(values[row] != 0);
+                }
+                break;
+            }
+            case ColumnType::STRING: {
+                if (encoded) {
+                    const uint32_t* codes = reinterpret_cast<const uint32_t*>(cursor.take(rows * sizeof(uint32_t)));
+                    const uint64_t* dictionary_size = reinterpret_cast<const uint64_t*>(cursor.take(sizeof(uint64_t)));
+                    if (codes == nullptr || dictionary_size == nullptr || *dictionary_size > mapping->size()) {
+                        return false;
+                    }
+                    const uint64_t* offsets;
+                    const uint32_t* lengths;
+                    const char* blob = takeStrings(cursor, *dictionary_size, offsets, lengths);
+                    if (blob == nullptr) {
+                        return false;
+                    }
+                    if (!keep) {
+                        break;
+                    }
+                    // Values were written in code order, so interning restores the codes
+                    auto dictionary = std::make_shared<StringDictionary>(table.getResource());
+                    for (uint64_t code = 0; code < *dictionary_size; ++code) {
+                        dictionary->intern(std::string_view(blob + offsets[code], lengths[code]));
+                    }
+                    if (dictionary->size() != *dictionary_size) {
+                        return false;
+                    }
+                    column.setDictionary(dictionary);
+                    column.reserve(rows);
+                    for (size_t row = 0; row < rows; ++row) {
+                        if (codes[row] >= *dictionary_size) {
+                            return false;
+                        }
+                        // A missing cell was stored as the code of "", so this adds no value
+                        missing[row] ? column.appendMissing() : column.appendCode(codes[row]);
+                    }
+                    break;
+                }
+                const uint64_t* offsets;
+                const uint32_t* lengths;
+                const char* blob = takeStrings(cursor, rows, offsets, lengths);
+                if (blob == nullptr) {
+                    return false;
+                }
+                if (!keep) {
+                    break;
+                }
+                // Cells are views into the mapped blob
+                column.setExternalStrings(mapping);
+                uint64_t base = cursor.offset(blob);
+                for (size_t row = 0; row < rows; ++row) {
+                    if (missing[row]) {
+                        column.appendMissing();
+                    }
+                    else {
+                        column.appendStringRef(base + offsets[row], lengths[row]);
+                    }
+                }
+                break;
+            }
+        }
+        if (keep) {
+            for (uint64_t i = 0; i < *text_count; ++i) {
+                if (text_rows[i] >= rows || (i > 0 && text_rows[i] <= text_rows[i - 1])) {
+                    return false;
+                }
+                column.keepText(text_rows[i], std::string_view(texts + text_offsets[i], text_lengths[i]));
+            }
+            result.addColumn(std::move(column));
+        }
+    }
+
+    table = std::move(result);
+    headers = std::move(names);
+    return true;
+}
+
+// Write helpers; every section is padded to 8 bytes
+static void writeBytes(std::ofstream& out, const void* data, size_t size) {
+    static const char zeros[8] = {};
+    out.write(static_cast<const char*>(data), size);
+    out.write(zeros, padded(size) - size);
+}
+
+// Write count strings as offsets, lengths and one blob
+template <typename GetString>
+static void writeStrings(std::ofstream& out, size_t count, GetString get) {
+    std::vector<uint64_t> offsets(count);
+    std::vector<uint32_t> lengths(count);
+    std::string blob;
+    for (size_t i = 0; i < count; ++i) {
+        std::string_view value = get(i);
+        offsets[i] = blob.size();
+        lengths[i] = static_cast<uint32_t>(value.size());
+        blob.append(value.data(), value.size());
+    }
+    uint64_t blob_size = blob.size();
+    writeBytes(out, offsets.data(), count * sizeof(uint64_t));
+    writeBytes(out, lengths.data(), count * sizeof(uint32_t));
+    writeBytes(out, &blob_size, sizeof(blob_size));
+    writeBytes(out, blob.data(), blob.size());
+}
+
+bool ColumnCache::write(const ColumnTable& table, bool infer_schema, size_t sample_rows,
+                        size_t dictionary_max_entries) {
+    if (!hashContents()) {
+        return false;
+    }
+    std::string tmp_path = cache_path_ + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file for writing: " << tmp_path << std::endl;
+        return false;
+    }
+
+    const size_t rows = table.numRows();
+    CacheHeader header = CacheHeader();
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.infer_schema = infer_schema ? 1 : 0;
+    header.sample_rows = sample_rows;
+    header.dictionary_max_entries = dictionary_max_entries;
+    header.fingerprint = fingerprint_;
+    header.num_rows = rows;
+    header.num_columns = table.numColumns();
+    writeBytes(out, &header, sizeof(header));
+    writeBytes(out, table.getRowIds().data(), rows * sizeof(uint64_t));
+
+    for (size_t c = 0; c < table.numColumns(); ++c) {
+        const Column& column = table.getColumn(c);
+        uint32_t meta[2] = { static_cast<uint32_t>(column.getName().size()),
+                             static_cast<uint32_t>(column.getType()) |
+                                 (column.isDictionaryEncoded() ? DICTIONARY_FLAG : 0) };
+        writeBytes(out, meta, sizeof(meta));
+        writeBytes(out, column.getName().data(), column.getName().size());
+        std::vector<uint8_t> missing(rows);
+        for (size_t row = 0; row < rows; ++row) {
+            missing[row] = column.isMissing(row) ? 1 : 0;
+        }
+        writeBytes(out, missing.data(), rows);
+        std::vector<uint64_t> text_rows(column.keptTextCount());
+        for (size_t i = 0; i < text_rows.size(); ++i) {
+            text_rows[i] = column.keptTextRow(i);
+        }
+        uint64_t text_count = text_rows.size();
+        writeBytes(out, &text_count, sizeof(text_count));
+        writeBytes(out, text_rows.data(), text_rows.size() * sizeof(uint64_t));
+        writeStrings(out, text_rows.size(), [&](size_t i) { return column.keptTextAt(i); });
+
+        switch (column.getType()) {
+            case ColumnType::INT64: {
+                std::vector<int64_t> values(rows);
+                for (size_t row = 0; row < rows; ++row) {
+                    values[row] = column.getInt(row);
+                }
+                writeBytes(out, values.data(), rows * sizeof(int64_t));
+                break;
+            }
+            case ColumnType::DOUBLE: {
+                std::vector<double> values(rows);
+                for (size_t row = 0; row < rows; ++row) {
+                    values[row] = column.getDouble(row);
+                }
+                writeBytes(out, values.data(), rows * sizeof(double));
+                break;
+            }
+            case ColumnType::BOOL: {
+                std::vector<uint8_t> values(rows);
+                for (size_t row = 0; row < rows; ++row) {
+                    values[row] = column.getBool(row) ? 1 : 0;
+                }
+                writeBytes(out, values.data(), rows);
+                break;
+            }
+            case ColumnType::STRING: {
+                if (column.isDictionaryEncoded()) {
+                    std::shared_ptr<const StringDictionary> dictionary = column.getDictionary();
+                    std::vector<uint32_t> codes(rows);
+                    for (size_t row = 0; row < rows; ++row) {
+                        codes[row] = column.getCode(row);
+                    }
+                    uint64_t dictionary_size = dictionary->size();
+                    writeBytes(out, codes.data(), rows * sizeof(uint32_t));
+                    writeBytes(out, &dictionary_size, sizeof(dictionary_size));
+                    writeStrings(out, dictionary->size(), [&](size_t code) { return dictionary->get(code); });
+                    break;
+                }
+                // Cells may live in an arena or an external mapping; write them as one blob
+                writeStrings(out, rows, [&](size_t row) { return column.getString(row); });
+                break;
+            }
+        }
+    }
+
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write cache file: " << tmp_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    // Readers never see a partially written cache
+    if (std::rename(tmp_path.c_str(), cache_path_.c_str()) != 0) {
+        std::cerr << "Failed to replace cache file: " << cache_path_ << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,61 @@
+// ColumnCache.h
+#ifndef COLUMNCACHE_H
+#define COLUMNCACHE_H
+
+#include "ColumnTable.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Identity of a CSV file; a cache built from different contents is stale
+struct CSVFingerprint {
+    uint64_t size = 0;
+    int64_t mtime_sec = 0;
+    int64_t mtime_nsec = 0;
+    uint64_t content_hash = 0;
+};
+
+// 64-bit hash of a byte range, as used for CSV fingerprints
+uint64_t hashBytes(const char* data, size_t size);
+
+// Binary columnar sidecar cache of a parsed CSV, stored next to it as
+// <csv>.colcache. It holds the schema, row ids and typed cells of every
+// column, so a repeat load maps the file instead of re-parsing the CSV.
+class ColumnCache {
+public:
+    explicit ColumnCache(const std::string& csv_filename);
+
+    const std::string& getPath() const { return cache_path_; }
+
+    // Stat the CSV; must succeed before read() or write(). The contents are
+    // hashed only when they have to be: by read() once the cache's size and
+    // mtime match, and by write(). Hashing reads the whole CSV: on a 100 MB
+    // file it takes about a quarter of a hit and a thirtieth of a parse.
+    bool fingerprint();
+    const CSVFingerprint& getFingerprint() const { return fingerprint_; }
+
+    // Map the cache into table, keeping the columns accepted by keep_column;
+    // headers receives every cached column name. STRING cells stay views into
+    // the mapping and dictionary-encoded columns get their dictionary back.
+    // Returns false if the cache is missing, stale, built with other schema
+    // settings, or corrupt.
+    bool read(ColumnTable& table, std::vector<std::string>& headers,
+              const std::function<bool(const std::string&)>& keep_column,
+              bool infer_schema, size_t sample_rows, size_t dictionary_max_entries);
+
+    // Write every column of a fully loaded table (atomically via rename)
+    bool write(const ColumnTable& table, bool infer_schema, size_t sample_rows,
+               size_t dictionary_max_entries);
+
+private:
+    std::string csv_filename_;
+    std::string cache_path_;
+    CSVFingerprint fingerprint_;
+    bool hashed_ = false;           // fingerprint_.content_hash is set
+
+    // Hash the CSV into fingerprint_ unless that was done already
+    bool hashContents();
+};
+
+#endif // COLUMNCACHE_H
@@ -0,0 +1,231 @@
+// ColumnTable.h
+#ifndef COLUMNTABLE_H
+#define COLUMNTABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+class MappedFile;
+
+// Enumeration for column storage types
+enum class ColumnType {
+    INT64,
+    DOUBLE,
+    BOOL,
+    STRING
+};
+
+// Distinct values of a dictionary-encoded STRING column, numbered in order of
+// first appearance. Codes and the views returned by get() stay valid as the
+// dictionary grows. The values and their index are allocated from a memory
+// resource, which must outlive the dictionary.
+class StringDictionary {
+public:
+    explicit StringDictionary(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : values_(resource), codes_(resource) {}
+
+    // Code of a value, adding it if it is new
+    uint32_t intern(std::string_view value);
+    // Code of a value, or -1 if it is not in the dictionary
+    int64_t find(std::string_view value) const;
+    std::string_view get(uint32_t code) const { return values_[code]; }
+    size_t size() const { return values_.size(); }
+
+private:
+    std::pmr::deque<std::pmr::string> values_;
+    std::pmr::unordered_map<std::string_view, uint32_t> codes_;
+};
+
+// Column class holding one contiguous typed vector per column. The cell
+// storage is allocated from a memory resource (the heap by default), which
+// lets a loader account for it and move it out of memory.
+class Column {
+public:
+    Column(const std::string& name, ColumnType type = ColumnType::STRING,
+           std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Append a cell; the value must match the column type
+    void appendInt(int64_t value);
+    void appendDouble(double value);
+    void appendBool(bool value);
+    void appendString(std::string_view value);
+
+    // Reference STRING cells inside an external mapping instead of copying them.
+    // Cells appended with appendString afterwards still go to the owned buffer.
+    void setExternalStrings(std::shared_ptr<const MappedFile> mapping);
+    // Append a STRING cell by its (offset, length) inside the external mapping
+    void appendStringRef(uint64_t offset, uint32_t length);
+
+    // Store STRING cells as codes into a dictionary; the column must be empty.
+    // appendString then interns its value.
+    void setDictionary(std::shared_ptr<StringDictionary> dictionary);
+    // Append a STRING cell by its dictionary code
+    void appendCode(uint32_t code);
+
+    // Append a NULL cell: absent from a short row, or empty in a typed column
+    void appendMissing();
+
+    // Append all cells of another column of the same type and string storage
+    void appendColumn(const Column& other);
+
+    // Keep the source text of an appended cell of a typed column whose value
+    // renders differently (e.g. "1.50", "007", or an empty cell loaded as
+    // NULL), so the compatibility view shows the cell as it was. Rows must be
+    // increasing. A NULL cell with non-empty text is a stray: a cell that is
+    // not a value of the column type, which evaluates as its text would.
+    void keepText(size_t row, std::string_view text);
+    // Kept source text of a cell; false if it has none
+    bool keptText(size_t row, std::string_view& text) const;
+    // Text of a stray cell; false for any other cell
+    bool strayText(size_t row, std::string_view& text) const {
+        return stray_count_ > 0 && isMissing(row) && keptText(row, text) && !text.empty();
+    }
+    size_t strayCount() const { return stray_count_; }
+    // Kept texts in row order
+    size_t keptTextCount() const { return text_rows_.size(); }
+    uint64_t keptTextRow(size_t i) const { return text_rows_[i]; }
+    std::string_view keptTextAt(size_t i) const {
+        size_t begin = i == 0 ? 0 : text_ends_[i - 1];
+        return std::string_view(text_data_.data() + begin, text_ends_[i] - begin);
+    }
+
+    // Typed accessors
+    int64_t getInt(size_t row) const { return ints_[row]; }
+    double getDouble(size_t row) const { return doubles_[row]; }
+    bool getBool(size_t row) const { return bools_[row] != 0; }
+    std::string_view getString(size_t row) const {
+        if (dictionary_) {
+            return dictionary_->get(codes_[row]);
+        }
+        uint64_t offset = string_offsets_[row];
+        const char* base = external_data_;
+        if (base == nullptr || (offset & OWNED_BIT)) {
+            base = string_data_.data();
+            offset &= ~OWNED_BIT;
+        }
+        return std::string_view(base + offset, string_lengths_[row]);
+    }
+    bool isMissing(size_t row) const {
+        return (row >> 6) < validity_.size() && !((validity_[row >> 6] >> (row & 63)) & 1);
+    }
+    // Validity of rows [64 * word, 64 * word + 64), bit set for a present
+    // cell; bits past the last row are set
+    uint64_t validityWord(size_t word) const { return word < validity_.size() ? validity_[word] : ~uint64_t(0); }
+    size_t nullCount() const { return null_count_; }
+
+    // Dictionary encoding (null dictionary for plain STRING storage)
+    bool isDictionaryEncoded() const { return dictionary_ != nullptr; }
+    std::shared_ptr<const StringDictionary> getDictionary() const { return dictionary_; }
+    uint32_t getCode(size_t row) const { return codes_[row]; }
+
+    // Render a cell back to its textual form: its kept source text, if any,
+    // else formatValue
+    std::string toString(size_t row) const;
+    // Render the value of a cell in its canonical form
+    std::string formatValue(size_t row) const;
+
+    // Pre-allocate storage for the given number of rows
+    void reserve(size_t rows);
+
+    // Resource the cell storage is allocated from
+    std::pmr::memory_resource* getResource() const { return ints_.get_allocator().resource(); }
+    // Copy the cell storage into another resource (e.g. a spill file) and
+    // release it from the current one; later appends allocate there too.
+    // Dictionaries and external mappings stay where they are.
+    void moveStorage(std::pmr::memory_resource* resource);
+    // Bytes of cell storage allocated (capacity, not size)
+    size_t memoryUsage() const;
+
+    // Getters
+    const std::string& getName() const { return name_; }
+    ColumnType getType() const { return type_; }
+    size_t size() const { return size_; }
+
+private:
+    // Marks an offset into string_data_ in a column backed by an external mapping
+    static const uint64_t OWNED_BIT = uint64_t(1) << 63;
+
+    // Clear the validity bit of a row, growing the bitmap up to it
+    void setNull(size_t row);
+
+    std::string name_;                         // Column name (CSV header)
+    ColumnType type_;                          // Storage type
+    size_t size_;                              // Number of cells
+    std::pmr::vector<int64_t> ints_;           // INT64 values
+    std::pmr::vector<double> doubles_;         // DOUBLE values
+    std::pmr::vector<uint8_t> bools_;          // BOOL values
+    std::pmr::string string_data_;             // Concatenated STRING cell bytes
+    std::pmr::vector<uint64_t> string_offsets_; // Byte offset of each STRING cell
+    std::pmr::vector<uint32_t> string_lengths_; // Byte length of each STRING cell
+    std::shared_ptr<const MappedFile> external_; // Mapping that STRING cells point into, if any
+    const char* external_data_;                // Cached external_->data()
+    std::pmr::vector<uint64_t> validity_;      // Packed validity bits up to the last NULL cell
+    size_t null_count_ = 0;
+    std::shared_ptr<StringDictionary> dictionary_; // Distinct STRING values, if encoded
+    std::pmr::vector<uint32_t> codes_;         // Dictionary code of each cell
+    std::pmr::vector<uint64_t> text_rows_;     // Rows with kept source text, increasing
+    std::pmr::vector<uint64_t> text_ends_;     // End of each kept text in text_data_
+    std::pmr::string text_data_;               // Concatenated kept source texts
+    size_t stray_count_ = 0;                   // NULL cells with non-empty kept text
+};
+
+// ColumnTable class: a set of equally sized columns plus the source row ids
+class ColumnTable {
+public:
+    ColumnTable() = default;
+    // Row ids, and the cells of columns added by name, are allocated from the
+    // given resource
+    explicit ColumnTable(std::pmr::memory_resource* resource) : row_ids_(resource), resource_(resource) {}
+
+    std::pmr::memory_resource* getResource() const { return resource_; }
+
+    // Add a column and return its ordinal
+    size_t addColumn(const std::string& name, ColumnType type = ColumnType::STRING);
+    // Add a filled column; it must hold one cell per row id
+    size_t addColumn(Column&& column);
+
+    // Return the ordinal of a column, or -1 if it does not exist
+    int findColumn(const std::string& name) const;
+
+    // Swap in a converted column; it must keep the same name and row count
+    void replaceColumn(size_t index, Column&& column);
+
+    Column& getColumn(size_t index) { return columns_[index]; }
+    const Column& getColumn(size_t index) const { return columns_[index]; }
+    // Record a use of a column (e.g. a query binding it), for evicting the
+    // least recently used columns first
+    void touchColumn(size_t index) const { last_use_[index] = ++use_clock_; }
+    uint64_t lastUse(size_t index) const { return last_use_[index]; }
+    size_t numColumns() const { return columns_.size(); }
+    size_t numRows() const { return row_ids_.size(); }
+
+    // Row ids are the zero-based data row numbers in the source file
+    void appendRowId(uint64_t row_id) { row_ids_.push_back(row_id); }
+    uint64_t getRowId(size_t row) const { return row_ids_[row]; }
+    const std::pmr::vector<uint64_t>& getRowIds() const { return row_ids_; }
+
+    // Append the rows of a table with the same columns, shifting its row ids
+    void appendTable(const ColumnTable& other, uint64_t row_id_offset);
+
+    // Build the map-based representation of a single row (compatibility view)
+    std::unordered_map<std::string, std::string> materializeRow(size_t row) const;
+
+    void reserve(size_t rows);
+    void clear();
+
+private:
+    std::vector<Column> columns_;
+    std::unordered_map<std::string, size_t> column_index_;
+    std::pmr::vector<uint64_t> row_ids_;
+    std::pmr::memory_resource* resource_ = std::pmr::get_default_resource();
+    mutable std::vector<uint64_t> last_use_;   // use_clock_ at each column's last use, 0 if never
+    mutable uint64_t use_clock_ = 0;
+};
+
+#endif // COLUMNTABLE_H
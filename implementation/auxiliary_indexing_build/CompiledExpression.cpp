@@ -0,0 +1,415 @@
+// CompiledExpression.cpp
+#include "CompiledExpression.h"
+#include <limits>
+
+using Input = CompiledExpression::Input;
+
+static const char* const NON_NUMERIC_ERROR = "Operands must be numeric (int or double) for expressions.";
+
+// Kernel inputs: how one side reads the value of the i-th selected row. IS_INT
+// inputs evaluate as int; CHECK_RANGE ones only while the cell fits in int.
+
+struct IntColumnInput {
+    static constexpr bool IS_INT = true;
+    static constexpr bool CHECK_RANGE = true;
+    const Column& column;
+    IntColumnInput(const Input& input, const ColumnTable& table, const ValueVector*)
+        : column(table.getColumn(input.ordinal)) {}
+    int64_t value(size_t row, size_t) const { return column.getInt(row); }
+    bool nullable() const { return column.nullCount() > 0; }
+    bool isValid(size_t row, size_t) const { return !column.isMissing(row); }
+    const std::string* error(size_t) const { return nullptr; }
+};
+
+struct DoubleColumnInput {
+    static constexpr bool IS_INT = false;
+    static constexpr bool CHECK_RANGE = false;
+    const Column& column;
+    DoubleColumnInput(const Input& input, const ColumnTable& table, const ValueVector*)
+        : column(table.getColumn(input.ordinal)) {}
+    double value(size_t row, size_t) const { return column.getDouble(row); }
+    bool nullable() const { return column.nullCount() > 0; }
+    bool isValid(size_t row, size_t) const { return !column.isMissing(row); }
+    const std::string* error(size_t) const { return nullptr; }
+};
+
+struct IntConstantInput {
+    static constexpr bool IS_INT = true;
+    static constexpr bool CHECK_RANGE = false;
+    int64_t constant;
+    IntConstantInput(const Input& input, const ColumnTable&, const ValueVector*) : constant(input.constant) {}
+    int64_t value(size_t, size_t) const { return constant; }
+    bool nullable() const { return false; }
+    bool isValid(size_t, size_t) const { return true; }
+    const std::string* error(size_t) const { return nullptr; }
+};
+
+struct DoubleConstantInput {
+    static constexpr bool IS_INT = false;
+    static constexpr bool CHECK_RANGE = false;
+    double constant;
+    DoubleConstantInput(const Input& input, const ColumnTable&, const ValueVector*)
+        : constant(input.double_constant) {}
+    double value(size_t, size_t) const { return constant; }
+    bool nullable() const { return false; }
+    bool isValid(size_t, size_t) const { return true; }
+    const std::string* error(size_t) const { return nullptr; }
+};
+
+struct DoubleVectorInput {
+    static constexpr bool IS_INT = false;
+    static constexpr bool CHECK_RANGE = false;
+    const ValueVector& values;
+    DoubleVectorInput(const Input&, const ColumnTable&, const ValueVector* evaluated) : values(*evaluated) {}
+    double value(size_t, size_t i) const { return values.doubles[i]; }
+    bool nullable() const { return !values.validity.empty(); }
+    bool isValid(size_t, size_t i) const { return values.isValid(i); }
+    const std::string* error(size_t i) const { return values.errorAt(i); }
+};
+
+static bool fitsInt(int64_t value) {
+    return value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max();
+}
+
+// Validity and error of any input, for the rows that are not computed
+static bool inputValid(const Input& input, const ColumnTable& table, const ValueVector* values, size_t row, size_t i) {
+    if (input.kind == KernelInput::DOUBLE_VECTOR) {
+        return values->isValid(i);
+    }
+    return input.ordinal < 0 || !table.getColumn(input.ordinal).isMissing(row);
+}
+
+static const std::string* inputError(const Input& input, const ValueVector* values, size_t i) {
+    return input.kind == KernelInput::DOUBLE_VECTOR ? values->errorAt(i) : nullptr;
+}
+
+template <typename Left, typename Right, OperatorType OP>
+static void arithmeticKernel(const Input& left_input, const Input& right_input, const ColumnTable& table,
+                             const SelectionVector& selection, const ValueVector* left_values,
+                             const ValueVector* right_values, ValueVector& out) {
+    Left left(left_input, table, left_values);
+    Right right(right_input, table, right_values);
+    const size_t count = selection.size();
+    out.reset(ValueVector::Type::DOUBLE, count);
+    double* result = out.doubles.data();
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = selection.row(i);
+        double a = static_cast<double>(left.value(row, i));
+        double b = static_cast<double>(right.value(row, i));
+        if constexpr (OP == OperatorType::ADD) {
+            result[i] = a + b;
+        }
+        else if constexpr (OP == OperatorType::SUBTRACT) {
+            result[i] = a - b;
+        }
+        else if constexpr (OP == OperatorType::MULTIPLY) {
+            result[i] = a * b;
+        }
+        else {
+            result[i] = a / b;
+        }
+    }
+    if (!left.nullable() && !right.nullable() && OP != OperatorType::DIVIDE) {
+        return;
+    }
+    // NULL (or a failed operand) takes precedence over division by zero
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = selection.row(i);
+        if (!left.isValid(row, i) || !right.isValid(row, i)) {
+            const std::string* error = left.error(i) ? left.error(i) : right.error(i);
+            if (error) {
+                out.setError(i, *error);
+            }
+            else {
+                out.setNull(i);
+            }
+        }
+        else if (OP == OperatorType::DIVIDE && static_cast<double>(right.value(row, i)) == 0) {
+            out.setError(i, "Division by zero in expression.");
+        }
+    }
+}
+
+// A STRING or BOOL operand: every row with both sides present fails
+static void nonNumericKernel(const Input& left_input, const Input& right_input, const ColumnTable& table,
+                             const SelectionVector& selection, const ValueVector* left_values,
+                             const ValueVector* right_values, ValueVector& out) {
+    const size_t count = selection.size();
+    out.reset(ValueVector::Type::DOUBLE, count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = selection.row(i);
+        const std::string* error = inputError(left_input, left_values, i);
+        if (!error) {
+            error = inputError(right_input, right_values, i);
+        }
+        if (error) {
+            out.setError(i, *error);
+        }
+        else if (!inputValid(left_input, table, left_values, row, i) ||
+                 !inputValid(right_input, table, right_values, row, i)) {
+            out.setNull(i);
+        }
+        else {
+            out.setError(i, NON_NUMERIC_ERROR);
+        }
+    }
+}
+
+template <Comparator CMP, typename T>
+static bool compare(T left, T right) {
+    if constexpr (CMP == Comparator::EQUAL) {
+        return left == right;
+    }
+    else if constexpr (CMP == Comparator::NOT_EQUAL) {
+        return left != right;
+    }
+    else if constexpr (CMP == Comparator::GREATER) {
+        return left > right;
+    }
+    else if constexpr (CMP == Comparator::LESS) {
+        return left < right;
+    }
+    else if constexpr (CMP == Comparator::GREATER_EQUAL) {
+        return left >= right;
+    }
+    else {
+        return left <= right;
+    }
+}
+
+template <typename Left, typename Right, Comparator CMP>
+static void compareKernel(const Input& left_input, const Input& right_input, const ColumnTable& table,
+                          SelectionVector& selection, const ValueVector* left_values, const ValueVector* right_values,
+                          std::vector<RowError>& errors) {
+    Left left(left_input, table, left_values);
+    Right right(right_input, table, right_values);
+    const bool nullable = left.nullable() || right.nullable();
+    size_t kept = 0;
+    for (size_t i = 0; i < selection.size(); ++i) {
+        size_t row = selection.row(i);
+        if (nullable && (!left.isValid(row, i) || !right.isValid(row, i))) {
+            // NULL fails any comparison
+            const std::string* error = left.error(i) ? left.error(i) : right.error(i);
+            if (error) {
+                errors.push_back({ row, *error });
+            }
+            continue;
+        }
+        auto a = left.value(row, i);
+        auto b = right.value(row, i);
+        bool pass;
+        if constexpr (Left::IS_INT && Right::IS_INT) {
+            // An INT64 cell past int range evaluates as double
+            bool ints = (!Left::CHECK_RANGE || fitsInt(a)) && (!Right::CHECK_RANGE || fitsInt(b));
+            pass = ints ? compare<CMP>(a, b) : compare<CMP>(static_cast<double>(a), static_cast<double>(b));
+        }
+        else {
+            // An int against a double compares by value
+            pass = compare<CMP>(static_cast<double>(a), static_cast<double>(b));
+        }
+        if (pass) {
+            selection.offsets[kept++] = selection.offsets[i];
+        }
+    }
+    selection.offsets.resize(kept);
+}
+
+// Kernel selection: one instantiation per (left input, operator, right input)
+
+template <typename Left, typename Right>
+static CompiledExpression::Kernel arithmeticFor(OperatorType op) {
+    switch (op) {
+        case OperatorType::ADD:
+            return &arithmeticKernel<Left, Right, OperatorType::ADD>;
+        case OperatorType::SUBTRACT:
+            return &arithmeticKernel<Left, Right, OperatorType::SUBTRACT>;
+        case OperatorType::MULTIPLY:
+            return &arithmeticKernel<Left, Right, OperatorType::MULTIPLY>;
+        case OperatorType::DIVIDE:
+            return &arithmeticKernel<Left, Right, OperatorType::DIVIDE>;
+        default:
+            return nullptr;
+    }
+}
+
+template <typename Left, typename Right>
+static CompiledComparison::Kernel comparisonFor(Comparator comparator) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+            return &compareKernel<Left, Right, Comparator::EQUAL>;
+        case Comparator::NOT_EQUAL:
+            return &compareKernel<Left, Right, Comparator::NOT_EQUAL>;
+        case Comparator::GREATER:
+            return &compareKernel<Left, Right, Comparator::GREATER>;
+        case Comparator::LESS:
+            return &compareKernel<Left, Right, Comparator::LESS>;
+        case Comparator::GREATER_EQUAL:
+            return &compareKernel<Left, Right, Comparator::GREATER_EQUAL>;
+        case Comparator::LESS_EQUAL:
+            return &compareKernel<Left, Right, Comparator::LESS_EQUAL>;
+        default:
+            return nullptr;
+    }
+}
+
+// Calls Select::template get<Left, Right>(args) for the input types of both sides
+template <typename Select, typename Left, typename Arg>
+static auto selectRight(KernelInput right, Arg arg) -> decltype(Select::template get<Left, IntColumnInput>(arg)) {
+    switch (right) {
+        case KernelInput::INT_COLUMN:
+            return Select::template get<Left, IntColumnInput>(arg);
+        case KernelInput::DOUBLE_COLUMN:
+            return Select::template get<Left, DoubleColumnInput>(arg);
+        case KernelInput::INT_CONSTANT:
+            return Select::template get<Left, IntConstantInput>(arg);
+        case KernelInput::DOUBLE_CONSTANT:
+            return Select::template get<Left, DoubleConstantInput>(arg);
+        case KernelInput::DOUBLE_VECTOR:
+            return Select::template get<Left, DoubleVectorInput>(arg);
+        default:
+            return nullptr;
+    }
+}
+
+template <typename Select, typename Arg>
+static auto selectKernel(KernelInput left, KernelInput right, Arg arg)
+    -> decltype(Select::template get<IntColumnInput, IntColumnInput>(arg)) {
+    switch (left) {
+        case KernelInput::INT_COLUMN:
+            return selectRight<Select, IntColumnInput>(right, arg);
+        case KernelInput::DOUBLE_COLUMN:
+            return selectRight<Select, DoubleColumnInput>(right, arg);
+        case KernelInput::INT_CONSTANT:
+            return selectRight<Select, IntConstantInput>(right, arg);
+        case KernelInput::DOUBLE_CONSTANT:
+            return selectRight<Select, DoubleConstantInput>(right, arg);
+        case KernelInput::DOUBLE_VECTOR:
+            return selectRight<Select, DoubleVectorInput>(right, arg);
+        default:
+            return nullptr;
+    }
+}
+
+struct SelectArithmetic {
+    template <typename Left, typename Right>
+    static CompiledExpression::Kernel get(OperatorType op) { return arithmeticFor<Left, Right>(op); }
+};
+
+struct SelectComparison {
+    template <typename Left, typename Right>
+    static CompiledComparison::Kernel get(Comparator comparator) { return comparisonFor<Left, Right>(comparator); }
+};
+
+bool CompiledExpression::resolveLeaf(const Operand& operand, const ColumnTable& table, Input& input) {
+    if (const ColumnOperand* column = dynamic_cast<const ColumnOperand*>(&operand)) {
+        input.ordinal = column->getOrdinal(table);
+        if (input.ordinal < 0 || table.getColumn(input.ordinal).strayCount() > 0) {
+            // Reported per row as a missing column; stray cells evaluate as
+            // their text, which the kernels do not read
+            return false;
+        }
+        switch (table.getColumn(input.ordinal).getType()) {
+            case ColumnType::INT64:
+                input.kind = KernelInput::INT_COLUMN;
+                break;
+            case ColumnType::DOUBLE:
+                input.kind = KernelInput::DOUBLE_COLUMN;
+                break;
+            default:
+                input.kind = KernelInput::NON_NUMERIC;
+                break;
+        }
+        return true;
+    }
+    if (const IntegerOperand* integer = dynamic_cast<const IntegerOperand*>(&operand)) {
+        input.kind = KernelInput::INT_CONSTANT;
+        input.constant = integer->getValue();
+        return true;
+    }
+    if (const DoubleOperand* constant = dynamic_cast<const DoubleOperand*>(&operand)) {
+        input.kind = KernelInput::DOUBLE_CONSTANT;
+        input.double_constant = constant->getValue();
+        return true;
+    }
+    if (dynamic_cast<const StringOperand*>(&operand) || dynamic_cast<const BooleanOperand*>(&operand)) {
+        input.kind = KernelInput::NON_NUMERIC;
+        return true;
+    }
+    return false;
+}
+
+CompiledExpression::Kernel CompiledExpression::kernelFor(KernelInput left, OperatorType op, KernelInput right) {
+    if (left == KernelInput::NON_NUMERIC || right == KernelInput::NON_NUMERIC) {
+        return &nonNumericKernel;
+    }
+    return selectKernel<SelectArithmetic>(left, right, op);
+}
+
+CompiledComparison::Kernel CompiledComparison::kernelFor(KernelInput left, Comparator comparator, KernelInput right) {
+    // Strings, booleans and IN keep their generic (and dictionary) paths
+    if (left == KernelInput::NON_NUMERIC || right == KernelInput::NON_NUMERIC) {
+        return nullptr;
+    }
+    return selectKernel<SelectComparison>(left, right, comparator);
+}
+
+// Resolve one operand to a kernel input, compiling a nested expression;
+// false if the compiler does not know it
+static bool compileInput(const Operand& operand, const ColumnTable& table, Input& input) {
+    if (CompiledExpression::resolveLeaf(operand, table, input)) {
+        return true;
+    }
+    if (const ExpressionOperand* expression = dynamic_cast<const ExpressionOperand*>(&operand)) {
+        input.child = CompiledExpression::compile(*expression, table);
+        input.kind = KernelInput::DOUBLE_VECTOR;
+        return input.child != nullptr;
+    }
+    return false;
+}
+
+std::unique_ptr<CompiledExpression> CompiledExpression::compile(const ExpressionOperand& expression,
+                                                                const ColumnTable& table) {
+    std::unique_ptr<CompiledExpression> compiled(new CompiledExpression());
+    compiled->op_ = expression.getOperator();
+    if (!compileInput(*expression.getLeft(), table, compiled->left_) ||
+        !compileInput(*expression.getRight(), table, compiled->right_)) {
+        return nullptr;
+    }
+    compiled->kernel_ = kernelFor(compiled->left_.kind, compiled->op_, compiled->right_.kind);
+    return compiled->kernel_ ? std::move(compiled) : nullptr;
+}
+
+void CompiledExpression::evaluateBatch(const ColumnTable& table, const SelectionVector& selection,
+                                       ValueVector& out) const {
+    ValueVector left, right;
+    if (left_.child) {
+        left_.child->evaluateBatch(table, selection, left);
+    }
+    if (right_.child) {
+        right_.child->evaluateBatch(table, selection, right);
+    }
+    kernel_(left_, right_, table, selection, &left, &right, out);
+}
+
+std::unique_ptr<CompiledComparison> CompiledComparison::compile(const Operand& left, Comparator comparator,
+                                                                const Operand& right, const ColumnTable& table) {
+    std::unique_ptr<CompiledComparison> compiled(new CompiledComparison());
+    compiled->comparator_ = comparator;
+    if (!compileInput(left, table, compiled->left_) || !compileInput(right, table, compiled->right_)) {
+        return nullptr;
+    }
+    compiled->kernel_ = kernelFor(compiled->left_.kind, comparator, compiled->right_.kind);
+    return compiled->kernel_ ? std::move(compiled) : nullptr;
+}
+
+void CompiledComparison::filter(const ColumnTable& table, SelectionVector& selection,
+                                std::vector<RowError>& errors) const {
+    ValueVector left, right;
+    if (left_.child) {
+        left_.child->evaluateBatch(table, selection, left);
+    }
+    if (right_.child) {
+        right_.child->evaluateBatch(table, selection, right);
+    }
+    kernel_(left_, right_, table, selection, &left, &right, errors);
+}
@@ -0,0 +1,92 @@
+// CompiledExpression.h
+#ifndef COMPILEDEXPRESSION_H
+#define COMPILEDEXPRESSION_H
+
+#include "Operand.h"
+#include <memory>
+#include <vector>
+
+// Where a compiled kernel reads one side of an operation from
+enum class KernelInput {
+    INT_COLUMN,         // INT64 column cells
+    DOUBLE_COLUMN,      // DOUBLE column cells
+    INT_CONSTANT,       // IntegerOperand
+    DOUBLE_CONSTANT,    // DoubleOperand
+    DOUBLE_VECTOR,      // Result of a compiled sub-expression
+    NON_NUMERIC         // STRING or BOOL column or constant
+};
+
+// Arithmetic over numeric columns, constants and nested expressions,
+// specialized for the column types of the table it was compiled against. The
+// kernel is chosen once by (left input, operator, right input), so evaluating
+// a batch reads the cells straight from the column storage with no per-row
+// type checks. A non-numeric input is known to fail at compile time; its rows
+// still report the error (or NULL) one by one, as evaluate() does.
+class CompiledExpression {
+public:
+    // Compile an ExpressionOperand bound to the table; null if the tree holds
+    // an operand the compiler does not know (it is then evaluated generically)
+    static std::unique_ptr<CompiledExpression> compile(const ExpressionOperand& expression, const ColumnTable& table);
+
+    // Same result as ExpressionOperand::evaluateBatch: a DOUBLE vector
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const;
+
+    // One side of the operation
+    struct Input {
+        KernelInput kind = KernelInput::NON_NUMERIC;
+        int ordinal = -1;                               // Column inputs
+        int64_t constant = 0;                           // INT_CONSTANT
+        double double_constant = 0;                     // DOUBLE_CONSTANT
+        std::unique_ptr<CompiledExpression> child;      // DOUBLE_VECTOR
+    };
+
+    // Evaluates the selected rows of a batch; left and right hold the results
+    // of DOUBLE_VECTOR inputs
+    using Kernel = void (*)(const Input& left_input, const Input& right_input, const ColumnTable& table,
+                            const SelectionVector& selection, const ValueVector* left, const ValueVector* right,
+                            ValueVector& out);
+
+    // Resolve a column or constant operand to a kernel input; false for any
+    // other operand or for a column the table does not have
+    static bool resolveLeaf(const Operand& operand, const ColumnTable& table, Input& input);
+    // Kernel for the input kinds and operator; with a NON_NUMERIC input every
+    // row evaluates to an error (or NULL)
+    static Kernel kernelFor(KernelInput left, OperatorType op, KernelInput right);
+
+private:
+    OperatorType op_ = OperatorType::ADD;
+    Input left_;
+    Input right_;
+    Kernel kernel_ = nullptr;
+};
+
+// A WHERE comparison between numeric inputs (as for CompiledExpression),
+// specialized by (left input, comparator, right input). Whether the values
+// compare as int or as double is known at compile time, except for an INT64
+// cell, which compares as double when it does not fit in int.
+class CompiledComparison {
+public:
+    // Null if either side is not numeric or the comparator is IN; those are
+    // evaluated generically
+    static std::unique_ptr<CompiledComparison> compile(const Operand& left, Comparator comparator,
+                                                       const Operand& right, const ColumnTable& table);
+
+    // Same outcome as WhereFilter::applyBatch
+    void filter(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const;
+
+    // Narrows the selection to the rows that pass
+    using Kernel = void (*)(const CompiledExpression::Input& left_input, const CompiledExpression::Input& right_input,
+                            const ColumnTable& table, SelectionVector& selection, const ValueVector* left,
+                            const ValueVector* right, std::vector<RowError>& errors);
+
+    // Kernel for the input kinds and comparator; null for a NON_NUMERIC input or IN
+    static Kernel kernelFor(KernelInput left, Comparator comparator, KernelInput right);
+
+private:
+    Comparator comparator_ = Comparator::EQUAL;
+    CompiledExpression::Input left_;
+    CompiledExpression::Input right_;
+    Kernel kernel_ = nullptr;
+};
+
+#endif // COMPILEDEXPRESSION_H
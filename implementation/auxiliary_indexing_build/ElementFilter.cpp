@@ -1,141 +1,384 @@
 // ElementFilter.cpp
 #include "ElementFilter.h"
+#include "CompiledExpression.h"
 #include <stdexcept>
-#include <sstream>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
 
-// Implement WhereFilter::apply
+void ElementFilter::applyBatch(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const {
+    size_t kept = 0;
+    for (size_t i = 0; i < selection.size(); ++i) {
+        try {
+            if (apply(table, selection.row(i))) {
+                selection.offsets[kept++] = selection.offsets[i];
+            }
+        }
+        catch (const std::exception& e) {
+            errors.push_back({ selection.row(i), e.what() });
+        }
+    }
+    selection.offsets.resize(kept);
+}
+
+bool WhereFilter::compare(const OperandValue& left, const OperandValue& right) const {
+    if (numeric_left_ && (std::holds_alternative<bool>(left) || std::holds_alternative<std::string>(left))) {
+        throw std::runtime_error("Operands must be numeric (int or double) for expressions.");
+    }
+    return compareValues(left, comparator_, right);
+}
+
+// Implement WhereFilter::apply; the left side is evaluated first, as in applyBatch
 bool WhereFilter::apply(const std::unordered_map<std::string, std::string>& row) const {
-    OperandValue left_val = left_->evaluate(row);
-    OperandValue right_val = right_->evaluate(row);
-    
-    // Handle comparison based on the type of left_val and right_val
-    if (std::holds_alternative<int>(left_val) && std::holds_alternative<int>(right_val)) {
-        int left = std::get<int>(left_val);
-        int right = std::get<int>(right_val);
-        
-        switch (comparator_) {
-            case Comparator::EQUAL:
-                return left == right;
-            case Comparator::NOT_EQUAL:
-                return left != right;
-            case Comparator::GREATER:
-                return left > right;
-            case Comparator::LESS:
-                return left < right;
-            case Comparator::GREATER_EQUAL:
-                return left >= right;
-            case Comparator::LESS_EQUAL:
-                return left <= right;
-            case Comparator::IN:
-                // Implement 'IN' for integers
-                if (std::holds_alternative<std::vector<int>>(right_val)) {
-                    const auto& vec = std::get<std::vector<int>>(right_val);
-                    return std::find(vec.begin(), vec.end(), left) != vec.end();
-                }
-                else {
-                    throw std::runtime_error("'IN' comparator requires a vector<int> as the right operand for integers.");
-                }
-            default:
-                throw std::runtime_error("Unknown comparator in WhereFilter.");
-        }
-    }
-    else if (std::holds_alternative<double>(left_val) && std::holds_alternative<double>(right_val)) {
-        double left = std::get<double>(left_val);
-        double right = std::get<double>(right_val);
-        
-        switch (comparator_) {
-            case Comparator::EQUAL:
-                return left == right;
-            case Comparator::NOT_EQUAL:
-                return left != right;
-            case Comparator::GREATER:
-                return left > right;
-            case Comparator::LESS:
-                return left < right;
-            case Comparator::GREATER_EQUAL:
-                return left >= right;
-            case Comparator::LESS_EQUAL:
-                return left <= right;
-            case Comparator::IN:
-                // Implement 'IN' for doubles
-                if (std::holds_alternative<std::vector<double>>(right_val)) {
-                    const auto& vec = std::get<std::vector<double>>(right_val);
-                    return std::find(vec.begin(), vec.end(), left) != vec.end();
-                }
-                else {
-                    throw std::runtime_error("'IN' comparator requires a vector<double> as the right operand for doubles.");
-                }
-            default:
-                throw std::runtime_error("Unknown comparator in WhereFilter.");
-        }
-    }
-    else if (std::holds_alternative<bool>(left_val) && std::holds_alternative<bool>(right_val)) {
-        bool left = std::get<bool>(left_val);
-        bool right = std::get<bool>(right_val);
-        
-        switch (comparator_) {
-            case Comparator::EQUAL:
-                return left == right;
-            case Comparator::NOT_EQUAL:
-                return left != right;
-            default:
-                throw std::runtime_error("Unsupported comparator for bool operands.");
-        }
-    }
-    else if (std::holds_alternative<std::string>(left_val) && std::holds_alternative<std::string>(right_val)) {
-        const std::string& left = std::get<std::string>(left_val);
-        const std::string& right = std::get<std::string>(right_val);
-        
-        switch (comparator_) {
-            case Comparator::EQUAL:
-                return left == right;
-            case Comparator::NOT_EQUAL:
-                return left != right;
-            case Comparator::IN:
-                // Implement 'IN' for strings
-                {
-                    std::vector<std::string> values;
-                    std::stringstream ss(right);
-                    std::string item;
-                    while (std::getline(ss, item, ',')) {
-                        values.push_back(item);
-                    }
-                    return std::find(values.begin(), values.end(), left) != values.end();
+    OperandValue left = left_->evaluate(row);
+    return compare(left, right_->evaluate(row));
+}
+
+bool WhereFilter::apply(const ColumnTable& table, size_t row) const {
+    if (code_column_) {
+        int index = code_column_->getOrdinal(table);
+        if (index >= 0) {
+            const Column& column = table.getColumn(index);
+            // A NULL cell fails any comparison, decided by its validity bit;
+            // a stray cell is evaluated below
+            std::string_view text;
+            if (column.isMissing(row) && !column.strayText(row, text)) {
+                return false;
+            }
+            // Dictionary-encoded cells are decided by their code alone
+            if (column.isDictionaryEncoded()) {
+                CodeOutcome outcome = codeOutcome(column, column.getCode(row));
+                if (outcome != CODE_GENERIC) {
+                    return outcome == CODE_TRUE;
                 }
-            default:
-                throw std::runtime_error("Unsupported comparator for string operands.");
+            }
+        }
+    }
+    OperandValue left = left_->evaluate(table, row);
+    return compare(left, right_->evaluate(table, row));
+}
+
+// Compare two unboxed values with one of the ordering comparators
+template <typename T>
+static bool compareOrdered(const T& left, Comparator comparator, const T& right) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+            return left == right;
+        case Comparator::NOT_EQUAL:
+            return left != right;
+        case Comparator::GREATER:
+            return left > right;
+        case Comparator::LESS:
+            return left < right;
+        case Comparator::GREATER_EQUAL:
+            return left >= right;
+        default:
+            return left <= right;
+    }
+}
+
+// Whether both sides hold one type whose comparison needs no boxing: numbers
+// of the same type with an ordering comparator, or strings with (in)equality
+static bool isUnboxedComparison(const ValueVector& left, Comparator comparator, const ValueVector& right) {
+    if (left.type != right.type || comparator == Comparator::IN) {
+        return false;
+    }
+    switch (left.type) {
+        case ValueVector::Type::INT:
+        case ValueVector::Type::DOUBLE:
+            return true;
+        case ValueVector::Type::BOOL:
+        case ValueVector::Type::STRING:
+            return comparator == Comparator::EQUAL || comparator == Comparator::NOT_EQUAL;
+        default:
+            return false;
+    }
+}
+
+void WhereFilter::applyBatch(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const {
+    if (compiled_ && &table == compiled_table_) {
+        compiled_->filter(table, selection, errors);
+        return;
+    }
+    ValueVector left, right;
+    left_->evaluateBatch(table, selection, left);
+    right_->evaluateBatch(table, selection, right);
+
+    const Column* coded = nullptr;
+    if (code_column_) {
+        int index = code_column_->getOrdinal(table);
+        if (index >= 0 && table.getColumn(index).isDictionaryEncoded()) {
+            coded = &table.getColumn(index);
+        }
+    }
+    bool unboxed = isUnboxedComparison(left, comparator_, right);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < selection.size(); ++i) {
+        bool pass;
+        if (!left.isValid(i) || !right.isValid(i)) {
+            const std::string* error = left.errorAt(i) ? left.errorAt(i) : right.errorAt(i);
+            if (error) {
+                errors.push_back({ selection.row(i), *error });
+            }
+            // NULL fails any comparison
+            continue;
+        }
+        CodeOutcome outcome = coded ? codeOutcome(*coded, coded->getCode(selection.row(i))) : CODE_GENERIC;
+        if (outcome != CODE_GENERIC) {
+            // Dictionary-encoded cells are decided by their code alone
+            pass = outcome == CODE_TRUE;
+        }
+        else if (unboxed) {
+            switch (left.type) {
+                case ValueVector::Type::INT:
+                    pass = compareOrdered(left.ints[i], comparator_, right.ints[i]);
+                    break;
+                case ValueVector::Type::DOUBLE:
+                    pass = compareOrdered(left.doubles[i], comparator_, right.doubles[i]);
+                    break;
+                case ValueVector::Type::BOOL:
+                    pass = compareOrdered(left.bools[i], comparator_, right.bools[i]);
+                    break;
+                default:
+                    pass = compareOrdered(left.strings[i], comparator_, right.strings[i]);
+                    break;
+            }
+        }
+        else {
+            try {
+                pass = compare(left.get(i), right.get(i));
+            }
+            catch (const std::exception& e) {
+                errors.push_back({ selection.row(i), e.what() });
+                continue;
+            }
+        }
+        if (pass) {
+            selection.offsets[kept++] = selection.offsets[i];
+        }
+    }
+    selection.offsets.resize(kept);
+}
+
+void WhereFilter::bindCodeComparison() {
+    std::shared_ptr<ColumnOperand> left_column = std::dynamic_pointer_cast<ColumnOperand>(left_);
+    std::shared_ptr<ColumnOperand> right_column = std::dynamic_pointer_cast<ColumnOperand>(right_);
+    try {
+        const std::unordered_map<std::string, std::string> no_row;
+        if (left_column && right_->isConstant()) {
+            constant_ = right_->evaluate(no_row);
+            code_column_ = left_column;
+            column_on_left_ = true;
+        }
+        else if (right_column && left_->isConstant()) {
+            constant_ = left_->evaluate(no_row);
+            code_column_ = right_column;
+            column_on_left_ = false;
+        }
+    }
+    catch (const std::exception&) {
+        // A constant that fails to evaluate is reported per row as before
+    }
+}
+
+WhereFilter::CodeOutcome WhereFilter::codeOutcome(const Column& column, uint32_t code) const {
+    std::shared_ptr<const StringDictionary> dictionary = column.getDictionary();
+    if (dictionary != code_dictionary_) {
+        code_dictionary_ = dictionary;
+        code_outcomes_.assign(dictionary->size(), CODE_UNSET);
+    }
+    else if (code >= code_outcomes_.size()) {
+        // The dictionary grew since the outcomes were sized
+        code_outcomes_.resize(dictionary->size(), CODE_UNSET);
+    }
+    CodeOutcome& outcome = code_outcomes_[code];
+    if (outcome == CODE_UNSET) {
+        OperandValue value = std::string(dictionary->get(code));
+        try {
+            bool result = column_on_left_ ? compare(value, constant_)
+                                          : compareValues(constant_, comparator_, value);
+            outcome = result ? CODE_TRUE : CODE_FALSE;
+        }
+        catch (const std::exception&) {
+            // Let the generic path raise the error for each such row
+            outcome = CODE_GENERIC;
+        }
+    }
+    return outcome;
+}
+
+void WhereFilter::collectColumns(std::unordered_set<std::string>& columns) const {
+    left_->collectColumns(columns);
+    right_->collectColumns(columns);
+}
+
+void WhereFilter::bind(const ColumnTable& table) {
+    // code_column_ is one of the two operands
+    left_->bind(table);
+    right_->bind(table);
+    compiled_ = CompiledComparison::compile(*left_, comparator_, *right_, table);
+    compiled_table_ = &table;
+}
+
+// Mirror a comparator so that "constant op column" reads "column op' constant"
+static bool flipComparator(Comparator comparator, Comparator& flipped) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+        case Comparator::NOT_EQUAL:
+            flipped = comparator;
+            return true;
+        case Comparator::GREATER:
+            flipped = Comparator::LESS;
+            return true;
+        case Comparator::LESS:
+            flipped = Comparator::GREATER;
+            return true;
+        case Comparator::GREATER_EQUAL:
+            flipped = Comparator::LESS_EQUAL;
+            return true;
+        case Comparator::LESS_EQUAL:
+            flipped = Comparator::GREATER_EQUAL;
+            return true;
+        default:
+            return false;
+    }
+}
+
+void WhereFilter::collectScanPredicates(std::vector<ScanPredicate>& predicates) const {
+    std::shared_ptr<ColumnOperand> left_column = std::dynamic_pointer_cast<ColumnOperand>(left_);
+    std::shared_ptr<ColumnOperand> right_column = std::dynamic_pointer_cast<ColumnOperand>(right_);
+    try {
+        const std::unordered_map<std::string, std::string> no_row;
+        Comparator flipped;
+        if (left_column && right_->isConstant()) {
+            predicates.push_back({ left_column->getColumn(), comparator_, right_->evaluate(no_row) });
+        }
+        else if (right_column && left_->isConstant() && flipComparator(comparator_, flipped)) {
+            predicates.push_back({ right_column->getColumn(), flipped, left_->evaluate(no_row) });
+        }
+    }
+    catch (const std::exception&) {
+        // A constant that fails to evaluate is reported per row as before
+    }
+}
+
+// Append one operand value to a DISTINCT key
+static void appendKeyPart(std::string& key, const OperandValue& value) {
+    if (std::holds_alternative<int>(value)) {
+        key += std::to_string(std::get<int>(value));
+    }
+    else if (std::holds_alternative<double>(value)) {
+        // Numbers are keyed by value: a whole double reads as the int it
+        // equals, since one batch may hold a column as INT64 and another as
+        // DOUBLE, and any other double in full so that close values differ
+        double num = std::get<double>(value);
+        char buf[32];
+        if (num == std::floor(num) && std::fabs(num) < 0x1p63) {
+            key += std::to_string(static_cast<long long>(num));
         }
+        else {
+            auto result = std::to_chars(buf, buf + sizeof(buf), num);
+            key.append(buf, result.ptr);
+        }
+    }
+    else if (std::holds_alternative<bool>(value)) {
+        key += std::get<bool>(value) ? "true" : "false";
+    }
+    else if (std::holds_alternative<std::string>(value)) {
+        key += std::get<std::string>(value);
     }
     else {
-        throw std::runtime_error("Type mismatch between operands in WhereFilter.");
+        // NULLs are all one DISTINCT value
+        key += "\\N";
+    }
+    key += '|';
+}
+
+DistinctFilter::DistinctFilter(const std::vector<std::shared_ptr<Operand>>& operands)
+    : operands_(operands), code_ids_(operands.size()) {
+    for (const auto& operand : operands_) {
+        column_operands_.push_back(std::dynamic_pointer_cast<ColumnOperand>(operand));
     }
 }
 
 // Implement DistinctFilter::apply
 bool DistinctFilter::apply(const std::unordered_map<std::string, std::string>& row) const {
-    std::stringstream ss;
+    std::string key;
     for (const auto& operand : operands_) {
         try {
-            OperandValue value = operand->evaluate(row);
-            if (std::holds_alternative<int>(value)) {
-                ss << std::get<int>(value) << "|";
-            }
-            else if (std::holds_alternative<double>(value)) {
-                ss << std::get<double>(value) << "|";
-            }
-            else if (std::holds_alternative<bool>(value)) {
-                ss << (std::get<bool>(value) ? "true" : "false") << "|";
-            }
-            else if (std::holds_alternative<std::string>(value)) {
-                ss << std::get<std::string>(value) << "|";
+            appendKeyPart(key, operand->evaluate(row));
+        }
+        catch (...) {
+            key += "N/A|";
+        }
+    }
+    return insertKey(key);
+}
+
+bool DistinctFilter::apply(const ColumnTable& table, size_t row) const {
+    std::string key;
+    for (size_t i = 0; i < operands_.size(); ++i) {
+        if (column_operands_[i]) {
+            int index = column_operands_[i]->getOrdinal(table);
+            if (index >= 0 && table.getColumn(index).getType() == ColumnType::STRING &&
+                !table.getColumn(index).isMissing(row)) {
+                appendStringKeyPart(key, table.getColumn(index), row, code_ids_[i]);
+                continue;
             }
         }
+        try {
+            appendKeyPart(key, operands_[i]->evaluate(table, row));
+        }
         catch (...) {
-            ss << "N/A|";
+            key += "N/A|";
         }
     }
-    std::string key = ss.str();
+    return insertKey(key);
+}
+
+void DistinctFilter::appendStringKeyPart(std::string& key, const Column& column, size_t row,
+                                         CodeIds& code_ids) const {
+    uint32_t id;
+    if (column.isDictionaryEncoded()) {
+        // Each code is looked up once per dictionary; batches bring new dictionaries
+        std::shared_ptr<const StringDictionary> dictionary = column.getDictionary();
+        if (dictionary != code_ids.dictionary) {
+            code_ids.dictionary = dictionary;
+            code_ids.ids.assign(dictionary->size(), UINT32_MAX);
+        }
+        uint32_t code = column.getCode(row);
+        if (code >= code_ids.ids.size()) {
+            code_ids.ids.resize(dictionary->size(), UINT32_MAX);
+        }
+        if (code_ids.ids[code] == UINT32_MAX) {
+            code_ids.ids[code] = key_strings_.intern(dictionary->get(code));
+        }
+        id = code_ids.ids[code];
+    }
+    else {
+        id = key_strings_.intern(column.getString(row));
+    }
+    // '#' keeps ids apart from the textual parts of other operands
+    key += '#';
+    key += std::to_string(id);
+    key += '|';
+}
+
+void DistinctFilter::collectColumns(std::unordered_set<std::string>& columns) const {
+    for (const auto& operand : operands_) {
+        operand->collectColumns(columns);
+    }
+}
+
+void DistinctFilter::bind(const ColumnTable& table) {
+    for (const auto& operand : operands_) {
+        operand->bind(table);
+    }
+}
+
+// Record a DISTINCT key; returns false if it was already seen
+bool DistinctFilter::insertKey(const std::string& key) const {
     if (seen_.find(key) != seen_.end()) {
         return false; // Duplicate row
     }
@@ -151,8 +394,29 @@ bool OrderByFilter::apply(const std::unordered_map<std::string, std::string>& ro
     return true;
 }
 
+bool OrderByFilter::apply(const ColumnTable& table, size_t row) const {
+    return true;
+}
+
+void OrderByFilter::collectColumns(std::unordered_set<std::string>& columns) const {
+    operand_->collectColumns(columns);
+}
+
+void OrderByFilter::bind(const ColumnTable& table) {
+    operand_->bind(table);
+}
+
 // Implement LimitFilter::apply
 bool LimitFilter::apply(const std::unordered_map<std::string, std::string>& row) const {
+    return advance();
+}
+
+bool LimitFilter::apply(const ColumnTable& table, size_t row) const {
+    return advance();
+}
+
+// Count a row against the OFFSET/LIMIT window
+bool LimitFilter::advance() const {
     if (count_ < offset_) {
         count_++;
         return false;
@@ -173,3 +437,60 @@ bool CompositeElementFilter::apply(const std::unordered_map<std::string, std::st
     }
     return true;
 }
+
+bool CompositeElementFilter::apply(const ColumnTable& table, size_t row) const {
+    for (const auto& filter : filters_) {
+        if (!filter->apply(table, row)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CompositeElementFilter::applyBatch(const ColumnTable& table, SelectionVector& selection,
+                                        std::vector<RowError>& errors) const {
+    // Stateful filters see the same rows in the same order as row by row
+    for (const auto& filter : filters_) {
+        if (selection.size() == 0) {
+            return;
+        }
+        filter->applyBatch(table, selection, errors);
+    }
+}
+
+void CompositeElementFilter::collectColumns(std::unordered_set<std::string>& columns) const {
+    for (const auto& filter : filters_) {
+        filter->collectColumns(columns);
+    }
+}
+
+void CompositeElementFilter::collectScanPredicates(std::vector<ScanPredicate>& predicates) const {
+    // Children are a conjunction applied in order. A stateful child must see
+    // every row it saw before, and a child the scan cannot check may report
+    // an error for a row a later one fails, so nothing after either can be
+    // pushed down.
+    for (const auto& filter : filters_) {
+        if (filter->getState() != FilterState::NONE) {
+            return;
+        }
+        size_t before = predicates.size();
+        filter->collectScanPredicates(predicates);
+        if (predicates.size() == before || !std::dynamic_pointer_cast<WhereFilter>(filter)) {
+            return;
+        }
+    }
+}
+
+FilterState CompositeElementFilter::getState() const {
+    FilterState state = FilterState::NONE;
+    for (const auto& filter : filters_) {
+        state = std::max(state, filter->getState());
+    }
+    return state;
+}
+
+void CompositeElementFilter::bind(const ColumnTable& table) {
+    for (const auto& filter : filters_) {
+        filter->bind(table);
+    }
+}
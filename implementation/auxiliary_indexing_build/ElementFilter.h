@@ -8,16 +8,11 @@
 #include <vector>
 #include <unordered_set>
 
-
-// Enumeration for comparators
-enum class Comparator {
-    EQUAL,
-    NOT_EQUAL,
-    GREATER,
-    LESS,
-    GREATER_EQUAL,
-    LESS_EQUAL,
-    IN
+// State a filter keeps across rows, which decides how it can be executed
+enum class FilterState {
+    NONE,       // Each row is decided on its own
+    BOUNDED,    // Fixed-size state, e.g. the LIMIT/OFFSET counter
+    GLOBAL      // Grows with the input, e.g. DISTINCT keys or the rows to sort
 };
 
 // Base class for filters
@@ -25,29 +20,97 @@ class ElementFilter {
 public:
     virtual ~ElementFilter() = default;
     virtual bool apply(const std::unordered_map<std::string, std::string>& row) const = 0;
+    // Apply directly to a row of a columnar table
+    virtual bool apply(const ColumnTable& table, size_t row) const = 0;
+    // Keep the selected rows of a batch that pass, in order; rows that fail
+    // to evaluate are dropped and added to errors. The default applies the
+    // filter one row at a time.
+    virtual void applyBatch(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const;
+    // Add the names of the columns this filter reads
+    virtual void collectColumns(std::unordered_set<std::string>& columns) const {}
+    // Add the conjuncts the loader can check while scanning
+    virtual void collectScanPredicates(std::vector<ScanPredicate>& predicates) const {}
+    // State kept across rows; stateless filters may run in any batch or be pushed down
+    virtual FilterState getState() const { return FilterState::NONE; }
+    // Bind the operands to the ordinals of the table about to be filtered
+    virtual void bind(const ColumnTable& table) {}
 };
 
 // Where filter
+class CompiledComparison;
+
 class WhereFilter : public ElementFilter {
 public:
-    WhereFilter(std::shared_ptr<Operand> left, Comparator comp, std::shared_ptr<Operand> right)
-        : left_(left), comparator_(comp), right_(right) {}
+    // numeric_left marks a left side that stands for arithmetic moved over to
+    // the constant (see optimizeFilter): a text or bool value on it is
+    // reported as the arithmetic would have, not as a type mismatch
+    WhereFilter(std::shared_ptr<Operand> left, Comparator comp, std::shared_ptr<Operand> right,
+                bool numeric_left = false)
+        : left_(left), comparator_(comp), right_(right), numeric_left_(numeric_left) { bindCodeComparison(); }
     bool apply(const std::unordered_map<std::string, std::string>& row) const override;
+    bool apply(const ColumnTable& table, size_t row) const override;
+    void applyBatch(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    void collectScanPredicates(std::vector<ScanPredicate>& predicates) const override;
+    // Binds the operands, then compiles numeric comparisons for the table's column types
+    void bind(const ColumnTable& table) override;
+    const std::shared_ptr<Operand>& getLeft() const { return left_; }
+    Comparator getComparator() const { return comparator_; }
+    const std::shared_ptr<Operand>& getRight() const { return right_; }
+    bool isNumericLeft() const { return numeric_left_; }
 private:
+    // Outcome of the comparison for one dictionary code
+    enum CodeOutcome : uint8_t { CODE_FALSE, CODE_TRUE, CODE_GENERIC, CODE_UNSET };
+
+    // Set up the per-code path for "column op constant" and "constant op column"
+    void bindCodeComparison();
+    CodeOutcome codeOutcome(const Column& column, uint32_t code) const;
+    // compareValues, after the check numeric_left_ asks for
+    bool compare(const OperandValue& left, const OperandValue& right) const;
+
     std::shared_ptr<Operand> left_;
     Comparator comparator_;
     std::shared_ptr<Operand> right_;
+    bool numeric_left_;
+    // Column side and evaluated constant when one side is a constant
+    std::shared_ptr<ColumnOperand> code_column_;
+    bool column_on_left_ = true;
+    OperandValue constant_;
+    // Outcomes per code of the dictionary they were computed for
+    mutable std::shared_ptr<const StringDictionary> code_dictionary_;
+    mutable std::vector<CodeOutcome> code_outcomes_;
+    // Type-specialized comparison, null unless both sides are numeric
+    std::shared_ptr<const CompiledComparison> compiled_;
+    const ColumnTable* compiled_table_ = nullptr;
 };
 
 // Distinct filter
 class DistinctFilter : public ElementFilter {
 public:
-    DistinctFilter(const std::vector<std::shared_ptr<Operand>>& operands)
-        : operands_(operands) {}
+    DistinctFilter(const std::vector<std::shared_ptr<Operand>>& operands);
     bool apply(const std::unordered_map<std::string, std::string>& row) const override;
+    bool apply(const ColumnTable& table, size_t row) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    void bind(const ColumnTable& table) override;
+    // Every distinct key seen so far is kept
+    FilterState getState() const override { return FilterState::GLOBAL; }
 private:
+    // Translation from the codes of one column dictionary to key_strings_ ids
+    struct CodeIds {
+        std::shared_ptr<const StringDictionary> dictionary;
+        std::vector<uint32_t> ids;
+    };
+
+    bool insertKey(const std::string& key) const;
+    // Append the key part of a STRING cell by its id in key_strings_
+    void appendStringKeyPart(std::string& key, const Column& column, size_t row, CodeIds& code_ids) const;
+
     std::vector<std::shared_ptr<Operand>> operands_;
+    std::vector<std::shared_ptr<ColumnOperand>> column_operands_; // Null for non-column operands
     mutable std::unordered_set<std::string> seen_;
+    // STRING cells enter keys as ids, so dictionary codes are never decoded
+    mutable StringDictionary key_strings_;
+    mutable std::vector<CodeIds> code_ids_;
 };
 
 // OrderBy filter
@@ -56,6 +119,11 @@ public:
     OrderByFilter(std::shared_ptr<Operand> operand, bool ascending = true)
         : operand_(operand), ascending_(ascending) {}
     bool apply(const std::unordered_map<std::string, std::string>& row) const override;
+    bool apply(const ColumnTable& table, size_t row) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    void bind(const ColumnTable& table) override;
+    // Sorting needs every qualifying row
+    FilterState getState() const override { return FilterState::GLOBAL; }
     // Implement ORDER BY logic as needed
 private:
     std::shared_ptr<Operand> operand_;
@@ -68,7 +136,10 @@ public:
     LimitFilter(int limit, int offset = 0)
         : limit_(limit), offset_(offset), count_(0) {}
     bool apply(const std::unordered_map<std::string, std::string>& row) const override;
+    bool apply(const ColumnTable& table, size_t row) const override;
+    FilterState getState() const override { return FilterState::BOUNDED; }
 private:
+    bool advance() const;
     int limit_;
     int offset_;
     mutable int count_;
@@ -81,28 +152,17 @@ public:
         filters_.push_back(filter);
     }
     bool apply(const std::unordered_map<std::string, std::string>& row) const override;
+    bool apply(const ColumnTable& table, size_t row) const override;
+    // Each filter narrows the selection in turn
+    void applyBatch(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    void collectScanPredicates(std::vector<ScanPredicate>& predicates) const override;
+    FilterState getState() const override;
+    void bind(const ColumnTable& table) override;
+    const std::vector<std::shared_ptr<ElementFilter>>& getFilters() const { return filters_; }
 private:
     std::vector<std::shared_ptr<ElementFilter>> filters_;
 };
 
-class WhereFilter : public ElementFilter {
-public:
-    WhereFilter(std::shared_ptr<Operand> left, Comparator comp, std::shared_ptr<Operand> right, CSVLoader& loader)
-        : left_(left), comparator_(comp), right_(right), loader_(loader) {}
-
-    // Modify apply to optionally use index
-    bool apply(const std::unordered_map<std::string, std::string>& row) const override;
-
-    // Retrieve matching row indices using B-tree
-    std::unordered_set<size_t> getMatchingRows() const;
-
-private:
-    std::shared_ptr<Operand> left_;
-    Comparator comparator_;
-    std::shared_ptr<Operand> right_;
-    CSVLoader& loader_;
-};
-
-
 #endif // ELEMENTFILTER_H
 
@@ -1,13 +1,15 @@
 // IndexBuilder.cpp
 #include "BTree.h"
 #include "CSVLoader.h"
+#include "RowOffsetIndex.h"
+#include "TableFiles.h"
 #include <iostream>
 #include <fstream>
 #include <memory>
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        std::cerr << "Usage: IndexBuilder <csv_file> <column_name>" << std::endl;
+        std::cerr << "Usage: IndexBuilder <csv_file|directory|'glob'> <column_name>" << std::endl;
         return 1;
     }
 
@@ -36,6 +38,15 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Record the byte offset of every row so index hits can be read directly;
+    // compressed files and multi-file tables cannot be seeked into, so their
+    // hits need a full load
+    RowOffsetIndex row_index(csv_filename);
+    if (!loader.getStats().compressed && !isMultiFileTable(csv_filename) && !row_index.build()) {
+        std::cerr << "Failed to build row offset index for: " << csv_filename << std::endl;
+        return 1;
+    }
+
     std::cout << "B-tree index built and saved successfully for column: " << column_name << std::endl;
     return 0;
 }
@@ -0,0 +1,133 @@
+// MemoryBudget.cpp
+#include "MemoryBudget.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MemoryBudget::MemoryBudget(size_t limit, const std::string& spill_directory)
+    : limit_(limit), spill_(spill_directory) {}
+
+MemoryBudget::~MemoryBudget() = default;
+
+void* MemoryBudget::do_allocate(size_t bytes, size_t alignment) {
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    addBytes(bytes);
+    return p;
+}
+
+void MemoryBudget::addBytes(size_t bytes) {
+    size_t current = current_.fetch_add(bytes) + bytes;
+    size_t peak = peak_.load();
+    while (current > peak && !peak_.compare_exchange_weak(peak, current)) {
+    }
+}
+
+void MemoryBudget::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    current_.fetch_sub(bytes);
+}
+
+size_t MemoryBudget::enforce(ColumnTable& table) {
+    if (limit_ == 0 || current_.load() <= limit_) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(enforce_mutex_);
+    // Coldest first; among columns no query has used, the largest frees the most
+    std::vector<size_t> candidates;
+    for (size_t idx = 0; idx < table.numColumns(); ++idx) {
+        const Column& column = table.getColumn(idx);
+        if (column.getResource() == this && column.memoryUsage() > 0) {
+            candidates.push_back(idx);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&table](size_t a, size_t b) {
+        if (table.lastUse(a) != table.lastUse(b)) {
+            return table.lastUse(a) < table.lastUse(b);
+        }
+        return table.getColumn(a).memoryUsage() > table.getColumn(b).memoryUsage();
+    });
+
+    size_t spilled = 0;
+    for (size_t idx : candidates) {
+        if (current_.load() <= limit_ || !spill_.open()) {
+            break;
+        }
+        table.getColumn(idx).moveStorage(&spill_);
+        spilled++;
+    }
+    return spilled;
+}
+
+MemoryBudget::SpillFile::~SpillFile() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+bool MemoryBudget::SpillFile::open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ >= 0 || failed_) {
+        return fd_ >= 0;
+    }
+    std::string directory = directory_;
+    if (directory.empty()) {
+        const char* tmpdir = std::getenv("TMPDIR");
+        directory = (tmpdir != nullptr && *tmpdir != '\0') ? tmpdir : "/tmp";
+    }
+    std::string path = directory + "/csvspill.XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd_ = mkstemp(name.data());
+    if (fd_ < 0) {
+        std::cerr << "Failed to create spill file in " << directory << "; columns stay in memory" << std::endl;
+        failed_ = true;
+        return false;
+    }
+    // Unlinked at once, so the space is returned however the process ends
+    unlink(name.data());
+    return true;
+}
+
+void* MemoryBudget::SpillFile::do_allocate(size_t bytes, size_t alignment) {
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    if (alignment > page) {
+        throw std::bad_alloc();
+    }
+    uint64_t length = (std::max<uint64_t>(bytes, 1) + page - 1) / page * page;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t offset = file_size_;
+    if (fd_ < 0 || ftruncate(fd_, static_cast<off_t>(offset + length)) != 0) {
+        throw std::bad_alloc();
+    }
+    void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+    if (p == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    file_size_ = offset + length;
+    offsets_[p] = offset;
+    mapped_.fetch_add(length);
+    return p;
+}
+
+void MemoryBudget::SpillFile::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t length = (std::max<uint64_t>(bytes, 1) + page - 1) / page * page;
+    munmap(p, length);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = offsets_.find(p);
+    if (it == offsets_.end()) {
+        return;
+    }
+    // Give the blocks back; the offset range is not reused
+    fallocate(fd_, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(it->second),
+              static_cast<off_t>(length));
+    offsets_.erase(it);
+    mapped_.fetch_sub(length);
+}
@@ -0,0 +1,84 @@
+// MemoryBudget.h
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include "ColumnTable.h"
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Memory resource for column storage: counts the bytes allocated on the heap
+// through it and, once they exceed the limit, moves the least recently used
+// columns of a table into an unlinked temporary file that is mapped back in,
+// so that a load larger than the budget pages instead of failing
+class MemoryBudget : public std::pmr::memory_resource {
+public:
+    // A limit of 0 only counts; spill files are created in spill_directory
+    // ($TMPDIR or /tmp when empty)
+    explicit MemoryBudget(size_t limit = 0, const std::string& spill_directory = std::string());
+    ~MemoryBudget();
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    size_t limit() const { return limit_; }
+    // Heap bytes allocated through the budget now, and at most since resetPeak
+    size_t currentBytes() const { return current_.load(); }
+    size_t peakBytes() const { return peak_.load(); }
+    void resetPeak() { peak_.store(current_.load()); }
+    // Bytes of column storage held in the spill file
+    size_t spilledBytes() const { return spill_.mappedBytes(); }
+
+    // Count bytes allocated outside the resource (e.g. the row maps of the
+    // compatibility view, whose containers cannot take an allocator) in the
+    // current and peak bytes, until released
+    void reserveBytes(size_t bytes) { addBytes(bytes); }
+    void releaseBytes(size_t bytes) { current_.fetch_sub(bytes); }
+
+    // Spill columns of the table whose storage is on the heap, least recently
+    // used first (largest first among equals), until the budget holds or none
+    // is left. Not safe to call while the table is being written to.
+    // Returns the number of columns spilled.
+    size_t enforce(ColumnTable& table);
+
+private:
+    // Allocations mapped from a temporary file, each rounded to whole pages
+    class SpillFile : public std::pmr::memory_resource {
+    public:
+        explicit SpillFile(const std::string& directory) : directory_(directory) {}
+        ~SpillFile();
+
+        // Create the file on first use; false (and logged) on failure
+        bool open();
+        size_t mappedBytes() const { return mapped_.load(); }
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        std::string directory_;
+        std::mutex mutex_;
+        int fd_ = -1;
+        bool failed_ = false;
+        uint64_t file_size_ = 0;                            // Offset of the next allocation
+        std::unordered_map<void*, uint64_t> offsets_;       // File offset of each mapping
+        std::atomic<size_t> mapped_{0};
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    void addBytes(size_t bytes);
+
+    size_t limit_;
+    std::atomic<size_t> current_{0};
+    std::atomic<size_t> peak_{0};
+    SpillFile spill_;
+    std::mutex enforce_mutex_;
+};
+
+#endif // MEMORYBUDGET_H
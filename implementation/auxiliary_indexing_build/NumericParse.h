@@ -0,0 +1,28 @@
+// NumericParse.h
+#ifndef NUMERICPARSE_H
+#define NUMERICPARSE_H
+
+#include <cstdint>
+#include <string_view>
+
+// Parsers for CSV cells and index keys, built on std::from_chars: no
+// exceptions, no allocation and no locale. They accept what std::stoi /
+// std::stod accepted when called on a whole cell: optional leading
+// whitespace, an optional sign, and nothing after the number.
+enum class ParseStatus {
+    OK,
+    EMPTY,          // Nothing but whitespace and a sign
+    INVALID,        // Not a number of the requested type, or trailing text
+    OUT_OF_RANGE    // A number that does not fit the requested type
+};
+
+ParseStatus parseInt64(std::string_view text, int64_t& value);
+ParseStatus parseInt32(std::string_view text, int32_t& value);
+ParseStatus parseDouble(std::string_view text, double& value);
+// "true" or "false" in any case
+ParseStatus parseBool(std::string_view text, bool& value);
+
+// Text without leading and trailing spaces, tabs and line breaks
+std::string_view trimSpace(std::string_view text);
+
+#endif // NUMERICPARSE_H
@@ -1,61 +1,361 @@
 // Operand.cpp
 #include "Operand.h"
-#include <iostream>
+#include "CompiledExpression.h"
+#include "NumericParse.h"
 #include <sstream>
-#include <cctype>
+#include <limits>
+#include <vector>
 
-// Helper function to convert string to lowercase
-static std::string to_lower(const std::string& s) {
-    std::string result = s;
-    std::transform(result.begin(), result.end(), result.begin(),
-                   [](unsigned char c){ return std::tolower(c); });
-    return result;
+OperandValue parseCell(const std::string& value_str) {
+    // Attempt to parse as int; values outside int range fall through to double
+    int32_t int_val;
+    if (parseInt32(value_str, int_val) == ParseStatus::OK) {
+        return static_cast<int>(int_val);
+    }
+
+    // Attempt to parse as double
+    double double_val;
+    if (parseDouble(value_str, double_val) == ParseStatus::OK) {
+        return double_val;
+    }
+
+    // Attempt to parse as bool ("1" and "0" were already taken as int)
+    bool bool_val;
+    if (parseBool(value_str, bool_val) == ParseStatus::OK) {
+        return bool_val;
+    }
+
+    // If all parsing attempts fail, return as string
+    return value_str;
+}
+
+// Compare two evaluated operands with the given comparator
+bool compareValues(const OperandValue& left_val, Comparator comparator, const OperandValue& right_val) {
+    if (isNull(left_val) || isNull(right_val)) {
+        return false;
+    }
+    // Handle comparison based on the type of left_val and right_val
+    if (std::holds_alternative<int>(left_val) && std::holds_alternative<int>(right_val)) {
+        int left = std::get<int>(left_val);
+        int right = std::get<int>(right_val);
+
+        switch (comparator) {
+            case Comparator::EQUAL:
+                return left == right;
+            case Comparator::NOT_EQUAL:
+                return left != right;
+            case Comparator::GREATER:
+                return left > right;
+            case Comparator::LESS:
+                return left < right;
+            case Comparator::GREATER_EQUAL:
+                return left >= right;
+            case Comparator::LESS_EQUAL:
+                return left <= right;
+            case Comparator::IN:
+                // OperandValue holds no list alternative, so 'IN' only supports string operands
+                throw std::runtime_error("'IN' comparator is only supported for string operands.");
+            default:
+                throw std::runtime_error("Unknown comparator in WhereFilter.");
+        }
+    }
+    else if ((std::holds_alternative<int>(left_val) || std::holds_alternative<double>(left_val)) &&
+             (std::holds_alternative<int>(right_val) || std::holds_alternative<double>(right_val))) {
+        // At least one double: compare as doubles, exact for every int
+        double left = std::holds_alternative<int>(left_val) ? std::get<int>(left_val) : std::get<double>(left_val);
+        double right = std::holds_alternative<int>(right_val) ? std::get<int>(right_val) : std::get<double>(right_val);
+
+        switch (comparator) {
+            case Comparator::EQUAL:
+                return left == right;
+            case Comparator::NOT_EQUAL:
+                return left != right;
+            case Comparator::GREATER:
+                return left > right;
+            case Comparator::LESS:
+                return left < right;
+            case Comparator::GREATER_EQUAL:
+                return left >= right;
+            case Comparator::LESS_EQUAL:
+                return left <= right;
+            case Comparator::IN:
+                throw std::runtime_error("'IN' comparator is only supported for string operands.");
+            default:
+                throw std::runtime_error("Unknown comparator in WhereFilter.");
+        }
+    }
+    else if (std::holds_alternative<bool>(left_val) && std::holds_alternative<bool>(right_val)) {
+        bool left = std::get<bool>(left_val);
+        bool right = std::get<bool>(right_val);
+
+        switch (comparator) {
+            case Comparator::EQUAL:
+                return left == right;
+            case Comparator::NOT_EQUAL:
+                return left != right;
+            default:
+                throw std::runtime_error("Unsupported comparator for bool operands.");
+        }
+    }
+    else if (std::holds_alternative<std::string>(left_val) && std::holds_alternative<std::string>(right_val)) {
+        const std::string& left = std::get<std::string>(left_val);
+        const std::string& right = std::get<std::string>(right_val);
+
+        switch (comparator) {
+            case Comparator::EQUAL:
+                return left == right;
+            case Comparator::NOT_EQUAL:
+                return left != right;
+            case Comparator::IN:
+                // Implement 'IN' for strings
+                {
+                    std::vector<std::string> values;
+                    std::stringstream ss(right);
+                    std::string item;
+                    while (std::getline(ss, item, ',')) {
+                        values.push_back(item);
+                    }
+                    return std::find(values.begin(), values.end(), left) != values.end();
+                }
+            default:
+                throw std::runtime_error("Unsupported comparator for string operands.");
+        }
+    }
+    else {
+        throw std::runtime_error("Type mismatch between operands in WhereFilter.");
+    }
+}
+
+void SelectionVector::selectAll(size_t first_row, size_t count) {
+    begin = first_row;
+    offsets.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = static_cast<uint16_t>(i);
+    }
+}
+
+void ValueVector::reset(Type value_type, size_t count) {
+    type = value_type;
+    size = count;
+    switch (type) {
+        case Type::INT:
+            ints.resize(count);
+            break;
+        case Type::DOUBLE:
+            doubles.resize(count);
+            break;
+        case Type::BOOL:
+            bools.resize(count);
+            break;
+        case Type::STRING:
+            strings.resize(count);
+            break;
+        case Type::MIXED:
+            values.assign(count, NullValue());
+            break;
+    }
+    validity.clear();
+    errors.clear();
+}
+
+void ValueVector::setNull(size_t i) {
+    if (validity.empty()) {
+        validity.assign((size + 63) / 64, ~uint64_t(0));
+    }
+    validity[i >> 6] &= ~(uint64_t(1) << (i & 63));
+}
+
+void ValueVector::setError(size_t i, const std::string& message) {
+    setNull(i);
+    errors.emplace_back(i, message);
+}
+
+const std::string* ValueVector::errorAt(size_t i) const {
+    if (errors.empty()) {
+        return nullptr;
+    }
+    auto it = std::lower_bound(errors.begin(), errors.end(), i,
+                               [](const std::pair<size_t, std::string>& error, size_t index) { return error.first < index; });
+    return (it != errors.end() && it->first == i) ? &it->second : nullptr;
+}
+
+OperandValue ValueVector::get(size_t i) const {
+    if (!isValid(i)) {
+        return NullValue();
+    }
+    switch (type) {
+        case Type::INT:
+            return static_cast<int>(ints[i]);
+        case Type::DOUBLE:
+            return doubles[i];
+        case Type::BOOL:
+            return bools[i] != 0;
+        case Type::STRING:
+            return std::string(strings[i]);
+        default:
+            return values[i];
+    }
+}
+
+void ValueVector::toMixed() {
+    if (type == Type::MIXED) {
+        return;
+    }
+    values.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        values[i] = get(i);
+    }
+    type = Type::MIXED;
+}
+
+void Operand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    out.reset(ValueVector::Type::MIXED, selection.size());
+    for (size_t i = 0; i < selection.size(); ++i) {
+        try {
+            OperandValue value = evaluate(table, selection.row(i));
+            if (isNull(value)) {
+                out.setNull(i);
+            }
+            else {
+                out.values[i] = std::move(value);
+            }
+        }
+        catch (const std::exception& e) {
+            out.setError(i, e.what());
+        }
+    }
 }
 
 // Implement ColumnOperand::evaluate
 OperandValue ColumnOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
     auto it = row.find(column_);
     if (it != row.end()) {
-        const std::string& value_str = it->second;
-        std::cout << "Evaluating ColumnOperand: " << column_ << " = " << value_str << std::endl;
+        return parseCell(it->second);
+    }
+    // Short rows leave their trailing columns out; unknown columns are
+    // rejected before any row is evaluated
+    return NullValue();
+}
 
-        // Attempt to parse as int
-        try {
-            size_t pos;
-            int int_val = std::stoi(value_str, &pos);
-            if (pos == value_str.length()) {
-                std::cout << "Parsed as int: " << int_val << std::endl;
-                return int_val;
+OperandValue ColumnOperand::evaluate(const ColumnTable& table, size_t row) const {
+    int index = getOrdinal(table);
+    if (index < 0) {
+        throw std::runtime_error("Column '" + column_ + "' not found.");
+    }
+    // Cells were parsed into typed storage at load time
+    const Column& column = table.getColumn(index);
+    if (column.isMissing(row)) {
+        // A stray cell evaluates as its text, as in a row map
+        std::string_view text;
+        return column.strayText(row, text) ? parseCell(std::string(text)) : OperandValue(NullValue());
+    }
+    switch (column.getType()) {
+        case ColumnType::INT64: {
+            int64_t value = column.getInt(row);
+            // Values outside int range surface as double, as std::stoi/std::stod did
+            if (value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+                return static_cast<int>(value);
             }
-        } catch (...) { /* Ignore and try next type */ }
+            return static_cast<double>(value);
+        }
+        case ColumnType::DOUBLE:
+            return column.getDouble(row);
+        case ColumnType::BOOL:
+            return column.getBool(row);
+        case ColumnType::STRING:
+            return std::string(column.getString(row));
+        default:
+            throw std::runtime_error("Unknown column type for '" + column_ + "'.");
+    }
+}
 
-        // Attempt to parse as double
-        try {
-            size_t pos;
-            double double_val = std::stod(value_str, &pos);
-            if (pos == value_str.length()) {
-                std::cout << "Parsed as double: " << double_val << std::endl;
-                return double_val;
-            }
-        } catch (...) { /* Ignore and try next type */ }
+void ColumnOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    const size_t count = selection.size();
+    int index = getOrdinal(table);
+    if (index < 0) {
+        out.reset(ValueVector::Type::MIXED, count);
+        for (size_t i = 0; i < count; ++i) {
+            out.setError(i, "Column '" + column_ + "' not found.");
+        }
+        return;
+    }
+    loadColumnBatch(table.getColumn(index), selection, out);
+}
 
-        // Attempt to parse as bool
-        std::string lower_val = to_lower(value_str);
-        if (lower_val == "true" || lower_val == "1") {
-            std::cout << "Parsed as bool: true" << std::endl;
-            return true;
+void loadColumnBatch(const Column& column, const SelectionVector& selection, ValueVector& out) {
+    const size_t count = selection.size();
+    switch (column.getType()) {
+        case ColumnType::INT64: {
+            out.reset(ValueVector::Type::INT, count);
+            bool fits = true;
+            for (size_t i = 0; i < count; ++i) {
+                int64_t value = column.getInt(selection.row(i));
+                out.ints[i] = value;
+                fits = fits && value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max();
+            }
+            if (!fits) {
+                // Values outside int range surface as double, as in evaluate()
+                std::vector<int64_t> ints = std::move(out.ints);
+                out.reset(ValueVector::Type::MIXED, count);
+                for (size_t i = 0; i < count; ++i) {
+                    if (ints[i] >= std::numeric_limits<int>::min() && ints[i] <= std::numeric_limits<int>::max()) {
+                        out.values[i] = static_cast<int>(ints[i]);
+                    }
+                    else {
+                        out.values[i] = static_cast<double>(ints[i]);
+                    }
+                }
+            }
+            break;
         }
-        if (lower_val == "false" || lower_val == "0") {
-            std::cout << "Parsed as bool: false" << std::endl;
-            return false;
+        case ColumnType::DOUBLE:
+            out.reset(ValueVector::Type::DOUBLE, count);
+            for (size_t i = 0; i < count; ++i) {
+                out.doubles[i] = column.getDouble(selection.row(i));
+            }
+            break;
+        case ColumnType::BOOL:
+            out.reset(ValueVector::Type::BOOL, count);
+            for (size_t i = 0; i < count; ++i) {
+                out.bools[i] = column.getBool(selection.row(i));
+            }
+            break;
+        case ColumnType::STRING:
+            out.reset(ValueVector::Type::STRING, count);
+            for (size_t i = 0; i < count; ++i) {
+                out.strings[i] = column.getString(selection.row(i));
+            }
+            break;
+    }
+    if (column.nullCount() == 0) {
+        return;
+    }
+    std::string_view text;
+    for (size_t i = 0; i < count; ++i) {
+        size_t row = selection.row(i);
+        if (!column.isMissing(row)) {
+            continue;
+        }
+        if (column.strayText(row, text)) {
+            // A stray cell evaluates as its text, as in evaluate()
+            out.toMixed();
+            out.values[i] = parseCell(std::string(text));
+        }
+        else {
+            out.setNull(i);
         }
-
-        // If all parsing attempts fail, return as string
-        std::cout << "Returning as string: " << value_str << std::endl;
-        return value_str;
     }
-    else {
-        throw std::runtime_error("Column '" + column_ + "' not found.");
+}
+
+void ColumnOperand::collectColumns(std::unordered_set<std::string>& columns) const {
+    columns.insert(column_);
+}
+
+void ColumnOperand::bind(const ColumnTable& table) {
+    bound_table_ = &table;
+    ordinal_ = table.findColumn(column_);
+    if (ordinal_ >= 0) {
+        table.touchColumn(ordinal_);
     }
 }
 
@@ -64,16 +364,62 @@ OperandValue IntegerOperand::evaluate(const std::unordered_map<std::string, std:
     return value_;
 }
 
+OperandValue IntegerOperand::evaluate(const ColumnTable& table, size_t row) const {
+    return value_;
+}
+
+void IntegerOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    out.reset(ValueVector::Type::INT, selection.size());
+    std::fill(out.ints.begin(), out.ints.end(), value_);
+}
+
+// Implement DoubleOperand::evaluate
+OperandValue DoubleOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
+    return value_;
+}
+
+OperandValue DoubleOperand::evaluate(const ColumnTable& table, size_t row) const {
+    return value_;
+}
+
+void DoubleOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    out.reset(ValueVector::Type::DOUBLE, selection.size());
+    std::fill(out.doubles.begin(), out.doubles.end(), value_);
+}
+
 // Implement BooleanOperand::evaluate
 OperandValue BooleanOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
     return value_;
 }
 
-// Implement ExpressionOperand::evaluate
-OperandValue ExpressionOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
-    OperandValue left_val = left_->evaluate(row);
-    OperandValue right_val = right_->evaluate(row);
-    
+OperandValue BooleanOperand::evaluate(const ColumnTable& table, size_t row) const {
+    return value_;
+}
+
+void BooleanOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    out.reset(ValueVector::Type::BOOL, selection.size());
+    std::fill(out.bools.begin(), out.bools.end(), value_ ? 1 : 0);
+}
+
+// Implement StringOperand::evaluate
+OperandValue StringOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
+    return value_;
+}
+
+OperandValue StringOperand::evaluate(const ColumnTable& table, size_t row) const {
+    return value_;
+}
+
+void StringOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    out.reset(ValueVector::Type::STRING, selection.size());
+    std::fill(out.strings.begin(), out.strings.end(), std::string_view(value_));
+}
+
+// Apply an arithmetic operator to two evaluated operands
+static OperandValue applyOperator(const OperandValue& left_val, OperatorType op, const OperandValue& right_val) {
+    if (isNull(left_val) || isNull(right_val)) {
+        return NullValue();
+    }
     // Ensure both operands are numeric (int or double)
     if ((std::holds_alternative<int>(left_val) || std::holds_alternative<double>(left_val)) &&
         (std::holds_alternative<int>(right_val) || std::holds_alternative<double>(right_val))) {
@@ -81,7 +427,7 @@ OperandValue ExpressionOperand::evaluate(const std::unordered_map<std::string, s
         double left = std::holds_alternative<int>(left_val) ? static_cast<double>(std::get<int>(left_val)) : std::get<double>(left_val);
         double right = std::holds_alternative<int>(right_val) ? static_cast<double>(std::get<int>(right_val)) : std::get<double>(right_val);
         
-        switch (op_) {
+        switch (op) {
             case OperatorType::ADD:
                 return left + right;
             case OperatorType::SUBTRACT:
@@ -100,3 +446,104 @@ OperandValue ExpressionOperand::evaluate(const std::unordered_map<std::string, s
     }
 }
 
+// Implement ExpressionOperand::evaluate. The left side is evaluated first, so
+// that a row failing on both sides reports the left error, as evaluateBatch does.
+OperandValue ExpressionOperand::evaluate(const std::unordered_map<std::string, std::string>& row) const {
+    OperandValue left = left_->evaluate(row);
+    return applyOperator(left, op_, right_->evaluate(row));
+}
+
+OperandValue ExpressionOperand::evaluate(const ColumnTable& table, size_t row) const {
+    OperandValue left = left_->evaluate(table, row);
+    return applyOperator(left, op_, right_->evaluate(table, row));
+}
+
+void ExpressionOperand::evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const {
+    if (compiled_ && &table == compiled_table_) {
+        compiled_->evaluateBatch(table, selection, out);
+        return;
+    }
+    ValueVector left, right;
+    left_->evaluateBatch(table, selection, left);
+    right_->evaluateBatch(table, selection, right);
+    const size_t count = selection.size();
+    out.reset(ValueVector::Type::DOUBLE, count);
+
+    bool left_numeric = left.type == ValueVector::Type::INT || left.type == ValueVector::Type::DOUBLE;
+    bool right_numeric = right.type == ValueVector::Type::INT || right.type == ValueVector::Type::DOUBLE;
+    if (left.type == ValueVector::Type::MIXED || right.type == ValueVector::Type::MIXED) {
+        // Types vary from row to row
+        for (size_t i = 0; i < count; ++i) {
+            if (const std::string* error = left.errorAt(i) ? left.errorAt(i) : right.errorAt(i)) {
+                out.setError(i, *error);
+                continue;
+            }
+            try {
+                OperandValue value = applyOperator(left.get(i), op_, right.get(i));
+                if (isNull(value)) {
+                    out.setNull(i);
+                }
+                else {
+                    out.doubles[i] = std::get<double>(value);
+                }
+            }
+            catch (const std::exception& e) {
+                out.setError(i, e.what());
+            }
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!left.isValid(i) || !right.isValid(i)) {
+            if (const std::string* error = left.errorAt(i) ? left.errorAt(i) : right.errorAt(i)) {
+                out.setError(i, *error);
+            }
+            else {
+                out.setNull(i);
+            }
+            continue;
+        }
+        if (!left_numeric || !right_numeric) {
+            out.setError(i, "Operands must be numeric (int or double) for expressions.");
+            continue;
+        }
+        double l = left.type == ValueVector::Type::INT ? static_cast<double>(left.ints[i]) : left.doubles[i];
+        double r = right.type == ValueVector::Type::INT ? static_cast<double>(right.ints[i]) : right.doubles[i];
+        switch (op_) {
+            case OperatorType::ADD:
+                out.doubles[i] = l + r;
+                break;
+            case OperatorType::SUBTRACT:
+                out.doubles[i] = l - r;
+                break;
+            case OperatorType::MULTIPLY:
+                out.doubles[i] = l * r;
+                break;
+            case OperatorType::DIVIDE:
+                if (r == 0) {
+                    out.setError(i, "Division by zero in expression.");
+                }
+                else {
+                    out.doubles[i] = l / r;
+                }
+                break;
+        }
+    }
+}
+
+void ExpressionOperand::collectColumns(std::unordered_set<std::string>& columns) const {
+    left_->collectColumns(columns);
+    right_->collectColumns(columns);
+}
+
+bool ExpressionOperand::isConstant() const {
+    return left_->isConstant() && right_->isConstant();
+}
+
+void ExpressionOperand::bind(const ColumnTable& table) {
+    left_->bind(table);
+    right_->bind(table);
+    compiled_ = CompiledExpression::compile(*this, table);
+    compiled_table_ = &table;
+}
@@ -2,12 +2,19 @@
 #ifndef OPERAND_H
 #define OPERAND_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 #include <variant>
 #include <stdexcept>
 #include <algorithm>
+#include "ColumnTable.h"
+
+class CompiledExpression;
 
 // Enumeration for operator types
 enum class OperatorType {
@@ -17,14 +24,106 @@ enum class OperatorType {
     DIVIDE
 };
 
-// Define OperandValue as a variant of int, double, bool, and string
-using OperandValue = std::variant<int, double, bool, std::string>;
+// Enumeration for comparators
+enum class Comparator {
+    EQUAL,
+    NOT_EQUAL,
+    GREATER,
+    LESS,
+    GREATER_EQUAL,
+    LESS_EQUAL,
+    IN
+};
+
+// SQL NULL: the value of a missing cell
+using NullValue = std::monostate;
+
+// Define OperandValue as a variant of int, double, bool, string, and NULL
+using OperandValue = std::variant<int, double, bool, std::string, NullValue>;
+
+inline bool isNull(const OperandValue& value) { return std::holds_alternative<NullValue>(value); }
+
+// The value of a textual cell: int, double, bool, or string (the first it parses as)
+OperandValue parseCell(const std::string& value_str);
+
+// Compare two evaluated operands with the given comparator. An int and a
+// double compare by value. A comparison with NULL is unknown, which a WHERE
+// clause treats as false.
+bool compareValues(const OperandValue& left_val, Comparator comparator, const OperandValue& right_val);
+
+// Rows of a table evaluated together by evaluateBatch
+const size_t BATCH_ROWS = 1024;
+
+// The rows of one batch still in play: offsets from the batch's first row,
+// ascending. Filters narrow it; operands are evaluated for its rows only.
+struct SelectionVector {
+    size_t begin = 0;                   // First table row of the batch
+    std::vector<uint16_t> offsets;
+
+    size_t size() const { return offsets.size(); }
+    size_t row(size_t i) const { return begin + offsets[i]; }
+    // Select rows [begin, begin + count); count is at most BATCH_ROWS
+    void selectAll(size_t first_row, size_t count);
+};
+
+// A row dropped from a batch because evaluating it failed
+struct RowError {
+    size_t row;                         // Table row
+    std::string message;
+};
+
+// Values of an operand for the rows of a selection, one per selected row.
+// Values of one type are stored unboxed; only a batch mixing types (an INT64
+// column with values past int range evaluates them as double) falls back to
+// OperandValue. A row that failed to evaluate is not valid and has an error.
+struct ValueVector {
+    enum class Type { INT, DOUBLE, BOOL, STRING, MIXED };
+
+    Type type = Type::INT;
+    size_t size = 0;
+    std::vector<int64_t> ints;          // INT, each within int range
+    std::vector<double> doubles;        // DOUBLE
+    std::vector<uint8_t> bools;         // BOOL
+    std::vector<std::string_view> strings; // STRING, views into the table or operand
+    std::vector<OperandValue> values;   // MIXED
+    std::vector<uint64_t> validity;     // Packed, bit clear for NULL; empty if every value is valid
+    std::vector<std::pair<size_t, std::string>> errors; // (index, message), ascending
+
+    // Clear and size the storage of the given type
+    void reset(Type value_type, size_t count);
+    bool isValid(size_t i) const {
+        return validity.empty() || ((validity[i >> 6] >> (i & 63)) & 1);
+    }
+    void setNull(size_t i);
+    void setError(size_t i, const std::string& message);
+    // Error of a value, or null if it evaluated
+    const std::string* errorAt(size_t i) const;
+    // Value i as an OperandValue (NullValue when not valid)
+    OperandValue get(size_t i) const;
+    // Box the values into OperandValues, keeping NULLs and errors
+    void toMixed();
+};
+
+// Values of a column for the rows of a selection, as ColumnOperand evaluates them
+void loadColumnBatch(const Column& column, const SelectionVector& selection, ValueVector& out);
 
 // Operand base class
 class Operand {
 public:
     virtual ~Operand() = default;
     virtual OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const = 0;
+    // Evaluate directly against a row of a columnar table
+    virtual OperandValue evaluate(const ColumnTable& table, size_t row) const = 0;
+    // Evaluate the selected rows of a batch into out, recording the rows that
+    // fail rather than throwing; the default evaluates them one at a time
+    virtual void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const;
+    // Add the names of the columns this operand reads
+    virtual void collectColumns(std::unordered_set<std::string>& columns) const {}
+    // Whether the operand evaluates to the same value for every row
+    virtual bool isConstant() const { return false; }
+    // Resolve column names to ordinals of the table before evaluating its rows;
+    // holds until the table's columns change
+    virtual void bind(const ColumnTable& table) {}
 };
 
 // Operand representing a column
@@ -32,9 +131,19 @@ class ColumnOperand : public Operand {
 public:
     ColumnOperand(const std::string& column) : column_(column) {}
     OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    void bind(const ColumnTable& table) override;
     const std::string& getColumn() const { return column_; }
+    // Ordinal of the column in the table, or -1 if it does not exist
+    int getOrdinal(const ColumnTable& table) const {
+        return &table == bound_table_ ? ordinal_ : table.findColumn(column_);
+    }
 private:
     std::string column_;
+    const ColumnTable* bound_table_ = nullptr; // Table the ordinal was resolved in
+    int ordinal_ = -1;
 };
 
 // Operand representing an integer
@@ -42,29 +151,73 @@ class IntegerOperand : public Operand {
 public:
     IntegerOperand(int value) : value_(value) {}
     OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    bool isConstant() const override { return true; }
+    int getValue() const { return value_; }
 private:
     int value_;
 };
 
+// Operand representing a double constant (e.g. a folded expression)
+class DoubleOperand : public Operand {
+public:
+    DoubleOperand(double value) : value_(value) {}
+    OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    bool isConstant() const override { return true; }
+    double getValue() const { return value_; }
+private:
+    double value_;
+};
+
 // Operand representing a boolean
 class BooleanOperand : public Operand {
 public:
     BooleanOperand(bool value) : value_(value) {}
     OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    bool isConstant() const override { return true; }
 private:
     bool value_;
 };
 
-// Operand representing an expression (operand operator operand)
+// Operand representing a string literal (for IN, a comma-separated list)
+class StringOperand : public Operand {
+public:
+    StringOperand(const std::string& value) : value_(value) {}
+    OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    bool isConstant() const override { return true; }
+private:
+    std::string value_;
+};
+
+// Operand representing an expression (operand operator operand); NULL if
+// either side is NULL
 class ExpressionOperand : public Operand {
 public:
     ExpressionOperand(std::shared_ptr<Operand> left, OperatorType op, std::shared_ptr<Operand> right)
         : left_(left), op_(op), right_(right) {}
     OperandValue evaluate(const std::unordered_map<std::string, std::string>& row) const override;
+    OperandValue evaluate(const ColumnTable& table, size_t row) const override;
+    void evaluateBatch(const ColumnTable& table, const SelectionVector& selection, ValueVector& out) const override;
+    void collectColumns(std::unordered_set<std::string>& columns) const override;
+    bool isConstant() const override;
+    // Binds the operands, then compiles the tree for the table's column types
+    void bind(const ColumnTable& table) override;
+    const std::shared_ptr<Operand>& getLeft() const { return left_; }
+    OperatorType getOperator() const { return op_; }
+    const std::shared_ptr<Operand>& getRight() const { return right_; }
 private:
     std::shared_ptr<Operand> left_;
     OperatorType op_;
     std::shared_ptr<Operand> right_;
+    std::shared_ptr<const CompiledExpression> compiled_;    // Null if the tree did not compile
+    const ColumnTable* compiled_table_ = nullptr;           // Table compiled_ is specialized for
 };
 
 #endif // OPERAND_H
@@ -3,10 +3,44 @@
 #include <iomanip> // For formatting output
 
 void QueryExecutor::execute(const ElementSelect& select) const {
-    const auto& data = loader_.getData();
-    const auto& headers = loader_.getHeaders();
+    if (!checkColumns(select)) {
+        return;
+    }
+    select.bind(loader_.getTable());
+    printHeader(select);
+    emitRows(loader_.getTable(), select);
+}
+
+void QueryExecutor::executeBatches(const ElementSelect& select, size_t batch_rows) const {
+    if (select.getFilter()->getState() == FilterState::GLOBAL) {
+        std::cerr << "Note: DISTINCT/ORDER BY keep state across batches; "
+                  << "memory grows with the number of distinct rows." << std::endl;
+    }
+    if (!loader_.openBatches(batch_rows)) {
+        std::cerr << "Error: Failed to open the CSV file for streaming." << std::endl;
+        return;
+    }
+    if (!checkColumns(select)) {
+        return;
+    }
+    printHeader(select);
+    while (loader_.nextBatch()) {
+        // Every batch is a freshly built table
+        select.bind(loader_.getTable());
+        emitRows(loader_.getTable(), select);
+    }
+}
+
+bool QueryExecutor::checkColumns(const ElementSelect& select) const {
+    std::vector<std::string> unknown = select.findUnknownColumns(loader_.getHeaders());
+    for (const auto& column : unknown) {
+        std::cerr << "Error: Column '" << column << "' does not exist in CSV." << std::endl;
+    }
+    return unknown.empty();
+}
+
+void QueryExecutor::printHeader(const ElementSelect& select) const {
     const auto& operands = select.getOperands();
-    const auto& filter = select.getFilter();
 
     // Display headers
     for (const auto& operand : operands) {
@@ -27,41 +61,103 @@ void QueryExecutor::execute(const ElementSelect& select) const {
         std::cout << "----\t";
     }
     std::cout << std::endl;
+}
+
+// Print one evaluated value followed by a tab
+static void printValue(const ValueVector& values, size_t i) {
+    if (!values.isValid(i)) {
+        std::cout << "NULL\t";
+        return;
+    }
+    switch (values.type) {
+        case ValueVector::Type::INT:
+            std::cout << values.ints[i] << "\t";
+            return;
+        case ValueVector::Type::DOUBLE: {
+            double num = values.doubles[i];
+            // Display as integer if no fractional part
+            if (num == static_cast<int>(num)) {
+                std::cout << static_cast<int>(num) << "\t";
+            }
+            else {
+                std::cout << num << "\t";
+            }
+            return;
+        }
+        case ValueVector::Type::BOOL:
+            std::cout << (values.bools[i] ? "true" : "false") << "\t";
+            return;
+        case ValueVector::Type::STRING:
+            std::cout << values.strings[i] << "\t";
+            return;
+        default:
+            break;
+    }
+    const OperandValue& value = values.values[i];
+    if (std::holds_alternative<int>(value)) {
+        std::cout << std::get<int>(value) << "\t";
+    }
+    else if (std::holds_alternative<double>(value)) {
+        double num = std::get<double>(value);
+        if (num == static_cast<int>(num)) {
+            std::cout << static_cast<int>(num) << "\t";
+        }
+        else {
+            std::cout << num << "\t";
+        }
+    }
+    else if (std::holds_alternative<bool>(value)) {
+        std::cout << (std::get<bool>(value) ? "true" : "false") << "\t";
+    }
+    else if (std::holds_alternative<std::string>(value)) {
+        std::cout << std::get<std::string>(value) << "\t";
+    }
+    else {
+        std::cout << "NULL\t";
+    }
+}
+
+void QueryExecutor::emitRows(const ColumnTable& table, const ElementSelect& select) const {
+    const size_t num_operands = select.getOperands().size();
+    QueryProgram program(select, table);
+
+    // Filter and evaluate BATCH_ROWS rows at a time; a row that fails is
+    // reported in its place among the printed rows
+    SelectionVector selection;
+    std::vector<RowError> errors;
+    for (size_t begin = 0; begin < table.numRows(); begin += BATCH_ROWS) {
+        selection.selectAll(begin, std::min(BATCH_ROWS, table.numRows() - begin));
+        errors.clear();
+        program.run(table, selection, errors);
+        std::stable_sort(errors.begin(), errors.end(),
+                         [](const RowError& a, const RowError& b) { return a.row < b.row; });
 
-    // Iterate over data and apply filters
-    for (size_t row_num = 0; row_num < data.size(); ++row_num) {
-        const auto& row = data[row_num];
-        try {
-            if (filter->apply(row)) {
-                for (const auto& operand : operands) {
-                    OperandValue value = operand->evaluate(row);
-                    if (std::holds_alternative<int>(value)) {
-                        std::cout << std::get<int>(value) << "\t";
-                    }
-                    else if (std::holds_alternative<double>(value)) {
-                        double num = std::get<double>(value);
-                        // Display as integer if no fractional part
-                        if (num == static_cast<int>(num)) {
-                            std::cout << static_cast<int>(num) << "\t";
-                        }
-                        else {
-                            std::cout << num << "\t";
-                        }
-                    }
-                    else if (std::holds_alternative<bool>(value)) {
-                        std::cout << (std::get<bool>(value) ? "true" : "false") << "\t";
-                    }
-                    else if (std::holds_alternative<std::string>(value)) {
-                        std::cout << std::get<std::string>(value) << "\t";
-                    }
-                }
-                std::cout << std::endl;
+        size_t next_error = 0;
+        for (size_t i = 0; i < selection.size(); ++i) {
+            size_t row_num = selection.row(i);
+            for (; next_error < errors.size() && errors[next_error].row < row_num; ++next_error) {
+                reportError(table, errors[next_error]);
             }
+            const std::string* error = nullptr;
+            for (size_t k = 0; k < num_operands && !error; ++k) {
+                error = program.output(k).errorAt(i);
+            }
+            if (error) {
+                reportError(table, { row_num, *error });
+                continue;
+            }
+            for (size_t k = 0; k < num_operands; ++k) {
+                printValue(program.output(k), i);
+            }
+            std::cout << std::endl;
         }
-        catch (const std::exception& e) {
-            std::cerr << "Error processing row " << row_num + 1 << ": " << e.what() << std::endl;
-            // Otherwise, continue processing other rows
+        for (; next_error < errors.size(); ++next_error) {
+            reportError(table, errors[next_error]);
         }
     }
+    profile_.add(program.getProfile());
 }
 
+void QueryExecutor::reportError(const ColumnTable& table, const RowError& error) const {
+    std::cerr << "Error processing row " << table.getRowId(error.row) + 1 << ": " << error.message << std::endl;
+}
@@ -0,0 +1,319 @@
+// QueryOptimizer.cpp
+#include "QueryOptimizer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Value of an IntegerOperand or finite DoubleOperand
+static bool numericConstant(const Operand& operand, double& value) {
+    if (const IntegerOperand* integer = dynamic_cast<const IntegerOperand*>(&operand)) {
+        value = integer->getValue();
+        return true;
+    }
+    if (const DoubleOperand* constant = dynamic_cast<const DoubleOperand*>(&operand)) {
+        value = constant->getValue();
+        return std::isfinite(value);
+    }
+    return false;
+}
+
+// Whether the value is a whole number in int range
+static bool isWhole(double value) {
+    return value == std::floor(value) && value >= std::numeric_limits<int>::min() &&
+           value <= std::numeric_limits<int>::max();
+}
+
+// An int for a whole number, as the bounds of integer columns usually are;
+// either compares the same against any number
+static std::shared_ptr<Operand> constantOperand(double value) {
+    if (isWhole(value)) {
+        return std::make_shared<IntegerOperand>(static_cast<int>(value));
+    }
+    return std::make_shared<DoubleOperand>(value);
+}
+
+static bool satisfies(double value, Comparator comparator, double bound) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+            return value == bound;
+        case Comparator::NOT_EQUAL:
+            return value != bound;
+        case Comparator::GREATER:
+            return value > bound;
+        case Comparator::LESS:
+            return value < bound;
+        case Comparator::GREATER_EQUAL:
+            return value >= bound;
+        case Comparator::LESS_EQUAL:
+            return value <= bound;
+        default:
+            return false;
+    }
+}
+
+// Position of a double in the order of all doubles: the sign bit flipped for
+// positive values and every bit for negative ones, so that the keys of
+// non-NaN doubles compare as the doubles do (-0 just below +0)
+static uint64_t orderedKey(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+static double fromOrderedKey(uint64_t key) {
+    uint64_t bits = (key >> 63) ? key & ~(uint64_t(1) << 63) : ~key;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Lowest finite double passing, where pass fails below some point and holds
+// from it on; found by bisecting the ordered keys of the finite doubles, at
+// most 64 evaluations. False if no finite double passes, or every one does.
+template <typename Pass>
+static bool lowestPassing(Pass pass, double& bound) {
+    const double max = std::numeric_limits<double>::max();
+    if (!pass(max) || pass(-max)) {
+        return false;
+    }
+    // pass fails at low and holds at high
+    uint64_t low = orderedKey(-max);
+    uint64_t high = orderedKey(max);
+    while (high - low > 1) {
+        uint64_t middle = low + (high - low) / 2;
+        if (pass(fromOrderedKey(middle))) {
+            high = middle;
+        }
+        else {
+            low = middle;
+        }
+    }
+    bound = fromOrderedKey(high);
+    return true;
+}
+
+// Highest finite double passing, where pass holds up to some point and fails above it
+template <typename Pass>
+static bool highestPassing(Pass pass, double& bound) {
+    if (!lowestPassing([&pass](double x) { return pass(-x); }, bound)) {
+        return false;
+    }
+    bound = -bound;
+    return true;
+}
+
+// x (op) c or c (op) x, computed in double as ExpressionOperand does, for an
+// operator and constant that make it monotonic in x
+struct MonotonicStep {
+    OperatorType op;
+    double constant;
+    bool constant_on_left;
+
+    double apply(double x) const {
+        switch (op) {
+            case OperatorType::ADD:
+                return constant_on_left ? constant + x : x + constant;
+            case OperatorType::SUBTRACT:
+                return constant_on_left ? constant - x : x - constant;
+            case OperatorType::MULTIPLY:
+                return constant_on_left ? constant * x : x * constant;
+            default:
+                return x / constant;
+        }
+    }
+    bool increasing() const {
+        switch (op) {
+            case OperatorType::ADD:
+                return true;
+            case OperatorType::SUBTRACT:
+                return !constant_on_left;
+            default:
+                return constant > 0;
+        }
+    }
+};
+
+// Split an expression with one constant side into the step and the other side
+static bool monotonicStep(const ExpressionOperand& expression, MonotonicStep& step, std::shared_ptr<Operand>& rest) {
+    step.op = expression.getOperator();
+    if (numericConstant(*expression.getRight(), step.constant) && !expression.getLeft()->isConstant()) {
+        step.constant_on_left = false;
+        rest = expression.getLeft();
+    }
+    else if (numericConstant(*expression.getLeft(), step.constant) && !expression.getRight()->isConstant()) {
+        step.constant_on_left = true;
+        rest = expression.getRight();
+    }
+    else {
+        return false;
+    }
+    switch (step.op) {
+        case OperatorType::ADD:
+        case OperatorType::SUBTRACT:
+            return true;
+        case OperatorType::MULTIPLY:
+            // Times zero every x (but inf and NaN) maps to zero
+            return step.constant != 0;
+        case OperatorType::DIVIDE:
+            // Dividing by zero fails per row; c / x is not monotonic
+            return step.constant != 0 && !step.constant_on_left;
+        default:
+            return false;
+    }
+}
+
+// The x for which step(x) (comparator) value, as x (solved) bound; false if
+// they do not form such a set or the bound is not found
+static bool solveStep(const MonotonicStep& step, Comparator comparator, double value, Comparator& solved,
+                      double& bound) {
+    switch (comparator) {
+        case Comparator::GREATER:
+        case Comparator::GREATER_EQUAL:
+        case Comparator::LESS:
+        case Comparator::LESS_EQUAL: {
+            auto pass = [&step, comparator, value](double x) { return satisfies(step.apply(x), comparator, value); };
+            bool greater = comparator == Comparator::GREATER || comparator == Comparator::GREATER_EQUAL;
+            if (greater == step.increasing()) {
+                solved = Comparator::GREATER_EQUAL;
+                return lowestPassing(pass, bound);
+            }
+            solved = Comparator::LESS_EQUAL;
+            return highestPassing(pass, bound);
+        }
+        case Comparator::EQUAL:
+        case Comparator::NOT_EQUAL: {
+            // Only when a single x maps to the value
+            Comparator up = step.increasing() ? Comparator::GREATER_EQUAL : Comparator::LESS_EQUAL;
+            Comparator down = step.increasing() ? Comparator::LESS_EQUAL : Comparator::GREATER_EQUAL;
+            double low, high;
+            if (!lowestPassing([&step, up, value](double x) { return satisfies(step.apply(x), up, value); }, low) ||
+                !highestPassing([&step, down, value](double x) { return satisfies(step.apply(x), down, value); }, high) ||
+                low != high || step.apply(low) != value) {
+                return false;
+            }
+            solved = comparator;
+            bound = low;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Mirror a comparator so that "constant op x" reads "x op' constant"
+static bool flipComparator(Comparator comparator, Comparator& flipped) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+        case Comparator::NOT_EQUAL:
+            flipped = comparator;
+            return true;
+        case Comparator::GREATER:
+            flipped = Comparator::LESS;
+            return true;
+        case Comparator::LESS:
+            flipped = Comparator::GREATER;
+            return true;
+        case Comparator::GREATER_EQUAL:
+            flipped = Comparator::LESS_EQUAL;
+            return true;
+        case Comparator::LESS_EQUAL:
+            flipped = Comparator::GREATER_EQUAL;
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::shared_ptr<Operand> foldConstants(const std::shared_ptr<Operand>& operand) {
+    std::shared_ptr<ExpressionOperand> expression = std::dynamic_pointer_cast<ExpressionOperand>(operand);
+    if (!expression) {
+        return operand;
+    }
+    std::shared_ptr<Operand> left = foldConstants(expression->getLeft());
+    std::shared_ptr<Operand> right = foldConstants(expression->getRight());
+    std::shared_ptr<Operand> folded = operand;
+    if (left != expression->getLeft() || right != expression->getRight()) {
+        folded = std::make_shared<ExpressionOperand>(left, expression->getOperator(), right);
+    }
+    if (left->isConstant() && right->isConstant()) {
+        try {
+            const std::unordered_map<std::string, std::string> no_row;
+            OperandValue value = folded->evaluate(no_row);
+            if (std::holds_alternative<double>(value)) {
+                return std::make_shared<DoubleOperand>(std::get<double>(value));
+            }
+        }
+        catch (const std::exception&) {
+            // Reported per row as before
+        }
+    }
+    return folded;
+}
+
+std::shared_ptr<ElementFilter> optimizeFilter(const std::shared_ptr<ElementFilter>& filter) {
+    if (std::shared_ptr<CompositeElementFilter> composite = std::dynamic_pointer_cast<CompositeElementFilter>(filter)) {
+        std::shared_ptr<CompositeElementFilter> rewritten = std::make_shared<CompositeElementFilter>();
+        bool changed = false;
+        for (const auto& child : composite->getFilters()) {
+            std::shared_ptr<ElementFilter> optimized = optimizeFilter(child);
+            changed = changed || optimized != child;
+            rewritten->addFilter(optimized);
+        }
+        return changed ? rewritten : filter;
+    }
+    std::shared_ptr<WhereFilter> where = std::dynamic_pointer_cast<WhereFilter>(filter);
+    if (!where) {
+        return filter;
+    }
+
+    std::shared_ptr<Operand> left = foldConstants(where->getLeft());
+    std::shared_ptr<Operand> right = foldConstants(where->getRight());
+    Comparator comparator = where->getComparator();
+    Comparator flipped;
+    if (left->isConstant() && !right->isConstant() && flipComparator(comparator, flipped)) {
+        std::swap(left, right);
+        comparator = flipped;
+    }
+
+    // Peel constant arithmetic off the left side one operator at a time
+    double value;
+    bool moved = false;
+    if (comparator != Comparator::IN && numericConstant(*right, value)) {
+        while (std::shared_ptr<ExpressionOperand> expression = std::dynamic_pointer_cast<ExpressionOperand>(left)) {
+            MonotonicStep step;
+            std::shared_ptr<Operand> rest;
+            Comparator solved;
+            double bound;
+            if (!monotonicStep(*expression, step, rest) || !solveStep(step, comparator, value, solved, bound)) {
+                break;
+            }
+            left = rest;
+            comparator = solved;
+            value = bound;
+            moved = true;
+        }
+        if (moved) {
+            // Prefer an int bound, moving to the strict comparator if needed
+            const double infinity = std::numeric_limits<double>::infinity();
+            if (comparator == Comparator::GREATER_EQUAL && !isWhole(value) &&
+                isWhole(std::nextafter(value, -infinity))) {
+                comparator = Comparator::GREATER;
+                value = std::nextafter(value, -infinity);
+            }
+            else if (comparator == Comparator::LESS_EQUAL && !isWhole(value) &&
+                     isWhole(std::nextafter(value, infinity))) {
+                comparator = Comparator::LESS;
+                value = std::nextafter(value, infinity);
+            }
+            right = constantOperand(value);
+        }
+    }
+
+    if (left == where->getLeft() && right == where->getRight() && comparator == where->getComparator()) {
+        return filter;
+    }
+    // What was left of the arithmetic still reports its error for a non-numeric value
+    bool numeric_left = where->isNumericLeft() || moved;
+    return std::make_shared<WhereFilter>(left, comparator, right, numeric_left);
+}
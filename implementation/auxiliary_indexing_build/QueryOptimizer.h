@@ -0,0 +1,30 @@
+// QueryOptimizer.h
+#ifndef QUERYOPTIMIZER_H
+#define QUERYOPTIMIZER_H
+
+#include "Operand.h"
+#include "ElementFilter.h"
+#include <memory>
+
+// Rewrites that leave the value (or error) of every row unchanged. They run
+// on the query as written, before the columns it reads are known, so they
+// may not depend on column types.
+
+// Fold each constant sub-expression into a DoubleOperand, e.g. 60000 + 5000
+// into 65000. A constant that fails to evaluate (division by zero) is kept,
+// and reported per row as before.
+std::shared_ptr<Operand> foldConstants(const std::shared_ptr<Operand>& operand);
+
+// Fold the constants of a WHERE comparison, put its non-constant side on the
+// left, and move arithmetic with a constant over to the constant side, so
+// that salary + 5000 >= 65000 becomes salary >= 60000 and can be pushed into
+// the scan or answered from an index. The new constant is the exact bound of
+// the rows that passed: the arithmetic is done in double and is monotonic in
+// the column, so the bound is found by bisecting the doubles in order. A text
+// or bool value left on the column side is still reported with the
+// arithmetic's "Operands must be numeric" error (WhereFilter numeric_left).
+// Composite filters are rewritten filter by filter; other filters are
+// returned as they are.
+std::shared_ptr<ElementFilter> optimizeFilter(const std::shared_ptr<ElementFilter>& filter);
+
+#endif // QUERYOPTIMIZER_H
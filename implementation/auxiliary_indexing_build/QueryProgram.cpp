@@ -0,0 +1,190 @@
+// QueryProgram.cpp
+#include "QueryProgram.h"
+#include <stdexcept>
+
+const char* opcodeName(OpCode opcode) {
+    switch (opcode) {
+        case OpCode::LOAD_COLUMN:
+            return "LOAD_COLUMN";
+        case OpCode::ARITHMETIC:
+            return "ARITHMETIC";
+        case OpCode::COMPARE:
+            return "COMPARE";
+        case OpCode::EVALUATE:
+            return "EVALUATE";
+        case OpCode::FILTER:
+            return "FILTER";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+void ProgramProfile::add(const ProgramProfile& other) {
+    for (size_t op = 0; op < NUM_OPCODES; ++op) {
+        instructions[op] += other.instructions[op];
+        rows[op] += other.rows[op];
+    }
+}
+
+void ProgramProfile::print(std::ostream& out) const {
+    for (size_t op = 0; op < NUM_OPCODES; ++op) {
+        if (instructions[op] > 0) {
+            out << opcodeName(static_cast<OpCode>(op)) << ": " << instructions[op] << " instructions over "
+                << rows[op] << " rows" << std::endl;
+        }
+    }
+}
+
+QueryProgram::QueryProgram(const ElementSelect& select, const ColumnTable& table) {
+    lowerFilter(select.getFilter(), table);
+    for (const auto& operand : select.getOperands()) {
+        outputs_.push_back(lowerProjection(operand, table));
+    }
+}
+
+void QueryProgram::run(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors) {
+    for (const Instruction& instruction : code_) {
+        bool narrows = instruction.opcode == OpCode::COMPARE || instruction.opcode == OpCode::FILTER;
+        if (narrows && selection.size() == 0) {
+            // As CompositeElementFilter, no filter sees an empty batch
+            continue;
+        }
+        size_t op = static_cast<size_t>(instruction.opcode);
+        profile_.instructions[op]++;
+        profile_.rows[op] += selection.size();
+
+        switch (instruction.opcode) {
+            case OpCode::LOAD_COLUMN:
+                loadColumnBatch(table.getColumn(instruction.slot), selection, registers_[instruction.target]);
+                break;
+            case OpCode::ARITHMETIC: {
+                const auto& inputs = inputs_[instruction.slot];
+                instruction.arithmetic(inputs.first, inputs.second, table, selection, read(instruction.left_register),
+                                       read(instruction.right_register), registers_[instruction.target]);
+                break;
+            }
+            case OpCode::COMPARE: {
+                const auto& inputs = inputs_[instruction.slot];
+                instruction.comparison(inputs.first, inputs.second, table, selection, read(instruction.left_register),
+                                       read(instruction.right_register), errors);
+                break;
+            }
+            case OpCode::EVALUATE:
+                operands_[instruction.slot]->evaluateBatch(table, selection, registers_[instruction.target]);
+                break;
+            case OpCode::FILTER:
+                filters_[instruction.slot]->applyBatch(table, selection, errors);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void QueryProgram::lowerFilter(const std::shared_ptr<ElementFilter>& filter, const ColumnTable& table) {
+    if (std::shared_ptr<CompositeElementFilter> composite = std::dynamic_pointer_cast<CompositeElementFilter>(filter)) {
+        for (const auto& child : composite->getFilters()) {
+            lowerFilter(child, table);
+        }
+        return;
+    }
+    std::shared_ptr<WhereFilter> where = std::dynamic_pointer_cast<WhereFilter>(filter);
+    if (where && lowerComparison(*where, table)) {
+        return;
+    }
+    Instruction instruction(OpCode::FILTER);
+    instruction.slot = static_cast<uint32_t>(filters_.size());
+    filters_.push_back(filter);
+    code_.push_back(instruction);
+}
+
+bool QueryProgram::lowerComparison(const WhereFilter& filter, const ColumnTable& table) {
+    Mark start = mark();
+    CompiledExpression::Input left, right;
+    Instruction instruction(OpCode::COMPARE);
+    if (lowerInput(*filter.getLeft(), table, left, instruction.left_register) &&
+        lowerInput(*filter.getRight(), table, right, instruction.right_register)) {
+        instruction.comparison = CompiledComparison::kernelFor(left.kind, filter.getComparator(), right.kind);
+        if (instruction.comparison) {
+            instruction.slot = static_cast<uint32_t>(inputs_.size());
+            inputs_.emplace_back(std::move(left), std::move(right));
+            code_.push_back(instruction);
+            return true;
+        }
+    }
+    rollback(start);
+    return false;
+}
+
+bool QueryProgram::lowerExpression(const ExpressionOperand& expression, const ColumnTable& table, uint16_t& target) {
+    CompiledExpression::Input left, right;
+    Instruction instruction(OpCode::ARITHMETIC);
+    if (!lowerInput(*expression.getLeft(), table, left, instruction.left_register) ||
+        !lowerInput(*expression.getRight(), table, right, instruction.right_register)) {
+        return false;
+    }
+    instruction.arithmetic = CompiledExpression::kernelFor(left.kind, expression.getOperator(), right.kind);
+    if (!instruction.arithmetic) {
+        return false;
+    }
+    instruction.target = newRegister();
+    instruction.slot = static_cast<uint32_t>(inputs_.size());
+    inputs_.emplace_back(std::move(left), std::move(right));
+    code_.push_back(instruction);
+    target = instruction.target;
+    return true;
+}
+
+bool QueryProgram::lowerInput(const Operand& operand, const ColumnTable& table, CompiledExpression::Input& input,
+                              uint16_t& target) {
+    if (CompiledExpression::resolveLeaf(operand, table, input)) {
+        return true;
+    }
+    const ExpressionOperand* expression = dynamic_cast<const ExpressionOperand*>(&operand);
+    if (expression && lowerExpression(*expression, table, target)) {
+        input.kind = KernelInput::DOUBLE_VECTOR;
+        return true;
+    }
+    return false;
+}
+
+uint16_t QueryProgram::lowerProjection(const std::shared_ptr<Operand>& operand, const ColumnTable& table) {
+    if (const ColumnOperand* column = dynamic_cast<const ColumnOperand*>(operand.get())) {
+        int ordinal = column->getOrdinal(table);
+        if (ordinal >= 0) {
+            Instruction instruction(OpCode::LOAD_COLUMN);
+            instruction.target = newRegister();
+            instruction.slot = static_cast<uint32_t>(ordinal);
+            code_.push_back(instruction);
+            return instruction.target;
+        }
+    }
+    else if (const ExpressionOperand* expression = dynamic_cast<const ExpressionOperand*>(operand.get())) {
+        Mark start = mark();
+        uint16_t target;
+        if (lowerExpression(*expression, table, target)) {
+            return target;
+        }
+        rollback(start);
+    }
+    Instruction instruction(OpCode::EVALUATE);
+    instruction.target = newRegister();
+    instruction.slot = static_cast<uint32_t>(operands_.size());
+    operands_.push_back(operand);
+    code_.push_back(instruction);
+    return instruction.target;
+}
+
+uint16_t QueryProgram::newRegister() {
+    if (registers_.size() >= NO_REGISTER) {
+        throw std::runtime_error("Query needs more registers than a program can address.");
+    }
+    registers_.emplace_back();
+    return static_cast<uint16_t>(registers_.size() - 1);
+}
+
+void QueryProgram::rollback(const Mark& to) {
+    code_.erase(code_.begin() + to.code, code_.end());
+    registers_.erase(registers_.begin() + to.registers, registers_.end());
+    inputs_.erase(inputs_.begin() + to.inputs, inputs_.end());
+}
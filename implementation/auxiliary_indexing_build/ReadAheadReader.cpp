@@ -0,0 +1,310 @@
+// ReadAheadReader.cpp
+#include "ReadAheadReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Raw io_uring setup; the kernel headers are enough, no liburing needed
+struct ReadAheadReader::Ring {
+    int fd = -1;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_size = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+            munmap(cq_ptr, cq_size);
+        }
+        if (sq_ptr != MAP_FAILED) {
+            munmap(sq_ptr, sq_size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+ReadAheadReader::ReadAheadReader(size_t block_size, size_t depth)
+    : block_size_(block_size), depth_(depth), window_(0), fd_(-1), next_block_(0), finished_(false), failed_(false),
+      in_flight_(0), stop_(false) {}
+
+ReadAheadReader::~ReadAheadReader() {
+    close();
+}
+
+bool ReadAheadReader::open(const std::string& filename) {
+    close();
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+    next_block_ = 0;
+    finished_ = false;
+    failed_ = false;
+    stop_ = false;
+    // A small file needs no more buffers than it has blocks (plus the empty one after them)
+    struct stat st;
+    window_ = depth_;
+    if (fstat(fd_, &st) == 0) {
+        window_ = std::min<uint64_t>(depth_, static_cast<uint64_t>(st.st_size) / block_size_ + 1);
+    }
+    if (window_ <= 1) {
+        window_ = 0;
+        return true;
+    }
+    // Ask the kernel for aggressive readahead on top of our own window
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    slots_.resize(window_);
+    for (auto& slot : slots_) {
+        slot.data.reset(new char[block_size_]);
+        slot.ready = false;
+    }
+    if (setupRing()) {
+        for (uint64_t block = 0; block < window_; ++block) {
+            submitRead(block);
+        }
+    }
+    else {
+        reader_ = std::thread(&ReadAheadReader::readerLoop, this);
+    }
+    return true;
+}
+
+void ReadAheadReader::close() {
+    if (reader_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        reader_.join();
+    }
+    // The kernel may still be writing into the slots
+    while (ring_ && in_flight_ > 0 && reapCompletions()) {
+    }
+    ring_.reset();
+    in_flight_ = 0;
+    slots_.clear();
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+size_t ReadAheadReader::read(char* dest) {
+    if (fd_ < 0 || finished_) {
+        return 0;
+    }
+    int64_t result;
+    if (window_ == 0) {
+        result = readBlock(next_block_, dest, 0);
+    }
+    else {
+        Slot& slot = slots_[next_block_ % window_];
+        if (ring_) {
+            while (!slot.ready) {
+                if (!reapCompletions()) {
+                    finished_ = true;
+                    failed_ = true;
+                    return 0;
+                }
+            }
+        }
+        else {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&slot] { return slot.ready; });
+        }
+        // The producer does not touch this slot until next_block_ moves past it
+        result = slot.result;
+        if (result < 0) {
+            // A failed asynchronous read (e.g. an opcode the kernel lacks) is retried in place
+            result = readBlock(next_block_, slot.data.get(), 0);
+        }
+        else if (ring_ && static_cast<size_t>(result) < block_size_) {
+            // io_uring may stop short of the end of the file; finish the block
+            result = readBlock(next_block_, slot.data.get(), static_cast<size_t>(result));
+        }
+        if (result > 0) {
+            memcpy(dest, slot.data.get(), result);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot.ready = false;
+    }
+
+    if (result < 0) {
+        std::cerr << "Failed to read block " << next_block_ << ": " << strerror(static_cast<int>(-result)) << std::endl;
+        finished_ = true;
+        failed_ = true;
+        return 0;
+    }
+    if (static_cast<size_t>(result) < block_size_) {
+        finished_ = true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_block_++;
+    }
+    if (ring_ && !finished_) {
+        submitRead(next_block_ + window_ - 1);
+    }
+    else if (reader_.joinable()) {
+        cv_.notify_all();
+    }
+    return static_cast<size_t>(result);
+}
+
+int64_t ReadAheadReader::readBlock(uint64_t block, char* dest, size_t done) const {
+    off_t offset = static_cast<off_t>(block * block_size_);
+    // pread may return less than asked before the end of the file
+    while (done < block_size_) {
+        ssize_t got = pread(fd_, dest + done, block_size_ - done, offset + done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += got;
+    }
+    return static_cast<int64_t>(done);
+}
+
+void ReadAheadReader::readerLoop() {
+    for (uint64_t block = 0;; ++block) {
+        Slot& slot = slots_[block % window_];
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [&] { return stop_ || block < next_block_ + window_; });
+            if (stop_) {
+                return;
+            }
+        }
+        int64_t result = readBlock(block, slot.data.get(), 0);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot.result = result;
+            slot.ready = true;
+        }
+        cv_.notify_all();
+        if (result < static_cast<int64_t>(block_size_)) {
+            return;
+        }
+    }
+}
+
+bool ReadAheadReader::setupRing() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    auto ring = std::make_unique<Ring>();
+    ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(window_), &params));
+    if (ring->fd < 0) {
+        // Old kernel, or io_uring disabled (seccomp, sysctl)
+        return false;
+    }
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        ring->sq_size = ring->cq_size = std::max(ring->sq_size, ring->cq_size);
+    }
+    ring->sq_ptr = mmap(nullptr, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        return false;
+    }
+    ring->cq_ptr = single_mmap ? ring->sq_ptr
+                               : mmap(nullptr, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                      ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ptr == MAP_FAILED) {
+        return false;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    ring->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+    if (ring->sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(ring->sq_ptr);
+    char* cq = static_cast<char*>(ring->cq_ptr);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    ring_ = std::move(ring);
+    return true;
+}
+
+void ReadAheadReader::submitRead(uint64_t block) {
+    Ring& ring = *ring_;
+    Slot& slot = slots_[block % window_];
+    slot.ready = false;
+    unsigned tail = *ring.sq_tail;
+    unsigned index = tail & *ring.sq_mask;
+    io_uring_sqe& sqe = ring.sqes[index];
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd_;
+    sqe.addr = reinterpret_cast<uint64_t>(slot.data.get());
+    sqe.len = static_cast<uint32_t>(block_size_);
+    sqe.off = block * block_size_;
+    sqe.user_data = block;
+    ring.sq_array[index] = index;
+    __atomic_store_n(ring.sq_tail, tail + 1, __ATOMIC_RELEASE);
+    in_flight_++;
+    if (syscall(__NR_io_uring_enter, ring.fd, 1, 0, 0, nullptr, 0) < 0) {
+        // Not submitted: complete it as failed so read() retries synchronously
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+        in_flight_--;
+        slot.result = -errno;
+        slot.ready = true;
+    }
+}
+
+bool ReadAheadReader::reapCompletions() {
+    Ring& ring = *ring_;
+    unsigned head = *ring.cq_head;
+    while (head == __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+            errno != EINTR) {
+            std::cerr << "io_uring wait failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    do {
+        const io_uring_cqe& cqe = ring.cqes[head & *ring.cq_mask];
+        Slot& slot = slots_[cqe.user_data % window_];
+        slot.result = cqe.res;
+        slot.ready = true;
+        in_flight_--;
+        head++;
+    } while (head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE));
+    __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    return true;
+}
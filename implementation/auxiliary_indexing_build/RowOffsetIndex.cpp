@@ -0,0 +1,220 @@
+// RowOffsetIndex.cpp
+#include "RowOffsetIndex.h"
+#include "CSVScanner.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+// File layout (native endianness):
+//   IndexHeader
+//   checkpoint offsets         uint64[num_checkpoints]
+//   checkpoint positions       uint64[num_checkpoints]
+//   record lengths             varint bytes[delta_bytes]
+static const char INDEX_MAGIC[8] = { 'C', 'S', 'V', 'R', 'O', 'W', 'I', 'X' };
+static const uint32_t INDEX_VERSION = 1;
+
+struct IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t checkpoint_rows;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t num_rows;
+    uint64_t data_begin;
+    uint64_t data_end;
+    uint64_t num_checkpoints;
+    uint64_t delta_bytes;
+};
+
+RowOffsetIndex::RowOffsetIndex(const std::string& csv_filename)
+    : csv_filename_(csv_filename), index_path_(csv_filename + ".rowidx") {}
+
+bool RowOffsetIndex::statSource(uint64_t& size, int64_t& mtime_sec, int64_t& mtime_nsec) const {
+    struct stat st;
+    if (stat(csv_filename_.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_sec = static_cast<int64_t>(st.st_mtim.tv_sec);
+    mtime_nsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+void RowOffsetIndex::clear() {
+    num_rows_ = 0;
+    data_begin_ = 0;
+    data_end_ = 0;
+    checkpoint_offsets_.clear();
+    checkpoint_positions_.clear();
+    deltas_.clear();
+}
+
+bool RowOffsetIndex::open() {
+    clear();
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    if (!statSource(size, mtime_sec, mtime_nsec)) {
+        return false;
+    }
+    std::ifstream in(index_path_, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    IndexHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.version != INDEX_VERSION ||
+        header.checkpoint_rows != CHECKPOINT_ROWS || header.source_size != size ||
+        header.source_mtime_sec != mtime_sec || header.source_mtime_nsec != mtime_nsec) {
+        return false;
+    }
+    // Every record is at least one byte long, and so is its delta
+    if (header.num_rows > size || header.delta_bytes > size * 10 ||
+        header.num_checkpoints != (header.num_rows + CHECKPOINT_ROWS - 1) / CHECKPOINT_ROWS ||
+        header.data_begin > header.data_end || header.data_end > size) {
+        return false;
+    }
+
+    checkpoint_offsets_.resize(header.num_checkpoints);
+    checkpoint_positions_.resize(header.num_checkpoints);
+    deltas_.resize(header.delta_bytes);
+    in.read(reinterpret_cast<char*>(checkpoint_offsets_.data()), header.num_checkpoints * sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(checkpoint_positions_.data()), header.num_checkpoints * sizeof(uint64_t));
+    in.read(reinterpret_cast<char*>(deltas_.data()), header.delta_bytes);
+    if (!in) {
+        clear();
+        return false;
+    }
+    for (uint64_t position : checkpoint_positions_) {
+        if (position > deltas_.size()) {
+            clear();
+            return false;
+        }
+    }
+
+    source_size_ = size;
+    source_mtime_sec_ = mtime_sec;
+    source_mtime_nsec_ = mtime_nsec;
+    num_rows_ = header.num_rows;
+    data_begin_ = header.data_begin;
+    data_end_ = header.data_end;
+    return true;
+}
+
+bool RowOffsetIndex::build() {
+    clear();
+    if (!statSource(source_size_, source_mtime_sec_, source_mtime_nsec_)) {
+        std::cerr << "Failed to open file: " << csv_filename_ << std::endl;
+        return false;
+    }
+    MappedFile csv;
+    if (!csv.open(csv_filename_)) {
+        return false;
+    }
+    const char* base = csv.data();
+    const char* end = base + csv.size();
+    CSVScanner scanner;
+    const char* body = scanner.findRecordStart(base, end, false);
+    data_begin_ = body - base;
+
+    // Records are delimited exactly as CSVLoader assigns row ids, blank lines included
+    uint64_t offset = data_begin_;
+    auto appendRecord = [&](uint64_t length) {
+        if (num_rows_ % CHECKPOINT_ROWS == 0) {
+            checkpoint_offsets_.push_back(offset);
+            checkpoint_positions_.push_back(deltas_.size());
+        }
+        offset += length;
+        while (length >= 0x80) {
+            deltas_.push_back(static_cast<uint8_t>(length | 0x80));
+            length >>= 7;
+        }
+        deltas_.push_back(static_cast<uint8_t>(length));
+        num_rows_++;
+    };
+    scanner.forEachRecordEnd(body, end, [&](const char* record_end) {
+        appendRecord((record_end - base) - offset);
+    });
+    // Final record without a trailing newline
+    if (offset < csv.size()) {
+        appendRecord(csv.size() - offset);
+    }
+    data_end_ = offset;
+    return write();
+}
+
+bool RowOffsetIndex::openOrBuild() {
+    return open() || build();
+}
+
+bool RowOffsetIndex::write() const {
+    std::string tmp_path = index_path_ + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file for writing: " << tmp_path << std::endl;
+        return false;
+    }
+    IndexHeader header = IndexHeader();
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.checkpoint_rows = CHECKPOINT_ROWS;
+    header.source_size = source_size_;
+    header.source_mtime_sec = source_mtime_sec_;
+    header.source_mtime_nsec = source_mtime_nsec_;
+    header.num_rows = num_rows_;
+    header.data_begin = data_begin_;
+    header.data_end = data_end_;
+    header.num_checkpoints = checkpoint_offsets_.size();
+    header.delta_bytes = deltas_.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(checkpoint_offsets_.data()), checkpoint_offsets_.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(checkpoint_positions_.data()), checkpoint_positions_.size() * sizeof(uint64_t));
+    out.write(reinterpret_cast<const char*>(deltas_.data()), deltas_.size());
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write row offset index: " << tmp_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), index_path_.c_str()) != 0) {
+        std::cerr << "Failed to replace row offset index: " << index_path_ << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+uint64_t RowOffsetIndex::offsetOf(uint64_t row) const {
+    if (row == num_rows_) {
+        return data_end_;
+    }
+    uint64_t offset = checkpoint_offsets_[row / CHECKPOINT_ROWS];
+    size_t position = checkpoint_positions_[row / CHECKPOINT_ROWS];
+    for (uint64_t skip = row % CHECKPOINT_ROWS; skip > 0; --skip) {
+        uint64_t length = 0;
+        int shift = 0;
+        // Bounded by the buffer so a corrupt index cannot read past it
+        while (position < deltas_.size() && shift < 64) {
+            uint8_t byte = deltas_[position++];
+            length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        offset += length;
+    }
+    return offset;
+}
+
+bool RowOffsetIndex::rowRange(uint64_t first_row, uint64_t count, uint64_t& begin, uint64_t& end) const {
+    if (count == 0 || first_row >= num_rows_ || count > num_rows_ - first_row) {
+        return false;
+    }
+    begin = offsetOf(first_row);
+    end = offsetOf(first_row + count);
+    return begin <= end && end <= data_end_;
+}
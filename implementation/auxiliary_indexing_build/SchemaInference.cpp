@@ -0,0 +1,277 @@
+// SchemaInference.cpp
+#include "SchemaInference.h"
+#include <charconv>
+#include <memory>
+#include <utility>
+
+void CellCounts::add(std::string_view cell) {
+    if (cell.empty()) {
+        return;
+    }
+    values++;
+    int64_t int_val;
+    double double_val;
+    bool bool_val;
+    if (parseInt64(cell, int_val) == ParseStatus::OK) {
+        ints++;
+        numbers++;
+    }
+    else if (parseDouble(cell, double_val) == ParseStatus::OK) {
+        numbers++;
+    }
+    if (parseBool(cell, bool_val) == ParseStatus::OK) {
+        bools++;
+    }
+}
+
+ColumnType CellCounts::type() const {
+    if (values == 0) {
+        return ColumnType::STRING;
+    }
+    if (bools == values) {
+        return ColumnType::BOOL;
+    }
+    // Most cells are numbers; the others will be strays
+    if (numbers * 2 > values) {
+        return ints == numbers ? ColumnType::INT64 : ColumnType::DOUBLE;
+    }
+    return ColumnType::STRING;
+}
+
+ColumnType inferColumnType(const Column& column, size_t sample_rows) {
+    if (column.getType() != ColumnType::STRING) {
+        return column.getType();
+    }
+    size_t rows = column.size();
+    size_t stride = (sample_rows == 0 || sample_rows >= rows) ? 1 : rows / sample_rows;
+
+    CellCounts counts;
+    for (size_t row = 0; row < rows; row += stride) {
+        if (!column.isMissing(row)) {
+            counts.add(column.getString(row));
+        }
+    }
+    return counts.type();
+}
+
+// Whether the value appended for a cell renders back as the cell, as
+// Column::formatValue would, without building the string
+static bool rendersAs(const Column& column, size_t row, std::string_view cell) {
+    switch (column.getType()) {
+        case ColumnType::INT64: {
+            // Digits with an optional minus sign, no leading zero, and not "-0"
+            size_t digits = !cell.empty() && cell[0] == '-' ? 1 : 0;
+            if (digits == cell.size() || (cell[digits] == '0' && (cell.size() > 1))) {
+                return false;
+            }
+            for (size_t i = digits; i < cell.size(); ++i) {
+                if (cell[i] < '0' || cell[i] > '9') {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case ColumnType::DOUBLE: {
+            char buf[32];
+            auto result = std::to_chars(buf, buf + sizeof(buf), column.getDouble(row));
+            return cell == std::string_view(buf, result.ptr - buf);
+        }
+        case ColumnType::BOOL:
+            return cell == (column.getBool(row) ? "true" : "false");
+        default:
+            return true;
+    }
+}
+
+bool appendTypedCell(Column& column, std::string_view cell) {
+    const size_t row = column.size();
+    if (column.getType() == ColumnType::STRING) {
+        column.appendString(cell);
+        return true;
+    }
+    bool stored = true;
+    if (cell.empty()) {
+        column.appendMissing();
+        column.keepText(row, cell);
+        return true;
+    }
+    switch (column.getType()) {
+        case ColumnType::INT64: {
+            int64_t value;
+            double double_value;
+            if (parseInt64(cell, value) == ParseStatus::OK) {
+                column.appendInt(value);
+            }
+            else if (parseDouble(cell, double_value) == ParseStatus::OK) {
+                // A number the column has to widen for
+                return false;
+            }
+            else {
+                stored = false;
+            }
+            break;
+        }
+        case ColumnType::DOUBLE: {
+            double value;
+            if (parseDouble(cell, value) == ParseStatus::OK) {
+                column.appendDouble(value);
+            }
+            else {
+                stored = false;
+            }
+            break;
+        }
+        case ColumnType::BOOL: {
+            bool value;
+            if (parseBool(cell, value) == ParseStatus::OK) {
+                column.appendBool(value);
+            }
+            else {
+                stored = false;
+            }
+            break;
+        }
+        case ColumnType::STRING:
+            break;
+    }
+    if (!stored) {
+        // A stray: NULL to typed readers, its text to everyone else
+        column.appendMissing();
+        column.keepText(row, cell);
+    }
+    else if (!rendersAs(column, row, cell)) {
+        // "1.50", " 7" or "TRUE" read back as "1.5", "7" and "true"
+        column.keepText(row, cell);
+    }
+    return true;
+}
+
+bool convertColumn(const Column& source, ColumnType type, Column& target) {
+    target = Column(source.getName(), type, target.getResource());
+    target.reserve(source.size());
+    for (size_t row = 0; row < source.size(); ++row) {
+        if (source.isMissing(row)) {
+            target.appendMissing();
+            continue;
+        }
+        if (!appendTypedCell(target, source.getString(row))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ColumnType applyColumnType(ColumnTable& table, size_t index, ColumnType type) {
+    const Column& source = table.getColumn(index);
+    if (type == ColumnType::STRING) {
+        return type;
+    }
+    Column converted(source.getName(), ColumnType::STRING, table.getResource());
+    if (!convertColumn(source, type, converted)) {
+        // A non-integral number; every number fits a DOUBLE column
+        type = ColumnType::DOUBLE;
+        convertColumn(source, type, converted);
+    }
+    table.replaceColumn(index, std::move(converted));
+    return type;
+}
+
+ColumnType inferColumn(ColumnTable& table, size_t index, size_t sample_rows) {
+    return applyColumnType(table, index, inferColumnType(table.getColumn(index), sample_rows));
+}
+
+bool dictionaryEncode(ColumnTable& table, size_t index, size_t max_entries) {
+    const Column& source = table.getColumn(index);
+    if (source.getType() != ColumnType::STRING || source.isDictionaryEncoded() || max_entries == 0) {
+        return false;
+    }
+    auto dictionary = std::make_shared<StringDictionary>(table.getResource());
+    Column encoded(source.getName(), ColumnType::STRING, table.getResource());
+    encoded.setDictionary(dictionary);
+    encoded.reserve(source.size());
+    for (size_t row = 0; row < source.size(); ++row) {
+        if (source.isMissing(row)) {
+            encoded.appendMissing();
+        }
+        else {
+            encoded.appendString(source.getString(row));
+        }
+        // Too many distinct values to pay off; keep the plain column
+        if (dictionary->size() > max_entries) {
+            return false;
+        }
+    }
+    table.replaceColumn(index, std::move(encoded));
+    return true;
+}
+
+// The cells of an INT64 column as DOUBLE
+static Column widened(const Column& source, std::pmr::memory_resource* resource) {
+    Column result(source.getName(), ColumnType::DOUBLE, resource);
+    result.reserve(source.size());
+    size_t next_text = 0;
+    for (size_t row = 0; row < source.size(); ++row) {
+        bool kept = next_text < source.keptTextCount() && source.keptTextRow(next_text) == row;
+        if (source.isMissing(row)) {
+            result.appendMissing();
+        }
+        else {
+            result.appendDouble(static_cast<double>(source.getInt(row)));
+        }
+        if (kept) {
+            result.keepText(row, source.keptTextAt(next_text++));
+        }
+        else if (!source.isMissing(row) && result.formatValue(row) != source.formatValue(row)) {
+            // 3000000000 renders as 3e+09
+            result.keepText(row, source.formatValue(row));
+        }
+    }
+    return result;
+}
+
+void widenColumn(ColumnTable& table, size_t index) {
+    const Column& source = table.getColumn(index);
+    table.replaceColumn(index, widened(source, source.getResource()));
+}
+
+void appendCell(ColumnTable& table, size_t index, std::string_view cell) {
+    if (!appendTypedCell(table.getColumn(index), cell)) {
+        widenColumn(table, index);
+        appendTypedCell(table.getColumn(index), cell);
+    }
+}
+
+void appendCells(ColumnTable& table, size_t index, const Column& source) {
+    Column& target = table.getColumn(index);
+    if (target.getType() == ColumnType::INT64 && source.getType() == ColumnType::DOUBLE) {
+        widenColumn(table, index);
+    }
+    ColumnType type = table.getColumn(index).getType();
+    if (type == ColumnType::DOUBLE && source.getType() == ColumnType::INT64) {
+        table.getColumn(index).appendColumn(widened(source, source.getResource()));
+        return;
+    }
+    if (type == source.getType() && type != ColumnType::STRING) {
+        table.getColumn(index).appendColumn(source);
+        return;
+    }
+    // Cell by cell: STRING cells are copied (or typed), typed ones go by their text
+    table.getColumn(index).reserve(table.getColumn(index).size() + source.size());
+    std::string_view text;
+    for (size_t row = 0; row < source.size(); ++row) {
+        if (source.getType() == ColumnType::STRING) {
+            if (source.isMissing(row)) {
+                table.getColumn(index).appendMissing();
+            }
+            else {
+                appendCell(table, index, source.getString(row));
+            }
+        }
+        else if (source.isMissing(row) && !source.keptText(row, text)) {
+            table.getColumn(index).appendMissing();
+        }
+        else {
+            appendCell(table, index, source.toString(row));
+        }
+    }
+}
@@ -0,0 +1,74 @@
+// SchemaInference.h
+#ifndef SCHEMAINFERENCE_H
+#define SCHEMAINFERENCE_H
+
+#include "ColumnTable.h"
+#include "NumericParse.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Kinds of the non-empty cells of a column seen so far, from which its type
+// is inferred
+struct CellCounts {
+    uint64_t values = 0;        // Non-empty cells
+    uint64_t ints = 0;          // Cells that parse as int64
+    uint64_t numbers = 0;       // Cells that parse as int64 or double
+    uint64_t bools = 0;         // Cells that parse as bool
+
+    void add(std::string_view cell);
+    // The narrowest type (INT64, DOUBLE, BOOL, else STRING) that fits every
+    // cell. A column of mostly numbers stays numeric, so a few stray cells in
+    // a dirty feed do not turn it into text; those cells keep their text and
+    // evaluate as it, as in a row map. STRING if no value was seen.
+    ColumnType type() const;
+};
+
+// Column types of a table by name, decided from a sample of its records
+// before any of them is filtered or stored
+using TableSchema = std::unordered_map<std::string, ColumnType>;
+
+// Infer the type of a STRING column from its non-empty cells, as
+// CellCounts::type. A sample_rows of 0 inspects every row; otherwise an evenly
+// strided sample of that many rows is used.
+ColumnType inferColumnType(const Column& column, size_t sample_rows);
+
+// Append a cell to a column. A cell of an INT64, DOUBLE or BOOL column that
+// is not a value of its type is stored as a stray (see Column::keepText), and
+// the source text of a cell that does not render back the same (including an
+// empty one, which is NULL) is kept. Returns false, appending nothing, if an
+// INT64 column has to widen to DOUBLE for the cell.
+bool appendTypedCell(Column& column, std::string_view cell);
+
+// Convert a STRING column to typed storage with appendTypedCell. Returns
+// false if an INT64 column holds a non-integral number.
+bool convertColumn(const Column& source, ColumnType type, Column& target);
+
+// Convert one STRING column of the table in place to the given type, widening
+// INT64 to DOUBLE if a cell needs it. Returns the type used.
+ColumnType applyColumnType(ColumnTable& table, size_t index, ColumnType type);
+
+// Infer and convert one column of the table in place. If a sampled INT64
+// type turns out not to fit every cell, it is widened as in applyColumnType.
+ColumnType inferColumn(ColumnTable& table, size_t index, size_t sample_rows);
+
+// Re-store a STRING column of the table as codes into its own dictionary if it
+// holds at most max_entries distinct values. Returns whether it was encoded.
+bool dictionaryEncode(ColumnTable& table, size_t index, size_t max_entries);
+
+// Re-store an INT64 column of the table as DOUBLE, the type its sample turned
+// out wrong for. Values that render differently as a double keep their text.
+void widenColumn(ColumnTable& table, size_t index);
+
+// Append a cell to a column of the table with appendTypedCell, widening an
+// INT64 column to DOUBLE first if the cell needs it
+void appendCell(ColumnTable& table, size_t index, std::string_view cell);
+
+// Append the cells of a column of another table (e.g. another file or chunk
+// of the same table) to a column of the table, wherever the source keeps
+// them. A typed column widens as in appendCell; cells of a STRING column are
+// typed on the way, and typed cells go into a STRING column as their text.
+void appendCells(ColumnTable& table, size_t index, const Column& source);
+
+#endif // SCHEMAINFERENCE_H
@@ -0,0 +1,516 @@
+// TableFiles.cpp
+#include "TableFiles.h"
+#include "CSVLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <glob.h>
+#include <iostream>
+#include <limits>
+#include <sys/stat.h>
+#include <unordered_set>
+
+static bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static bool isRegularFile(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+// Files the loader writes next to a CSV, which a glob like "dir/*" also matches
+static bool isSidecar(const std::string& path) {
+    return endsWith(path, ".colcache") || endsWith(path, ".rowidx") || endsWith(path, ".stats") ||
+           endsWith(path, ".tmp");
+}
+
+bool isMultiFileTable(const std::string& table) {
+    struct stat st;
+    if (stat(table.c_str(), &st) == 0) {
+        return S_ISDIR(st.st_mode);
+    }
+    return table.find_first_of("*?[") != std::string::npos;
+}
+
+static bool isTableFile(const std::string& path) {
+    return endsWith(path, ".csv") || endsWith(path, ".csv.gz") || endsWith(path, ".csv.zst");
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Split a key=value path segment; false if it is not one
+static bool parsePartition(const std::string& segment, PartitionValue& partition) {
+    size_t eq = segment.find('=');
+    if (eq == 0 || eq == std::string::npos) {
+        return false;
+    }
+    partition.key = segment.substr(0, eq);
+    partition.value.clear();
+    partition.missing = (segment.compare(eq + 1, std::string::npos, "__HIVE_DEFAULT_PARTITION__") == 0);
+    if (partition.missing) {
+        return true;
+    }
+    // Writers escape characters such as '/', '=' and ':' as %XX
+    for (size_t i = eq + 1; i < segment.size(); ++i) {
+        if (segment[i] == '%' && i + 2 < segment.size() && hexDigit(segment[i + 1]) >= 0 &&
+            hexDigit(segment[i + 2]) >= 0) {
+            partition.value.push_back(static_cast<char>(hexDigit(segment[i + 1]) * 16 + hexDigit(segment[i + 2])));
+            i += 2;
+        }
+        else {
+            partition.value.push_back(segment[i]);
+        }
+    }
+    return true;
+}
+
+static void addKey(std::vector<std::string>& keys, const std::string& key) {
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+        keys.push_back(key);
+    }
+}
+
+// Every file and partition directory below dir; each partition directory is
+// given with the partition directories above it, outermost first
+static void listDirectory(const std::string& dir, std::vector<PartitionValue>& partitions,
+                          std::vector<std::vector<PartitionValue>>& partition_dirs, TableListing& listing) {
+    DIR* handle = opendir(dir.c_str());
+    if (handle == nullptr) {
+        return;
+    }
+    std::string prefix = endsWith(dir, "/") ? dir : dir + "/";
+    std::vector<std::string> subdirs;
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        std::string path = prefix + name;
+        struct stat st;
+        if (name == "." || name == ".." || stat(path.c_str(), &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            // Hidden and staging directories (e.g. _temporary) hold no table rows
+            if (name[0] != '.' && name[0] != '_') {
+                subdirs.push_back(name);
+            }
+        }
+        else if (S_ISREG(st.st_mode) && isTableFile(path)) {
+            listing.files.push_back({ path, partitions });
+        }
+    }
+    closedir(handle);
+
+    // Sorted, so that keys are numbered the same on every listing
+    std::sort(subdirs.begin(), subdirs.end());
+    for (const auto& name : subdirs) {
+        PartitionValue partition;
+        bool is_partition = parsePartition(name, partition);
+        if (is_partition) {
+            addKey(listing.partition_keys, partition.key);
+            partition.directory = prefix + name;
+            partitions.push_back(partition);
+            partition_dirs.push_back(partitions);
+        }
+        listDirectory(prefix + name, partitions, partition_dirs, listing);
+        if (is_partition) {
+            partitions.pop_back();
+        }
+    }
+}
+
+// Type each partition key from its distinct values, as a column of them would be
+static void typePartitions(const std::vector<std::vector<PartitionValue>>& partition_sets, bool infer_schema,
+                           TableListing& listing) {
+    std::unordered_map<std::string, std::unordered_set<std::string>> values;
+    for (const auto& partitions : partition_sets) {
+        for (const auto& partition : partitions) {
+            if (!partition.missing) {
+                values[partition.key].insert(partition.value);
+            }
+        }
+    }
+    for (const auto& key : listing.partition_keys) {
+        if (!infer_schema) {
+            listing.partition_types[key] = ColumnType::STRING;
+            continue;
+        }
+        CellCounts counts;
+        for (const auto& value : values[key]) {
+            counts.add(value);
+        }
+        listing.partition_types[key] = counts.type();
+    }
+}
+
+TableListing listTableFiles(const std::string& table, bool infer_schema) {
+    TableListing listing;
+    struct stat st;
+    if (stat(table.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        std::vector<PartitionValue> partitions;
+        std::vector<std::vector<PartitionValue>> partition_dirs;
+        listDirectory(table, partitions, partition_dirs, listing);
+        typePartitions(partition_dirs, infer_schema, listing);
+    }
+    else if (isMultiFileTable(table)) {
+        glob_t matches;
+        if (glob(table.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                TableFile file;
+                file.path = matches.gl_pathv[i];
+                if (isSidecar(file.path) || !isRegularFile(file.path)) {
+                    continue;
+                }
+                // Every key=value directory of the match is a partition
+                size_t begin = 0;
+                for (size_t slash = file.path.find('/'); slash != std::string::npos;
+                     begin = slash + 1, slash = file.path.find('/', begin)) {
+                    PartitionValue partition;
+                    if (parsePartition(file.path.substr(begin, slash - begin), partition)) {
+                        addKey(listing.partition_keys, partition.key);
+                        partition.directory = file.path.substr(0, slash);
+                        file.partitions.push_back(partition);
+                    }
+                }
+                listing.files.push_back(std::move(file));
+            }
+        }
+        globfree(&matches);
+        std::vector<std::vector<PartitionValue>> partition_sets;
+        for (const auto& file : listing.files) {
+            partition_sets.push_back(file.partitions);
+        }
+        typePartitions(partition_sets, infer_schema, listing);
+    }
+    else {
+        listing.files.push_back({ table, {} });
+    }
+    std::sort(listing.files.begin(), listing.files.end(),
+              [](const TableFile& a, const TableFile& b) { return a.path < b.path; });
+    return listing;
+}
+
+// The partition directory of a file whose value fails the predicates, or null
+static const PartitionValue* prunedBy(const TableFile& file, const std::vector<ScanPredicate>& predicates,
+                                      const TableSchema& schema) {
+    for (const auto& predicate : predicates) {
+        auto type = schema.find(predicate.column);
+        const ColumnType* column_type = type != schema.end() ? &type->second : nullptr;
+        auto partition = std::find_if(file.partitions.begin(), file.partitions.end(),
+                                      [&](const PartitionValue& value) { return value.key == predicate.column; });
+        if (partition == file.partitions.end()) {
+            if (!predicate.errorFree(column_type)) {
+                return nullptr;
+            }
+            continue;
+        }
+        // A NULL partition value fails every comparison
+        ScanMatch outcome = partition->missing ? ScanMatch::FAIL : predicate.match(partition->value, column_type);
+        if (outcome == ScanMatch::FAIL) {
+            return &*partition;
+        }
+        if (outcome == ScanMatch::UNKNOWN) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void prunePartitions(TableListing& listing, const std::vector<ScanPredicate>& predicates, const TableSchema& schema) {
+    std::vector<TableFile> kept;
+    std::unordered_set<std::string> pruned_dirs;
+    for (auto& file : listing.files) {
+        if (const PartitionValue* partition = prunedBy(file, predicates, schema)) {
+            pruned_dirs.insert(partition->directory);
+            continue;
+        }
+        kept.push_back(std::move(file));
+    }
+    listing.files = std::move(kept);
+    listing.pruned = pruned_dirs.size();
+}
+
+// File layout (native endianness):
+//   StatsHeader
+//   per header:                uint32 length, char name[length]
+//   per column:                uint32 name length, uint32 type, char name[name length],
+//                              ColumnStatistics
+static const char STATS_MAGIC[8] = { 'C', 'S', 'V', 'S', 'T', 'A', 'T', 'S' };
+static const uint32_t STATS_VERSION = 3;
+
+struct StatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t num_records;
+    uint64_t num_headers;
+    uint64_t num_columns;
+};
+
+FileStatistics::FileStatistics(const std::string& csv_filename)
+    : csv_filename_(csv_filename), stats_path_(csv_filename + ".stats") {}
+
+bool FileStatistics::statSource(uint64_t& size, int64_t& mtime_sec, int64_t& mtime_nsec) const {
+    struct stat st;
+    if (stat(csv_filename_.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_sec = static_cast<int64_t>(st.st_mtim.tv_sec);
+    mtime_nsec = static_cast<int64_t>(st.st_mtim.tv_nsec);
+    return true;
+}
+
+static bool readName(std::ifstream& in, std::string& name) {
+    uint32_t length;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > (1u << 20)) {
+        return false;
+    }
+    name.resize(length);
+    return static_cast<bool>(in.read(&name[0], length));
+}
+
+bool FileStatistics::open() {
+    headers_.clear();
+    columns_.clear();
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    std::ifstream in(stats_path_, std::ios::binary);
+    if (!in.is_open() || !statSource(size, mtime_sec, mtime_nsec)) {
+        return false;
+    }
+    StatsHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, STATS_MAGIC, sizeof(STATS_MAGIC)) != 0 || header.version != STATS_VERSION ||
+        header.source_size != size || header.source_mtime_sec != mtime_sec ||
+        header.source_mtime_nsec != mtime_nsec) {
+        return false;
+    }
+
+    std::vector<std::string> headers(header.num_headers < (1u << 20) ? header.num_headers : 0);
+    if (headers.size() != header.num_headers) {
+        return false;
+    }
+    for (auto& name : headers) {
+        if (!readName(in, name)) {
+            return false;
+        }
+    }
+    std::unordered_map<std::string, ColumnStatistics> columns;
+    for (uint64_t c = 0; c < header.num_columns; ++c) {
+        std::string name;
+        uint32_t type;
+        ColumnStatistics stats;
+        if (!readName(in, name) || !in.read(reinterpret_cast<char*>(&type), sizeof(type)) ||
+            type > static_cast<uint32_t>(ColumnType::STRING) ||
+            !in.read(reinterpret_cast<char*>(&stats), sizeof(stats))) {
+            return false;
+        }
+        stats.type = static_cast<ColumnType>(type);
+        columns[name] = stats;
+    }
+
+    source_size_ = size;
+    source_mtime_sec_ = mtime_sec;
+    source_mtime_nsec_ = mtime_nsec;
+    num_records_ = header.num_records;
+    headers_ = std::move(headers);
+    columns_ = std::move(columns);
+    return true;
+}
+
+// Missing-cell count and range of rows [first_row, end_row) of a column
+static ColumnStatistics columnStatistics(const Column& column, size_t first_row, size_t end_row) {
+    ColumnStatistics stats;
+    stats.type = column.getType();
+    std::string_view text;
+    for (size_t row = first_row; row < end_row; ++row) {
+        if (column.isMissing(row)) {
+            column.strayText(row, text) ? stats.strays++ : stats.missing++;
+            continue;
+        }
+        if (stats.type == ColumnType::INT64) {
+            int64_t value = column.getInt(row);
+            stats.int_min = stats.has_range ? std::min(stats.int_min, value) : value;
+            stats.int_max = stats.has_range ? std::max(stats.int_max, value) : value;
+            stats.has_range = true;
+        }
+        else if (stats.type == ColumnType::DOUBLE && !std::isnan(column.getDouble(row))) {
+            double value = column.getDouble(row);
+            stats.double_min = stats.has_range ? std::min(stats.double_min, value) : value;
+            stats.double_max = stats.has_range ? std::max(stats.double_max, value) : value;
+            stats.has_range = true;
+        }
+    }
+    return stats;
+}
+
+bool FileStatistics::update(const ColumnTable& table, size_t first_row, size_t num_rows,
+                            const std::vector<std::string>& headers, uint64_t num_records) {
+    uint64_t size;
+    int64_t mtime_sec, mtime_nsec;
+    if (!statSource(size, mtime_sec, mtime_nsec)) {
+        return false;
+    }
+    // Columns of an older version of the file no longer apply
+    if (size != source_size_ || mtime_sec != source_mtime_sec_ || mtime_nsec != source_mtime_nsec_) {
+        columns_.clear();
+    }
+    source_size_ = size;
+    source_mtime_sec_ = mtime_sec;
+    source_mtime_nsec_ = mtime_nsec;
+    num_records_ = num_records;
+    headers_ = headers;
+    for (size_t idx = 0; idx < table.numColumns(); ++idx) {
+        const Column& column = table.getColumn(idx);
+        // Partition columns are not part of the file
+        if (std::find(headers.begin(), headers.end(), column.getName()) != headers.end()) {
+            columns_[column.getName()] = columnStatistics(column, first_row, first_row + num_rows);
+        }
+    }
+    return write();
+}
+
+static void writeName(std::ofstream& out, const std::string& name) {
+    uint32_t length = static_cast<uint32_t>(name.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(name.data(), name.size());
+}
+
+bool FileStatistics::write() const {
+    std::string tmp_path = stats_path_ + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file for writing: " << tmp_path << std::endl;
+        return false;
+    }
+    StatsHeader header = StatsHeader();
+    memcpy(header.magic, STATS_MAGIC, sizeof(STATS_MAGIC));
+    header.version = STATS_VERSION;
+    header.source_size = source_size_;
+    header.source_mtime_sec = source_mtime_sec_;
+    header.source_mtime_nsec = source_mtime_nsec_;
+    header.num_records = num_records_;
+    header.num_headers = headers_.size();
+    header.num_columns = columns_.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& name : headers_) {
+        writeName(out, name);
+    }
+    for (const auto& entry : columns_) {
+        uint32_t type = static_cast<uint32_t>(entry.second.type);
+        writeName(out, entry.first);
+        out.write(reinterpret_cast<const char*>(&type), sizeof(type));
+        out.write(reinterpret_cast<const char*>(&entry.second), sizeof(entry.second));
+    }
+    out.close();
+    if (!out) {
+        std::cerr << "Failed to write statistics file: " << tmp_path << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), stats_path_.c_str()) != 0) {
+        std::cerr << "Failed to replace statistics file: " << stats_path_ << std::endl;
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool FileStatistics::covers(const std::vector<ScanPredicate>& predicates) const {
+    for (const auto& predicate : predicates) {
+        // Predicates on unknown columns are left to the executor to report
+        if (columns_.count(predicate.column) == 0 &&
+            std::find(headers_.begin(), headers_.end(), predicate.column) != headers_.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether some value in [lo, hi] can satisfy "value <comparator> constant"
+template <typename T>
+static bool rangeMayMatch(T lo, T hi, Comparator comparator, T constant) {
+    switch (comparator) {
+        case Comparator::EQUAL:
+            return constant >= lo && constant <= hi;
+        case Comparator::LESS:
+            return lo < constant;
+        case Comparator::LESS_EQUAL:
+            return lo <= constant;
+        case Comparator::GREATER:
+            return hi > constant;
+        case Comparator::GREATER_EQUAL:
+            return hi >= constant;
+        default:
+            return true;
+    }
+}
+
+// Whether cells read as one type are NULL and compare as they would read as
+// the other: INT64 and DOUBLE hold the same numbers
+static bool sameKind(ColumnType a, ColumnType b) {
+    bool a_numeric = a == ColumnType::INT64 || a == ColumnType::DOUBLE;
+    bool b_numeric = b == ColumnType::INT64 || b == ColumnType::DOUBLE;
+    return a == b || (a_numeric && b_numeric);
+}
+
+// Whether no cell of a column with these statistics satisfies the predicate
+static bool ruledOut(const ColumnStatistics& stats, uint64_t num_records, const ScanPredicate& predicate) {
+    // Missing cells are NULL and fail every comparison
+    if (stats.missing == num_records) {
+        return true;
+    }
+    // Stray cells compare as their text, whatever the range
+    if (!stats.has_range || stats.strays > 0) {
+        return false;
+    }
+    if (std::holds_alternative<int>(predicate.value) && stats.type == ColumnType::INT64 &&
+        stats.int_min >= std::numeric_limits<int>::min() && stats.int_max <= std::numeric_limits<int>::max()) {
+        // Every cell evaluates as int, like the constant
+        int64_t constant = std::get<int>(predicate.value);
+        if (predicate.comparator == Comparator::NOT_EQUAL) {
+            return stats.int_min == constant && stats.int_max == constant;
+        }
+        return !rangeMayMatch(stats.int_min, stats.int_max, predicate.comparator, constant);
+    }
+    if (std::holds_alternative<double>(predicate.value) && stats.type == ColumnType::DOUBLE) {
+        // NaN cells fail every ordered comparison, so the range leaves them out
+        return !rangeMayMatch(stats.double_min, stats.double_max, predicate.comparator,
+                              std::get<double>(predicate.value));
+    }
+    return false;
+}
+
+bool FileStatistics::mayMatch(const std::vector<ScanPredicate>& predicates, const TableSchema& schema) const {
+    for (const auto& predicate : predicates) {
+        auto type = schema.find(predicate.column);
+        const ColumnType* column_type = type != schema.end() ? &type->second : nullptr;
+        auto it = columns_.find(predicate.column);
+        if (it != columns_.end() && column_type != nullptr && sameKind(it->second.type, *column_type) &&
+            ruledOut(it->second, num_records_, predicate)) {
+            return false;
+        }
+        // A row this predicate reports an error for must be loaded, whatever the later ones say
+        if (!predicate.errorFree(column_type, it == columns_.end() || it->second.strays > 0)) {
+            return true;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,113 @@
+// TableFiles.h
+#ifndef TABLEFILES_H
+#define TABLEFILES_H
+
+#include "ColumnTable.h"
+#include "SchemaInference.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ScanPredicate;
+
+// A table given as a directory or a glob pattern (e.g. "logs/2024-*.csv")
+// rather than a single CSV file
+bool isMultiFileTable(const std::string& table);
+
+// One key=value directory above a file of a partitioned table, as in
+// table/date=2026-10-01/region=eu/part.csv. The key is a virtual column
+// whose value is the same for every row of the files below.
+struct PartitionValue {
+    std::string key;
+    std::string value;          // %XX escapes decoded
+    bool missing = false;       // __HIVE_DEFAULT_PARTITION__, a NULL partition
+    std::string directory;      // Path of the key=value directory
+};
+
+// A CSV file of a table and the partition directories it sits in
+struct TableFile {
+    std::string path;
+    std::vector<PartitionValue> partitions;     // Outermost directory first
+};
+
+// Files of a table
+struct TableListing {
+    std::vector<TableFile> files;               // Sorted by path
+    std::vector<std::string> partition_keys;    // Keys of every partition directory, pruned or not
+    TableSchema partition_types;                // Type of each key, from its directories pruned or not
+    size_t pruned = 0;                          // Partition directories pruned
+};
+
+// CSV files of a table: the .csv files of a directory and its subdirectories
+// (also .csv.gz and .csv.zst; directories starting with '.' or '_' are
+// ignored), the matches of a glob pattern, or the file itself. Row ids count
+// on from one file to the next in path order. Each partition key is typed by
+// CellCounts over its distinct directory values (STRING without
+// infer_schema), whatever a query later prunes.
+TableListing listTableFiles(const std::string& table, bool infer_schema);
+
+// Drop the files below a partition directory whose value fails a predicate
+// on its key, so none of them is opened, and count those directories. Predicates are taken in order, as
+// the WHERE clause evaluates its conjuncts: one on another column stops
+// pruning unless it cannot fail with an error under its type in the schema,
+// since the rows dropped might have reported that error.
+void prunePartitions(TableListing& listing, const std::vector<ScanPredicate>& predicates,
+                     const TableSchema& schema);
+
+// Range of one column of a CSV file, for skipping files a WHERE clause rules out
+struct ColumnStatistics {
+    ColumnType type = ColumnType::STRING;
+    uint64_t missing = 0;           // Empty (typed) or absent cells
+    uint64_t strays = 0;            // Cells of a typed column kept as text (see Column::keepText)
+    bool has_range = false;         // min/max hold at least one value
+    int64_t int_min = 0;            // INT64 columns
+    int64_t int_max = 0;
+    double double_min = 0.0;        // DOUBLE columns, NaN excluded
+    double double_max = 0.0;
+};
+
+// Per-file statistics, stored next to the file as <csv>.stats: the record
+// count, the headers, and the type and min/max of every column read by a
+// query so far. Stale once the file's size or mtime changes.
+class FileStatistics {
+public:
+    explicit FileStatistics(const std::string& csv_filename);
+
+    const std::string& getPath() const { return stats_path_; }
+
+    // Read the persisted statistics; false if they are missing, stale or corrupt
+    bool open();
+    // Add the columns of the file's headers to the statistics and persist
+    // them, from num_rows rows of table starting at first_row that hold every
+    // record of the file (no predicates applied)
+    bool update(const ColumnTable& table, size_t first_row, size_t num_rows, const std::vector<std::string>& headers,
+                uint64_t num_records);
+
+    uint64_t numRecords() const { return num_records_; }
+    const std::vector<std::string>& getHeaders() const { return headers_; }
+    // Whether every predicate column has statistics
+    bool covers(const std::vector<ScanPredicate>& predicates) const;
+    // False only if no row of the file can satisfy every predicate without
+    // error: a numeric constant outside the range of the column's values
+    // (which evaluate to the constant's type), or a column of NULLs only.
+    // A column's statistics are only used while the schema still gives it a
+    // type of the same kind (numeric, bool or string) as when they were
+    // taken. Predicates are taken in order, as in prunePartitions.
+    bool mayMatch(const std::vector<ScanPredicate>& predicates, const TableSchema& schema) const;
+
+private:
+    bool statSource(uint64_t& size, int64_t& mtime_sec, int64_t& mtime_nsec) const;
+    bool write() const;
+
+    std::string csv_filename_;
+    std::string stats_path_;
+    uint64_t source_size_ = 0;
+    int64_t source_mtime_sec_ = 0;
+    int64_t source_mtime_nsec_ = 0;
+    uint64_t num_records_ = 0;
+    std::vector<std::string> headers_;
+    std::unordered_map<std::string, ColumnStatistics> columns_;
+};
+
+#endif // TABLEFILES_H
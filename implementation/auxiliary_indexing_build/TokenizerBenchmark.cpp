@@ -0,0 +1,71 @@
+// TokenizerBenchmark.cpp
+#include "CSVScanner.h"
+#include "MappedFile.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Time a tokenizer callable and report its throughput
+template <typename Fn>
+static void runTokenizer(const std::string& label, const MappedFile& file, int repetitions, Fn&& tokenize) {
+    double best_ms = 0.0;
+    size_t cells = 0;
+    for (int rep = 0; rep < repetitions; ++rep) {
+        auto start = std::chrono::steady_clock::now();
+        cells = tokenize();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (rep == 0 || ms < best_ms) {
+            best_ms = ms;
+        }
+    }
+    double mb = file.size() / (1024.0 * 1024.0);
+    std::cout << label << "\t" << cells << " cells\t" << best_ms << " ms\t"
+              << (best_ms > 0 ? mb / (best_ms / 1000.0) : 0.0) << " MB/s" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: TokenizerBenchmark <csv_file> [repetitions]" << std::endl;
+        return 1;
+    }
+    int repetitions = argc >= 3 ? std::stoi(argv[2]) : 3;
+
+    MappedFile file;
+    if (!file.open(argv[1])) {
+        return 1;
+    }
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    // Baseline: the std::getline path CSVLoader used for every line and cell
+    runTokenizer("getline", file, repetitions, [&] {
+        std::istringstream in(std::string(begin, end));
+        std::string line;
+        size_t cells = 0;
+        while (std::getline(in, line)) {
+            std::stringstream ss(line);
+            std::string cell;
+            while (std::getline(ss, cell, ',')) {
+                cells++;
+            }
+        }
+        return cells;
+    });
+
+    for (ScannerKernel kernel : { ScannerKernel::SCALAR, ScannerKernel::SSE42, ScannerKernel::AVX2 }) {
+        if (!CSVScanner::isSupported(kernel)) {
+            std::cout << CSVScanner::kernelName(kernel) << "\tnot supported on this CPU" << std::endl;
+            continue;
+        }
+        CSVScanner scanner(kernel);
+        runTokenizer(CSVScanner::kernelName(kernel), file, repetitions, [&] {
+            size_t cells = 0;
+            scanner.tokenize(begin, end,
+                [&](const char*, const char*) { cells++; },
+                [&](const char* cell_begin, const char* cell_end) { cells += (cell_end > cell_begin); });
+            return cells;
+        });
+    }
+    return 0;
+}
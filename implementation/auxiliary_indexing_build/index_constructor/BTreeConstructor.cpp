@@ -2,8 +2,9 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <sstream>
 #include <memory>
+#include "../CSVScanner.h"
+#include "../NumericParse.h"
 
 // B-tree order
 const int ORDER = 3;
@@ -148,13 +149,6 @@ public:
     }
 };
 
-// Function to trim whitespace from both ends of a string
-std::string trim(const std::string &s) {
-    size_t start = s.find_first_not_of(" \t\r\n");
-    size_t end = s.find_last_not_of(" \t\r\n");
-    return (start == std::string::npos) ? "" : s.substr(start, end - start + 1);
-}
-
 int main() {
     std::string csvFile = "data.csv";
     std::ifstream file(csvFile);
@@ -167,18 +161,22 @@ int main() {
     std::string line;
     bool isHeader = true;
 
-    while (std::getline(file, line)) {
+    // Records may span lines when a quoted field contains a line break
+    while (readCSVRecord(file, line)) {
         if (isHeader) {
             // Skip the header line
             isHeader = false;
             continue;
         }
 
-        std::stringstream ss(line);
-        std::string item;
         // Extract the first column (id)
-        if (std::getline(ss, item, ',')) {
-            int id = std::stoi(trim(item));
+        std::vector<std::string> cells = splitCSVRecord(line);
+        if (!cells.empty()) {
+            int32_t id;
+            if (parseInt32(trimSpace(cells[0]), id) != ParseStatus::OK) {
+                std::cerr << "Skipping row with a non-integer id: " << cells[0] << "\n";
+                continue;
+            }
             btree.insert(id);
         }
     }
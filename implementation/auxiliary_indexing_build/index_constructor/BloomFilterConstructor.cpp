@@ -3,9 +3,9 @@
 #include <fstream>
 #include <vector>
 #include <string>
-#include <sstream>
 #include <cstdint>
 #include <cstring>
+#include "../CSVScanner.h"
 #include "CityHash.h"  // Include the CityHash header
 
 // MurmurHash3 Implementation
@@ -173,18 +173,18 @@ int main() {
     std::string line;
     bool isHeader = true;
 
-    while (std::getline(file, line)) {
+    // Records may span lines when a quoted field contains a line break
+    while (readCSVRecord(file, line)) {
         if (isHeader) {
             // Skip the header line
             isHeader = false;
             continue;
         }
 
-        std::stringstream ss(line);
-        std::string item;
         // Extract the first column (id)
-        if (std::getline(ss, item, ',')) {
-            std::string id = trim(item);
+        std::vector<std::string> cells = splitCSVRecord(line);
+        if (!cells.empty()) {
+            std::string id = trim(cells[0]);
             bloomFilter.add(id);
         }
     }
@@ -0,0 +1,238 @@
+// CSVScanner.cpp
+#include "CSVScanner.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CSVSCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+// Portable byte-at-a-time kernel
+static StructuralMasks scanScalar(const char* block) {
+    StructuralMasks masks = { 0, 0, 0 };
+    for (size_t i = 0; i < CSVScanner::BLOCK_SIZE; ++i) {
+        masks.field |= uint64_t(block[i] == ',') << i;
+        masks.record |= uint64_t(block[i] == '\n') << i;
+        masks.quote |= uint64_t(block[i] == '"') << i;
+    }
+    return masks;
+}
+
+#ifdef CSVSCANNER_X86
+// Four 16-byte compares per character class
+__attribute__((target("sse4.2")))
+static StructuralMasks scanSSE42(const char* block) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i quote = _mm_set1_epi8('"');
+    StructuralMasks masks = { 0, 0, 0 };
+    for (int i = 0; i < 4; ++i) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        uint64_t field = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, comma)));
+        uint64_t record = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        uint64_t quotes = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+        masks.field |= field << (16 * i);
+        masks.record |= record << (16 * i);
+        masks.quote |= quotes << (16 * i);
+    }
+    return masks;
+}
+
+// Two 32-byte compares per character class
+__attribute__((target("avx2")))
+static StructuralMasks scanAVX2(const char* block) {
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i quote = _mm256_set1_epi8('"');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    uint64_t field_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, comma)));
+    uint64_t field_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, comma)));
+    uint64_t record_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, newline)));
+    uint64_t record_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, newline)));
+    uint64_t quote_lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote)));
+    uint64_t quote_hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)));
+    StructuralMasks masks;
+    masks.field = field_lo | (field_hi << 32);
+    masks.record = record_lo | (record_hi << 32);
+    masks.quote = quote_lo | (quote_hi << 32);
+    return masks;
+}
+#endif
+
+CSVScanner::CSVScanner() : CSVScanner(detectKernel()) {}
+
+CSVScanner::CSVScanner(ScannerKernel kernel) : kernel_(kernel), scan_(scanScalar) {
+    if (!isSupported(kernel)) {
+        kernel_ = ScannerKernel::SCALAR;
+    }
+#ifdef CSVSCANNER_X86
+    if (kernel_ == ScannerKernel::AVX2) {
+        scan_ = scanAVX2;
+    }
+    else if (kernel_ == ScannerKernel::SSE42) {
+        scan_ = scanSSE42;
+    }
+#endif
+}
+
+ScannerKernel CSVScanner::detectKernel() {
+    if (isSupported(ScannerKernel::AVX2)) {
+        return ScannerKernel::AVX2;
+    }
+    if (isSupported(ScannerKernel::SSE42)) {
+        return ScannerKernel::SSE42;
+    }
+    return ScannerKernel::SCALAR;
+}
+
+bool CSVScanner::isSupported(ScannerKernel kernel) {
+    switch (kernel) {
+        case ScannerKernel::SCALAR:
+            return true;
+#ifdef CSVSCANNER_X86
+        case ScannerKernel::SSE42:
+            return __builtin_cpu_supports("sse4.2");
+        case ScannerKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* CSVScanner::kernelName(ScannerKernel kernel) {
+    switch (kernel) {
+        case ScannerKernel::SCALAR:
+            return "scalar";
+        case ScannerKernel::SSE42:
+            return "sse4.2";
+        case ScannerKernel::AVX2:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
+
+size_t CSVScanner::countQuotes(const char* begin, const char* end) const {
+    size_t count = 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        size_t length = end - block;
+        if (length >= BLOCK_SIZE) {
+            count += __builtin_popcountll(scan_(block).quote);
+        }
+        else {
+            count += std::count(block, end, '"');
+        }
+    }
+    return count;
+}
+
+const char* CSVScanner::findRecordStart(const char* begin, const char* end, bool in_quotes) const {
+    uint64_t state = in_quotes ? ~uint64_t(0) : 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        StructuralMasks masks = scanQuoted(block, end - block, state);
+        if (masks.record != 0) {
+            return block + __builtin_ctzll(masks.record) + 1;
+        }
+    }
+    return end;
+}
+
+const char* CSVScanner::findLastRecordEnd(const char* begin, const char* end) const {
+    const char* last = begin;
+    uint64_t state = 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        size_t length = end - block;
+        StructuralMasks masks = scanQuoted(block, length, state);
+        if (length < BLOCK_SIZE) {
+            masks.record &= (uint64_t(1) << length) - 1;
+        }
+        if (masks.record != 0) {
+            last = block + (63 - __builtin_clzll(masks.record)) + 1;
+        }
+    }
+    return last;
+}
+
+const char* CSVScanner::findRecordEnd(const char* begin, const char* end, size_t& count) const {
+    if (count == 0) {
+        return begin;
+    }
+    size_t remaining = count;
+    uint64_t state = 0;
+    for (const char* block = begin; block < end; block += BLOCK_SIZE) {
+        size_t length = end - block;
+        StructuralMasks masks = scanQuoted(block, length, state);
+        if (length < BLOCK_SIZE) {
+            masks.record &= (uint64_t(1) << length) - 1;
+        }
+        size_t found = __builtin_popcountll(masks.record);
+        if (found < remaining) {
+            remaining -= found;
+            continue;
+        }
+        // Drop the delimiters before the one we are looking for
+        for (size_t i = 1; i < remaining; ++i) {
+            masks.record &= masks.record - 1;
+        }
+        return block + __builtin_ctzll(masks.record) + 1;
+    }
+    count -= remaining;
+    return end;
+}
+
+std::string_view CSVScanner::decodeCell(const char* cell_begin, const char* cell_end, std::string& scratch) {
+    size_t length = cell_end - cell_begin;
+    if (length < 2 || cell_begin[0] != '"' || cell_end[-1] != '"') {
+        return std::string_view(cell_begin, length);
+    }
+    const char* inner = cell_begin + 1;
+    const char* inner_end = cell_end - 1;
+    if (memchr(inner, '"', inner_end - inner) == nullptr) {
+        return std::string_view(inner, inner_end - inner);
+    }
+    // Collapse each escaped "" into a single quote
+    scratch.clear();
+    for (const char* p = inner; p < inner_end; ++p) {
+        scratch.push_back(*p);
+        if (*p == '"' && p + 1 < inner_end && p[1] == '"') {
+            ++p;
+        }
+    }
+    return scratch;
+}
+
+bool readCSVRecord(std::istream& in, std::string& record) {
+    if (!std::getline(in, record)) {
+        return false;
+    }
+    // An odd number of quotes means a quoted field continues on the next line
+    size_t quotes = std::count(record.begin(), record.end(), '"');
+    std::string line;
+    while (quotes % 2 == 1 && std::getline(in, line)) {
+        record += '\n';
+        record += line;
+        quotes += std::count(line.begin(), line.end(), '"');
+    }
+    if (!record.empty() && record.back() == '\r') {
+        record.pop_back();
+    }
+    return true;
+}
+
+std::vector<std::string> splitCSVRecord(std::string_view record) {
+    static const CSVScanner scanner;
+    std::vector<std::string> cells;
+    std::string scratch;
+    auto addCell = [&](const char* cell_begin, const char* cell_end) {
+        cells.emplace_back(CSVScanner::decodeCell(cell_begin, cell_end, scratch));
+    };
+    scanner.tokenize(record.data(), record.data() + record.size(), addCell,
+        [&](const char* cell_begin, const char* cell_end) {
+            if (cell_end > cell_begin) {
+                addCell(cell_begin, cell_end);
+            }
+        });
+    return cells;
+}
@@ -0,0 +1,350 @@
+// ColumnTable.cpp
+#include "ColumnTable.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <new>
+#include <stdexcept>
+
+uint32_t StringDictionary::intern(std::string_view value) {
+    auto it = codes_.find(value);
+    if (it != codes_.end()) {
+        return it->second;
+    }
+    uint32_t code = static_cast<uint32_t>(values_.size());
+    values_.emplace_back(value);
+    // Key by a view of the stored copy; deque elements never move
+    codes_.emplace(values_.back(), code);
+    return code;
+}
+
+int64_t StringDictionary::find(std::string_view value) const {
+    auto it = codes_.find(value);
+    return it != codes_.end() ? static_cast<int64_t>(it->second) : -1;
+}
+
+// Constructor
+Column::Column(const std::string& name, ColumnType type, std::pmr::memory_resource* resource)
+    : name_(name), type_(type), size_(0), ints_(resource), doubles_(resource), bools_(resource),
+      string_data_(resource), string_offsets_(resource), string_lengths_(resource), external_data_(nullptr),
+      validity_(resource), codes_(resource), text_rows_(resource), text_ends_(resource), text_data_(resource) {}
+
+void Column::appendInt(int64_t value) {
+    ints_.push_back(value);
+    size_++;
+}
+
+void Column::appendDouble(double value) {
+    doubles_.push_back(value);
+    size_++;
+}
+
+void Column::appendBool(bool value) {
+    bools_.push_back(value ? 1 : 0);
+    size_++;
+}
+
+void Column::appendString(std::string_view value) {
+    if (dictionary_) {
+        appendCode(dictionary_->intern(value));
+        return;
+    }
+    // Mapped columns still own cells that had to be rewritten (unescaped quotes)
+    string_offsets_.push_back(string_data_.size() | (external_data_ ? OWNED_BIT : 0));
+    string_lengths_.push_back(static_cast<uint32_t>(value.size()));
+    string_data_.append(value.data(), value.size());
+    size_++;
+}
+
+void Column::setExternalStrings(std::shared_ptr<const MappedFile> mapping) {
+    if (!string_data_.empty()) {
+        throw std::runtime_error("Column '" + name_ + "' already owns string data.");
+    }
+    external_ = mapping;
+    external_data_ = mapping ? mapping->data() : nullptr;
+}
+
+void Column::appendStringRef(uint64_t offset, uint32_t length) {
+    string_offsets_.push_back(offset);
+    string_lengths_.push_back(length);
+    size_++;
+}
+
+void Column::setDictionary(std::shared_ptr<StringDictionary> dictionary) {
+    if (size_ != 0 || type_ != ColumnType::STRING) {
+        throw std::runtime_error("Column '" + name_ + "' cannot be dictionary-encoded once filled.");
+    }
+    dictionary_ = dictionary;
+}
+
+void Column::appendCode(uint32_t code) {
+    codes_.push_back(code);
+    size_++;
+}
+
+void Column::setNull(size_t row) {
+    // Words are only kept up to the last NULL; the rows after it are present
+    if ((row >> 6) >= validity_.size()) {
+        validity_.resize((row >> 6) + 1, ~uint64_t(0));
+    }
+    validity_[row >> 6] &= ~(uint64_t(1) << (row & 63));
+    null_count_++;
+}
+
+void Column::appendMissing() {
+    setNull(size_);
+    switch (type_) {
+        case ColumnType::INT64:
+            appendInt(0);
+            break;
+        case ColumnType::DOUBLE:
+            appendDouble(0.0);
+            break;
+        case ColumnType::BOOL:
+            appendBool(false);
+            break;
+        case ColumnType::STRING:
+            appendString(std::string_view());
+            break;
+    }
+}
+
+void Column::appendColumn(const Column& other) {
+    if (other.type_ != type_ || other.external_data_ != external_data_ || other.dictionary_ != dictionary_) {
+        throw std::runtime_error("Cannot append column '" + other.name_ + "' with different storage.");
+    }
+    // Carry over the NULL bits of the other column, a word at a time
+    for (size_t word = 0; word < other.validity_.size(); ++word) {
+        uint64_t nulls = ~other.validity_[word];
+        while (nulls != 0) {
+            size_t row = word * 64 + __builtin_ctzll(nulls);
+            if (row >= other.size_) {
+                break;
+            }
+            setNull(size_ + row);
+            nulls &= nulls - 1;
+        }
+    }
+    switch (type_) {
+        case ColumnType::INT64:
+            ints_.insert(ints_.end(), other.ints_.begin(), other.ints_.end());
+            break;
+        case ColumnType::DOUBLE:
+            doubles_.insert(doubles_.end(), other.doubles_.begin(), other.doubles_.end());
+            break;
+        case ColumnType::BOOL:
+            bools_.insert(bools_.end(), other.bools_.begin(), other.bools_.end());
+            break;
+        case ColumnType::STRING: {
+            if (dictionary_) {
+                // Same dictionary, so the codes carry over unchanged
+                codes_.insert(codes_.end(), other.codes_.begin(), other.codes_.end());
+                break;
+            }
+            // Owned offsets are relative to the other column's buffer; external ones are absolute
+            uint64_t shift = string_data_.size();
+            string_offsets_.reserve(string_offsets_.size() + other.string_offsets_.size());
+            for (uint64_t offset : other.string_offsets_) {
+                bool owned = external_data_ == nullptr || (offset & OWNED_BIT);
+                string_offsets_.push_back(owned ? offset + shift : offset);
+            }
+            string_lengths_.insert(string_lengths_.end(), other.string_lengths_.begin(), other.string_lengths_.end());
+            string_data_.append(other.string_data_);
+            break;
+        }
+    }
+    text_rows_.reserve(text_rows_.size() + other.text_rows_.size());
+    for (size_t i = 0; i < other.text_rows_.size(); ++i) {
+        keepText(size_ + other.text_rows_[i], other.keptTextAt(i));
+    }
+    size_ += other.size_;
+}
+
+void Column::keepText(size_t row, std::string_view text) {
+    if (!text_rows_.empty() && row <= text_rows_.back()) {
+        throw std::runtime_error("Kept text of column '" + name_ + "' out of row order.");
+    }
+    text_rows_.push_back(row);
+    text_data_.append(text.data(), text.size());
+    text_ends_.push_back(text_data_.size());
+    if (!text.empty() && isMissing(row)) {
+        stray_count_++;
+    }
+}
+
+bool Column::keptText(size_t row, std::string_view& text) const {
+    if (text_rows_.empty() || row > text_rows_.back()) {
+        return false;
+    }
+    auto it = std::lower_bound(text_rows_.begin(), text_rows_.end(), row);
+    if (*it != row) {
+        return false;
+    }
+    text = keptTextAt(it - text_rows_.begin());
+    return true;
+}
+
+std::string Column::toString(size_t row) const {
+    std::string_view text;
+    if (keptText(row, text)) {
+        return std::string(text);
+    }
+    return formatValue(row);
+}
+
+std::string Column::formatValue(size_t row) const {
+    switch (type_) {
+        case ColumnType::INT64:
+            return std::to_string(ints_[row]);
+        case ColumnType::DOUBLE: {
+            char buf[32];
+            auto result = std::to_chars(buf, buf + sizeof(buf), doubles_[row]);
+            return std::string(buf, result.ptr);
+        }
+        case ColumnType::BOOL:
+            return bools_[row] ? "true" : "false";
+        case ColumnType::STRING:
+            return std::string(getString(row));
+        default:
+            throw std::runtime_error("Unknown column type.");
+    }
+}
+
+void Column::reserve(size_t rows) {
+    switch (type_) {
+        case ColumnType::INT64:
+            ints_.reserve(rows);
+            break;
+        case ColumnType::DOUBLE:
+            doubles_.reserve(rows);
+            break;
+        case ColumnType::BOOL:
+            bools_.reserve(rows);
+            break;
+        case ColumnType::STRING:
+            if (dictionary_) {
+                codes_.reserve(rows);
+                break;
+            }
+            string_offsets_.reserve(rows);
+            string_lengths_.reserve(rows);
+            break;
+    }
+}
+
+// Rebuild a container in another resource; a move-constructed container
+// keeps the allocator it is moved from, where assignment would not
+template <typename Container>
+static void moveContainer(Container& container, std::pmr::memory_resource* resource) {
+    Container moved(container.begin(), container.end(), resource);
+    container.~Container();
+    new (&container) Container(std::move(moved));
+}
+
+void Column::moveStorage(std::pmr::memory_resource* resource) {
+    if (resource == getResource()) {
+        return;
+    }
+    moveContainer(ints_, resource);
+    moveContainer(doubles_, resource);
+    moveContainer(bools_, resource);
+    moveContainer(string_data_, resource);
+    moveContainer(string_offsets_, resource);
+    moveContainer(string_lengths_, resource);
+    moveContainer(validity_, resource);
+    moveContainer(codes_, resource);
+    moveContainer(text_rows_, resource);
+    moveContainer(text_ends_, resource);
+    moveContainer(text_data_, resource);
+}
+
+size_t Column::memoryUsage() const {
+    // std::string keeps short contents inline
+    auto heapBytes = [](const std::pmr::string& data) {
+        return data.capacity() > std::pmr::string().capacity() ? data.capacity() + 1 : 0;
+    };
+    return ints_.capacity() * sizeof(int64_t) + doubles_.capacity() * sizeof(double) +
+           bools_.capacity() * sizeof(uint8_t) + heapBytes(string_data_) +
+           string_offsets_.capacity() * sizeof(uint64_t) + string_lengths_.capacity() * sizeof(uint32_t) +
+           validity_.capacity() * sizeof(uint64_t) + codes_.capacity() * sizeof(uint32_t) +
+           (text_rows_.capacity() + text_ends_.capacity()) * sizeof(uint64_t) + heapBytes(text_data_);
+}
+
+size_t ColumnTable::addColumn(const std::string& name, ColumnType type) {
+    size_t index = columns_.size();
+    columns_.emplace_back(name, type, resource_);
+    last_use_.push_back(0);
+    // A duplicated header name resolves to its last occurrence, as the row maps did
+    column_index_[name] = index;
+    return index;
+}
+
+size_t ColumnTable::addColumn(Column&& column) {
+    if (column.size() != row_ids_.size()) {
+        throw std::runtime_error("Column '" + column.getName() + "' does not match the table's row count.");
+    }
+    size_t index = columns_.size();
+    column_index_[column.getName()] = index;
+    columns_.push_back(std::move(column));
+    last_use_.push_back(0);
+    return index;
+}
+
+int ColumnTable::findColumn(const std::string& name) const {
+    auto it = column_index_.find(name);
+    if (it != column_index_.end()) {
+        return static_cast<int>(it->second);
+    }
+    return -1;
+}
+
+void ColumnTable::appendTable(const ColumnTable& other, uint64_t row_id_offset) {
+    if (other.columns_.size() != columns_.size()) {
+        throw std::runtime_error("Cannot append a table with a different number of columns.");
+    }
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        columns_[i].appendColumn(other.columns_[i]);
+    }
+    row_ids_.reserve(row_ids_.size() + other.row_ids_.size());
+    for (uint64_t row_id : other.row_ids_) {
+        row_ids_.push_back(row_id + row_id_offset);
+    }
+}
+
+void ColumnTable::replaceColumn(size_t index, Column&& column) {
+    if (column.getName() != columns_[index].getName() || column.size() != columns_[index].size()) {
+        throw std::runtime_error("Replacement for column '" + columns_[index].getName() + "' does not match.");
+    }
+    // Move assignment would copy the cells into the old column's memory resource
+    columns_[index].~Column();
+    new (&columns_[index]) Column(std::move(column));
+}
+
+std::unordered_map<std::string, std::string> ColumnTable::materializeRow(size_t row) const {
+    std::unordered_map<std::string, std::string> result;
+    for (const auto& column : columns_) {
+        std::string_view text;
+        if (!column.isMissing(row)) {
+            result[column.getName()] = column.toString(row);
+        }
+        else if (column.keptText(row, text)) {
+            // An empty cell of a typed column
+            result[column.getName()] = std::string(text);
+        }
+    }
+    return result;
+}
+
+void ColumnTable::reserve(size_t rows) {
+    for (auto& column : columns_) {
+        column.reserve(rows);
+    }
+    row_ids_.reserve(rows);
+}
+
+void ColumnTable::clear() {
+    columns_.clear();
+    column_index_.clear();
+    row_ids_.clear();
+    last_use_.clear();
+}
@@ -0,0 +1,380 @@
+// CompressedReader.cpp
+#include "CompressedReader.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Frames larger than this are left to the sequential stream rather than
+// buffered whole by a parallel job
+static const uint64_t MAX_PARALLEL_FRAME = 64ull << 20;
+
+Compression detectCompression(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    unsigned char magic[4] = { 0, 0, 0, 0 };
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    if (file.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return Compression::GZIP;
+    }
+    if (file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return Compression::ZSTD;
+    }
+    return Compression::NONE;
+}
+
+CompressedReader::CompressedReader(size_t block_size, size_t num_threads)
+    : block_size_(block_size), num_threads_(num_threads), format_(Compression::NONE), next_job_(0),
+      inflate_open_(false),
+#ifdef CSV_ZSTD
+      zstd_(nullptr), zstd_in_frame_(false),
+#endif
+      stream_pos_(0), stream_done_(false), window_(0), current_pos_(0), input_done_(false),
+      failed_(false) {}
+
+CompressedReader::~CompressedReader() {
+    close();
+}
+
+bool CompressedReader::open(const std::string& filename) {
+    close();
+    filename_ = filename;
+    format_ = detectCompression(filename);
+    if (format_ == Compression::NONE) {
+        std::cerr << "Not a gzip or zstd file: " << filename << std::endl;
+        return false;
+    }
+#ifndef CSV_ZSTD
+    if (format_ == Compression::ZSTD) {
+        std::cerr << "zstd input needs a build with -DCSV_ZSTD -lzstd: " << filename << std::endl;
+        return false;
+    }
+#endif
+    if (!file_.open(filename)) {
+        return false;
+    }
+    next_job_ = 0;
+    current_pos_ = 0;
+    input_done_ = false;
+    failed_ = false;
+
+    bool split = (format_ == Compression::GZIP) ? splitGzipMembers() : splitZstdFrames();
+    if (split) {
+        groupFrames();
+        pool_.reset(new ThreadPool(num_threads_));
+        window_ = 2 * pool_->size();
+        return true;
+    }
+    frame_bounds_.clear();
+    frame_sizes_.clear();
+    if (!openStream()) {
+        std::cerr << "Failed to initialize decompression for: " << filename << std::endl;
+        file_.close();
+        return false;
+    }
+    pool_.reset(new ThreadPool(1));
+    window_ = 2;
+    return true;
+}
+
+void CompressedReader::close() {
+    // Workers write into the pending chunks and read the mapping
+    for (auto& pending : pending_) {
+        pending.done.wait();
+    }
+    pending_.clear();
+    pool_.reset();
+    current_.reset();
+    if (inflate_open_) {
+        inflateEnd(&inflate_);
+        inflate_open_ = false;
+    }
+#ifdef CSV_ZSTD
+    ZSTD_freeDStream(zstd_);
+    zstd_ = nullptr;
+#endif
+    frame_bounds_.clear();
+    frame_sizes_.clear();
+    job_frames_.clear();
+    file_.close();
+}
+
+size_t CompressedReader::read(char* dest) {
+    while (!current_ || current_pos_ == current_->data.size()) {
+        if (!nextChunk()) {
+            return 0;
+        }
+    }
+    size_t count = std::min(block_size_, current_->data.size() - current_pos_);
+    memcpy(dest, current_->data.data() + current_pos_, count);
+    current_pos_ += count;
+    return count;
+}
+
+bool CompressedReader::splitGzipMembers() {
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(file_.data());
+    const uint64_t size = file_.size();
+    uint64_t offset = 0;
+    while (offset < size) {
+        // BGZF header: gzip magic, deflate, FEXTRA set, and a "BC" subfield
+        // holding the member size minus one
+        const unsigned char* member = base + offset;
+        uint64_t left = size - offset;
+        if (left < 18 || member[0] != 0x1f || member[1] != 0x8b || member[2] != 8 || (member[3] & 4) == 0) {
+            return false;
+        }
+        uint64_t extra_end = 12 + (member[10] | (member[11] << 8));
+        if (extra_end > left) {
+            return false;
+        }
+        uint64_t member_size = 0;
+        for (uint64_t pos = 12; pos + 4 <= extra_end;) {
+            uint64_t length = member[pos + 2] | (member[pos + 3] << 8);
+            if (member[pos] == 'B' && member[pos + 1] == 'C' && length == 2 && pos + 6 <= extra_end) {
+                member_size = (member[pos + 4] | (member[pos + 5] << 8)) + 1;
+                break;
+            }
+            pos += 4 + length;
+        }
+        if (member_size < extra_end + 8 || member_size > left) {
+            return false;
+        }
+        // The trailer ends with the length of the member's text (ISIZE)
+        const unsigned char* trailer = member + member_size - 4;
+        frame_bounds_.push_back(offset);
+        frame_sizes_.push_back(trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+                               (static_cast<uint64_t>(trailer[3]) << 24));
+        offset += member_size;
+    }
+    frame_bounds_.push_back(size);
+    return true;
+}
+
+bool CompressedReader::splitZstdFrames() {
+#ifdef CSV_ZSTD
+    const char* base = file_.data();
+    const uint64_t size = file_.size();
+    uint64_t offset = 0;
+    while (offset < size) {
+        // Both sizes come from the frame and block headers, without decompressing
+        size_t frame_size = ZSTD_findFrameCompressedSize(base + offset, size - offset);
+        unsigned long long content_size = ZSTD_getFrameContentSize(base + offset, size - offset);
+        if (ZSTD_isError(frame_size) || content_size == ZSTD_CONTENTSIZE_UNKNOWN ||
+            content_size == ZSTD_CONTENTSIZE_ERROR || content_size > MAX_PARALLEL_FRAME) {
+            return false;
+        }
+        frame_bounds_.push_back(offset);
+        frame_sizes_.push_back(content_size);
+        offset += frame_size;
+    }
+    frame_bounds_.push_back(size);
+    // A single frame gains nothing from a job of its own
+    return frame_sizes_.size() > 1;
+#else
+    return false;
+#endif
+}
+
+void CompressedReader::groupFrames() {
+    const size_t num_frames = frame_sizes_.size();
+    for (size_t idx = 0; idx < num_frames; ++idx) {
+        if (job_frames_.empty() || frame_bounds_[idx] - frame_bounds_[job_frames_.back()] >= block_size_) {
+            job_frames_.push_back(idx);
+        }
+    }
+    job_frames_.push_back(num_frames);
+}
+
+bool CompressedReader::openStream() {
+    stream_pos_ = 0;
+    stream_done_ = false;
+    if (format_ == Compression::GZIP) {
+        memset(&inflate_, 0, sizeof(inflate_));
+        // 16 + MAX_WBITS: expect gzip headers and trailers
+        inflate_open_ = (inflateInit2(&inflate_, 16 + MAX_WBITS) == Z_OK);
+        return inflate_open_;
+    }
+#ifdef CSV_ZSTD
+    zstd_ = ZSTD_createDStream();
+    zstd_in_frame_ = false;
+    return zstd_ != nullptr && !ZSTD_isError(ZSTD_initDStream(zstd_));
+#else
+    return false;
+#endif
+}
+
+void CompressedReader::fillWindow() {
+    while (!input_done_ && pending_.size() < window_) {
+        if (isParallel() && next_job_ + 1 >= job_frames_.size()) {
+            break;
+        }
+        PendingChunk pending;
+        pending.chunk.reset(new Chunk());
+        Chunk* chunk = pending.chunk.get();
+        if (isParallel()) {
+            size_t job = next_job_++;
+            chunk->last = (job + 2 == job_frames_.size());
+            pending.done = pool_->submit([this, job, chunk] { decompressFrames(job, *chunk); });
+        }
+        else {
+            // The single worker runs these in order; ones queued past the end come back empty
+            pending.done = pool_->submit([this, chunk] { decompressStream(*chunk); });
+        }
+        pending_.push_back(std::move(pending));
+    }
+}
+
+bool CompressedReader::nextChunk() {
+    if (input_done_) {
+        return false;
+    }
+    fillWindow();
+    if (pending_.empty()) {
+        return false;
+    }
+    PendingChunk next = std::move(pending_.front());
+    pending_.pop_front();
+    next.done.get();
+    current_ = std::move(next.chunk);
+    current_pos_ = 0;
+    if (!current_->error.empty()) {
+        std::cerr << "Corrupt compressed data in " << filename_ << ": " << current_->error << std::endl;
+        current_.reset();
+        input_done_ = true;
+        failed_ = true;
+        return false;
+    }
+    input_done_ = current_->last;
+    // Keep the workers busy while this chunk is parsed
+    fillWindow();
+    return true;
+}
+
+void CompressedReader::decompressFrames(size_t job, Chunk& chunk) const {
+    const char* base = file_.data();
+    const size_t first = job_frames_[job];
+    const size_t last = job_frames_[job + 1];
+    size_t total = 0;
+    for (size_t idx = first; idx < last; ++idx) {
+        total += frame_sizes_[idx];
+    }
+    chunk.data.resize(total);
+
+    size_t produced = 0;
+    if (format_ == Compression::GZIP) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+            chunk.error = "failed to initialize zlib";
+            return;
+        }
+        for (size_t idx = first; idx < last && chunk.error.empty(); ++idx) {
+            inflateReset(&stream);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(base + frame_bounds_[idx]));
+            stream.avail_in = static_cast<uInt>(frame_bounds_[idx + 1] - frame_bounds_[idx]);
+            stream.next_out = reinterpret_cast<Bytef*>(chunk.data.data() + produced);
+            stream.avail_out = static_cast<uInt>(frame_sizes_[idx]);
+            if (inflate(&stream, Z_FINISH) != Z_STREAM_END || stream.avail_out != 0) {
+                chunk.error = stream.msg ? stream.msg : "member does not match its recorded size";
+            }
+            produced += frame_sizes_[idx];
+        }
+        inflateEnd(&stream);
+        return;
+    }
+#ifdef CSV_ZSTD
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    for (size_t idx = first; idx < last && chunk.error.empty(); ++idx) {
+        size_t got = ZSTD_decompressDCtx(context, chunk.data.data() + produced, frame_sizes_[idx],
+                                         base + frame_bounds_[idx], frame_bounds_[idx + 1] - frame_bounds_[idx]);
+        if (ZSTD_isError(got)) {
+            chunk.error = ZSTD_getErrorName(got);
+        }
+        else if (got != frame_sizes_[idx]) {
+            chunk.error = "frame does not match its recorded size";
+        }
+        produced += frame_sizes_[idx];
+    }
+    ZSTD_freeDCtx(context);
+#endif
+}
+
+void CompressedReader::decompressStream(Chunk& chunk) {
+    if (stream_done_) {
+        chunk.last = true;
+        return;
+    }
+    chunk.data.resize(4 * block_size_);
+#ifdef CSV_ZSTD
+    if (format_ == Compression::ZSTD) {
+        zstdStream(chunk);
+    }
+    else
+#endif
+    {
+        inflateStream(chunk);
+    }
+    chunk.last = stream_done_;
+}
+
+void CompressedReader::inflateStream(Chunk& chunk) {
+    const char* base = file_.data();
+    const uint64_t size = file_.size();
+    inflate_.next_out = reinterpret_cast<Bytef*>(chunk.data.data());
+    inflate_.avail_out = static_cast<uInt>(chunk.data.size());
+    while (inflate_.avail_out > 0) {
+        // avail_in is 32 bits wide, so large files are fed in slices
+        if (inflate_.avail_in == 0) {
+            inflate_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(base + stream_pos_));
+            inflate_.avail_in = static_cast<uInt>(std::min<uint64_t>(size - stream_pos_, 1u << 30));
+        }
+        int ret = inflate(&inflate_, Z_NO_FLUSH);
+        stream_pos_ = reinterpret_cast<const char*>(inflate_.next_in) - base;
+        if (ret == Z_STREAM_END) {
+            // Concatenated members continue the same text; anything else is trailing garbage
+            if (size - stream_pos_ >= 2 && static_cast<unsigned char>(base[stream_pos_]) == 0x1f &&
+                static_cast<unsigned char>(base[stream_pos_ + 1]) == 0x8b) {
+                inflateReset(&inflate_);
+                continue;
+            }
+            stream_done_ = true;
+            break;
+        }
+        if (ret != Z_OK) {
+            // Z_BUF_ERROR with no input left is a member cut short
+            chunk.error = stream_pos_ == size ? "unexpected end of file" : (inflate_.msg ? inflate_.msg : "inflate failed");
+            stream_done_ = true;
+            break;
+        }
+    }
+    chunk.data.resize(chunk.data.size() - inflate_.avail_out);
+}
+
+#ifdef CSV_ZSTD
+void CompressedReader::zstdStream(Chunk& chunk) {
+    const char* base = file_.data();
+    const uint64_t size = file_.size();
+    ZSTD_outBuffer out = { chunk.data.data(), chunk.data.size(), 0 };
+    while (out.pos < out.size) {
+        // Frames follow one another without a reset
+        ZSTD_inBuffer in = { base + stream_pos_, size - stream_pos_, 0 };
+        size_t produced = out.pos;
+        size_t ret = ZSTD_decompressStream(zstd_, &out, &in);
+        stream_pos_ += in.pos;
+        if (ZSTD_isError(ret)) {
+            chunk.error = ZSTD_getErrorName(ret);
+            stream_done_ = true;
+            break;
+        }
+        if (in.pos == 0 && out.pos == produced) {
+            // Nothing left to read or flush
+            if (zstd_in_frame_) {
+                chunk.error = "unexpected end of file";
+            }
+            stream_done_ = true;
+            break;
+        }
+        zstd_in_frame_ = (ret != 0);
+    }
+    chunk.data.resize(out.pos);
+}
+#endif
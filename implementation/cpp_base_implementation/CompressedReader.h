@@ -0,0 +1,109 @@
+// CompressedReader.h
+#ifndef COMPRESSEDREADER_H
+#define COMPRESSEDREADER_H
+
+#include "BlockReader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#ifdef CSV_ZSTD
+#include <zstd.h>
+#endif
+
+// Compression of a file, told from its leading magic bytes
+enum class Compression {
+    NONE,
+    GZIP,       // One or more gzip members (BGZF included)
+    ZSTD        // One or more zstd frames; readable when built with -DCSV_ZSTD
+};
+
+Compression detectCompression(const std::string& filename);
+
+// Decompresses a gzip or zstd file into blocks of CSV text. When the file is
+// a run of independently compressed frames whose sizes are known up front
+// (gzip members carrying a BGZF "BC" size field, or zstd frames recording
+// their content size), groups of frames are decompressed in parallel on a
+// thread pool and handed out in file order. Any other file can only be
+// decompressed front to back, which one worker does ahead of the reader.
+class CompressedReader : public BlockReader {
+public:
+    // A thread count of 0 uses every core
+    explicit CompressedReader(size_t block_size = 1 << 20, size_t num_threads = 0);
+    ~CompressedReader() override;
+    CompressedReader(const CompressedReader&) = delete;
+    CompressedReader& operator=(const CompressedReader&) = delete;
+
+    // Fails (and logs) unless the file is gzip, or zstd in a CSV_ZSTD build
+    bool open(const std::string& filename);
+    size_t read(char* dest) override;
+    void close();
+
+    size_t blockSize() const override { return block_size_; }
+    bool failed() const override { return failed_; }
+    // Whether the frames were split up front and decompressed in parallel
+    bool isParallel() const { return !job_frames_.empty(); }
+
+private:
+    // Decompressed output of one job
+    struct Chunk {
+        std::vector<char> data;
+        std::string error;          // Set if the compressed data is corrupt
+        bool last = false;          // No chunk follows this one
+    };
+    struct PendingChunk {
+        std::unique_ptr<Chunk> chunk;
+        std::future<void> done;
+    };
+
+    // Find every frame and its decompressed size; false if any is unknown
+    bool splitGzipMembers();
+    bool splitZstdFrames();
+    // Group the frames into jobs of about one block of compressed input
+    void groupFrames();
+    bool openStream();
+    // Queue jobs until the window is full
+    void fillWindow();
+    // Wait for the next chunk in file order; false at the end of the input
+    bool nextChunk();
+    // Decompress frames job_frames_[job] up to job_frames_[job + 1]
+    void decompressFrames(size_t job, Chunk& chunk) const;
+    // Decompress the next stride of the sequential stream (single worker only)
+    void decompressStream(Chunk& chunk);
+    void inflateStream(Chunk& chunk);
+#ifdef CSV_ZSTD
+    void zstdStream(Chunk& chunk);
+#endif
+
+    size_t block_size_;
+    size_t num_threads_;
+    std::string filename_;
+    Compression format_;
+    MappedFile file_;
+    std::vector<uint64_t> frame_bounds_;    // Offset of every frame, plus the file size
+    std::vector<uint64_t> frame_sizes_;     // Decompressed size of every frame
+    std::vector<size_t> job_frames_;        // First frame of every parallel job, plus the frame count
+    size_t next_job_;                       // Next parallel job to queue
+    z_stream inflate_;                      // Sequential gzip state
+    bool inflate_open_;
+#ifdef CSV_ZSTD
+    ZSTD_DStream* zstd_;                    // Sequential zstd state
+    bool zstd_in_frame_;                    // The stream stopped inside a frame
+#endif
+    uint64_t stream_pos_;                   // Compressed bytes consumed by the sequential stream
+    bool stream_done_;                      // The sequential stream reached the end of the input
+    size_t window_;                         // Chunks decompressed ahead of the reader
+    std::unique_ptr<ThreadPool> pool_;
+    std::deque<PendingChunk> pending_;
+    std::unique_ptr<Chunk> current_;
+    size_t current_pos_;
+    bool input_done_;                       // The last chunk has been handed to current_
+    bool failed_;                           // Decompression stopped on corrupt data
+};
+
+#endif // COMPRESSEDREADER_H
@@ -4,9 +4,12 @@
 
 #include "Operand.h"
 #include "ElementFilter.h"
+#include "QueryOptimizer.h"
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <string>
+#include <unordered_set>
 
 // ElementSelect class
 class ElementSelect {
@@ -24,6 +27,56 @@ public:
     const std::vector<std::shared_ptr<Operand>>& getOperands() const { return operands_; }
     const std::string& getTable() const { return table_; }
     std::shared_ptr<ElementFilter> getFilter() const { return filter_; }
+
+    // Fold constants and rewrite WHERE comparisons (see QueryOptimizer.h); call
+    // before taking the required columns and scan predicates
+    void optimize() {
+        for (auto& operand : operands_) {
+            operand = foldConstants(operand);
+        }
+        filter_ = optimizeFilter(filter_);
+    }
+
+    // Columns the query reads, from the selected operands and every filter;
+    // only these need to be loaded (projection pushdown)
+    std::unordered_set<std::string> getRequiredColumns() const {
+        std::unordered_set<std::string> columns;
+        for (const auto& operand : operands_) {
+            operand->collectColumns(columns);
+        }
+        filter_->collectColumns(columns);
+        return columns;
+    }
+
+    // WHERE conjuncts the loader can check on raw cells (predicate pushdown);
+    // the filters still run on the loaded rows
+    std::vector<ScanPredicate> getScanPredicates() const {
+        std::vector<ScanPredicate> predicates;
+        filter_->collectScanPredicates(predicates);
+        return predicates;
+    }
+
+    // Columns the query reads that are not among the CSV headers, sorted
+    std::vector<std::string> findUnknownColumns(const std::vector<std::string>& headers) const {
+        std::unordered_set<std::string> known(headers.begin(), headers.end());
+        std::vector<std::string> unknown;
+        for (const auto& column : getRequiredColumns()) {
+            if (known.count(column) == 0) {
+                unknown.push_back(column);
+            }
+        }
+        std::sort(unknown.begin(), unknown.end());
+        return unknown;
+    }
+
+    // Resolve every column reference to its ordinal in the table, so rows are
+    // evaluated by index instead of by name
+    void bind(const ColumnTable& table) const {
+        for (const auto& operand : operands_) {
+            operand->bind(table);
+        }
+        filter_->bind(table);
+    }
     
 private:
     std::vector<std::shared_ptr<Operand>> operands_;
@@ -0,0 +1,84 @@
+// NumericParse.cpp
+#include "NumericParse.h"
+#include <cctype>
+#include <charconv>
+#include <strings.h>
+#include <system_error>
+
+// Skip leading whitespace and a '+' sign that from_chars would reject
+static std::string_view stripNumericPrefix(std::string_view text) {
+    size_t i = 0;
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+        i++;
+    }
+    if (i < text.size() && text[i] == '+' &&
+        !(i + 1 < text.size() && (text[i + 1] == '-' || text[i + 1] == '+'))) {
+        i++;
+    }
+    return text.substr(i);
+}
+
+template <typename T>
+static ParseStatus parseNumber(std::string_view text, T& value) {
+    std::string_view digits = stripNumericPrefix(text);
+    if (digits.empty()) {
+        return ParseStatus::EMPTY;
+    }
+    const char* end = digits.data() + digits.size();
+    auto result = std::from_chars(digits.data(), end, value);
+    if (result.ec == std::errc::result_out_of_range) {
+        return ParseStatus::OUT_OF_RANGE;
+    }
+    return (result.ec == std::errc() && result.ptr == end) ? ParseStatus::OK : ParseStatus::INVALID;
+}
+
+ParseStatus parseInt64(std::string_view text, int64_t& value) {
+    return parseNumber(text, value);
+}
+
+ParseStatus parseInt32(std::string_view text, int32_t& value) {
+    return parseNumber(text, value);
+}
+
+ParseStatus parseDouble(std::string_view text, double& value) {
+    // std::stod also read hexadecimal numbers ("0x1F", "0x1.8p1"), which
+    // from_chars takes only without their prefix and sign
+    std::string_view digits = stripNumericPrefix(text);
+    bool negative = !digits.empty() && digits[0] == '-';
+    std::string_view hex = digits.substr(negative ? 1 : 0);
+    if (hex.size() > 2 && hex[0] == '0' && (hex[1] == 'x' || hex[1] == 'X') && hex[2] != '-' && hex[2] != '+') {
+        hex.remove_prefix(2);
+        const char* end = hex.data() + hex.size();
+        auto result = std::from_chars(hex.data(), end, value, std::chars_format::hex);
+        if (result.ec == std::errc::result_out_of_range) {
+            return ParseStatus::OUT_OF_RANGE;
+        }
+        if (result.ec != std::errc() || result.ptr != end) {
+            return ParseStatus::INVALID;
+        }
+        value = negative ? -value : value;
+        return ParseStatus::OK;
+    }
+    return parseNumber(text, value);
+}
+
+ParseStatus parseBool(std::string_view text, bool& value) {
+    if (text.size() == 4 && strncasecmp(text.data(), "true", 4) == 0) {
+        value = true;
+        return ParseStatus::OK;
+    }
+    if (text.size() == 5 && strncasecmp(text.data(), "false", 5) == 0) {
+        value = false;
+        return ParseStatus::OK;
+    }
+    return text.empty() ? ParseStatus::EMPTY : ParseStatus::INVALID;
+}
+
+std::string_view trimSpace(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t end = text.find_last_not_of(" \t\r\n");
+    return text.substr(begin, end - begin + 1);
+}
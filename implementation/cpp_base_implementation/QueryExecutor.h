@@ -4,6 +4,7 @@
 
 #include "CSVLoader.h"
 #include "ElementSelect.h"
+#include "QueryProgram.h"
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -13,12 +14,28 @@
 
 class QueryExecutor {
 public:
-    QueryExecutor(const CSVLoader& loader) : loader_(loader) {}
+    QueryExecutor(CSVLoader& loader) : loader_(loader) {}
     
+    // Run the query over the table already loaded with CSVLoader::load
     void execute(const ElementSelect& select) const;
+    // Stream the file through the query batch_rows rows at a time; memory is
+    // bounded by the batch size plus the state of GLOBAL filters
+    void executeBatches(const ElementSelect& select, size_t batch_rows) const;
+    // Instructions the query programs have executed, over every query and batch run
+    const ProgramProfile& getProfile() const { return profile_; }
     
 private:
-    const CSVLoader& loader_;
+    // Check the query's columns against the CSV headers once, up front;
+    // reports and returns false if any does not exist
+    bool checkColumns(const ElementSelect& select) const;
+    void printHeader(const ElementSelect& select) const;
+    // Filter, project and print the rows of one table or batch
+    void emitRows(const ColumnTable& table, const ElementSelect& select) const;
+    // Report a row that failed to evaluate; it is not printed
+    void reportError(const ColumnTable& table, const RowError& error) const;
+
+    CSVLoader& loader_;
+    mutable ProgramProfile profile_;
 };
 
 #endif // QUERYEXECUTOR_H
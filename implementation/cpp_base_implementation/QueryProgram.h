@@ -0,0 +1,111 @@
+// QueryProgram.h
+#ifndef QUERYPROGRAM_H
+#define QUERYPROGRAM_H
+
+#include "CompiledExpression.h"
+#include "ElementSelect.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+// Instructions of a QueryProgram
+enum class OpCode : uint8_t {
+    LOAD_COLUMN,        // target = cells of a column
+    ARITHMETIC,         // target = left (operator) right, by a typed kernel
+    COMPARE,            // Narrow the selection to rows where left (comparator) right, by a typed kernel
+    EVALUATE,           // target = an operand the program does not lower, evaluated by the operand
+    FILTER,             // Narrow the selection with a filter the program does not lower
+    NUM_OPCODES
+};
+
+const char* opcodeName(OpCode opcode);
+
+// Instructions executed, and the rows they were executed over, per opcode
+struct ProgramProfile {
+    static const size_t NUM_OPCODES = static_cast<size_t>(OpCode::NUM_OPCODES);
+    std::array<uint64_t, NUM_OPCODES> instructions{};
+    std::array<uint64_t, NUM_OPCODES> rows{};
+
+    void add(const ProgramProfile& other);
+    // One line per opcode executed at least once
+    void print(std::ostream& out) const;
+};
+
+// The filters and projections of an ElementSelect lowered, for the column
+// types of one table, into a flat register program that runs over a batch at
+// a time. The WHERE conditions come first, in the order the composite filter
+// applies them, each narrowing the selection for the instructions after it;
+// the projections follow. Numeric expressions and comparisons become one
+// typed-kernel instruction per operator, reading columns and constants in
+// place and sub-expressions from registers, so no operand tree is walked per
+// batch. Anything else (string comparisons and their dictionary path,
+// DISTINCT, LIMIT, ...) stays a single instruction calling the filter or
+// operand.
+class QueryProgram {
+public:
+    // Lower a select already bound to the table; the program holds until the
+    // table's columns change
+    QueryProgram(const ElementSelect& select, const ColumnTable& table);
+
+    QueryProgram(const QueryProgram&) = delete;
+    QueryProgram& operator=(const QueryProgram&) = delete;
+
+    // Filter a batch, adding the rows dropped because they failed to errors,
+    // then evaluate the projections for the rows left
+    void run(const ColumnTable& table, SelectionVector& selection, std::vector<RowError>& errors);
+    // Values of projection k for the rows left by the last run
+    const ValueVector& output(size_t k) const { return registers_[outputs_[k]]; }
+
+    size_t numInstructions() const { return code_.size(); }
+    size_t numRegisters() const { return registers_.size(); }
+    const ProgramProfile& getProfile() const { return profile_; }
+
+private:
+    static const uint16_t NO_REGISTER = 0xFFFF;
+
+    struct Instruction {
+        OpCode opcode;
+        uint16_t target = NO_REGISTER;          // Register written
+        uint16_t left_register = NO_REGISTER;   // Registers read by DOUBLE_VECTOR inputs
+        uint16_t right_register = NO_REGISTER;
+        uint32_t slot = 0;                      // Column ordinal, or index into inputs_, operands_ or filters_
+        union {
+            CompiledExpression::Kernel arithmetic;
+            CompiledComparison::Kernel comparison;
+        };
+
+        explicit Instruction(OpCode code) : opcode(code), arithmetic(nullptr) {}
+    };
+
+    // Sizes to roll back to when an expression turns out not to lower
+    struct Mark {
+        size_t code;
+        size_t registers;
+        size_t inputs;
+    };
+
+    void lowerFilter(const std::shared_ptr<ElementFilter>& filter, const ColumnTable& table);
+    bool lowerComparison(const WhereFilter& filter, const ColumnTable& table);
+    bool lowerExpression(const ExpressionOperand& expression, const ColumnTable& table, uint16_t& target);
+    bool lowerInput(const Operand& operand, const ColumnTable& table, CompiledExpression::Input& input,
+                    uint16_t& target);
+    uint16_t lowerProjection(const std::shared_ptr<Operand>& operand, const ColumnTable& table);
+
+    uint16_t newRegister();
+    Mark mark() const { return { code_.size(), registers_.size(), inputs_.size() }; }
+    void rollback(const Mark& to);
+    const ValueVector* read(uint16_t reg) const { return reg == NO_REGISTER ? nullptr : &registers_[reg]; }
+
+    std::vector<Instruction> code_;
+    std::vector<std::pair<CompiledExpression::Input, CompiledExpression::Input>> inputs_;
+    std::vector<std::shared_ptr<Operand>> operands_;
+    std::vector<std::shared_ptr<ElementFilter>> filters_;
+    std::vector<ValueVector> registers_;        // Kept across batches, so their storage is reused
+    std::vector<uint16_t> outputs_;             // Register of each projection
+    ProgramProfile profile_;
+};
+
+#endif // QUERYPROGRAM_H
@@ -0,0 +1,69 @@
+// ReadAheadReader.h
+#ifndef READAHEADREADER_H
+#define READAHEADREADER_H
+
+#include "BlockReader.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sequential block reader that keeps the next blocks in flight while the
+// caller parses the current one. Reads are issued through io_uring when the
+// kernel allows it, otherwise by a dedicated reader thread (with
+// POSIX_FADV_SEQUENTIAL); a depth of 0, or a file of a single block, is read
+// synchronously. The first short block ends the stream, so a file that grows
+// while it is read is seen as the prefix that existed at that point.
+class ReadAheadReader : public BlockReader {
+public:
+    explicit ReadAheadReader(size_t block_size = 1 << 20, size_t depth = 3);
+    ~ReadAheadReader() override;
+    ReadAheadReader(const ReadAheadReader&) = delete;
+    ReadAheadReader& operator=(const ReadAheadReader&) = delete;
+
+    bool open(const std::string& filename);
+    size_t read(char* dest) override;
+    void close();
+
+    size_t blockSize() const override { return block_size_; }
+    bool failed() const override { return failed_; }
+    bool usesIoUring() const { return ring_ != nullptr; }
+
+private:
+    // One buffer of the read-ahead window; block b lives in slot b % window_
+    struct Slot {
+        std::unique_ptr<char[]> data;   // block_size_ bytes, left uninitialized
+        int64_t result = 0;         // Bytes read, or -errno
+        bool ready = false;
+    };
+    // Submission and completion queues mapped from the kernel (ReadAheadReader.cpp)
+    struct Ring;
+
+    bool setupRing();
+    void submitRead(uint64_t block);
+    // Wait for at least one io_uring completion and mark its slot ready
+    bool reapCompletions();
+    void readerLoop();
+    // Synchronous read of one block into dest, whose first done bytes are already filled
+    int64_t readBlock(uint64_t block, char* dest, size_t done) const;
+
+    size_t block_size_;
+    size_t depth_;                  // Requested read-ahead depth
+    size_t window_;                 // Depth in use for the open file (no more than its blocks)
+    int fd_;
+    std::vector<Slot> slots_;
+    uint64_t next_block_;           // Next block handed out by read()
+    bool finished_;                 // A short block or an error ended the stream
+    bool failed_;                   // An error ended the stream
+    std::unique_ptr<Ring> ring_;
+    size_t in_flight_;              // io_uring reads not yet completed
+    std::thread reader_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+};
+
+#endif // READAHEADREADER_H
@@ -0,0 +1,57 @@
+// RowOffsetIndex.h
+#ifndef ROWOFFSETINDEX_H
+#define ROWOFFSETINDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Byte offset of every data record of a CSV file, stored next to it as
+// <csv>.rowidx. Record lengths are kept as varint deltas with an absolute
+// checkpoint every CHECKPOINT_ROWS rows, so a row id (the zero-based data
+// row number, as stored in ColumnTable and the B-tree indexes) resolves to
+// its byte range after decoding at most CHECKPOINT_ROWS deltas.
+class RowOffsetIndex {
+public:
+    static const size_t CHECKPOINT_ROWS = 64;
+
+    explicit RowOffsetIndex(const std::string& csv_filename);
+
+    const std::string& getPath() const { return index_path_; }
+
+    // Read the persisted index; false if it is missing, stale or corrupt
+    bool open();
+    // Scan the CSV for its record boundaries and persist the index
+    bool build();
+    // open(), falling back to build()
+    bool openOrBuild();
+
+    uint64_t numRows() const { return num_rows_; }
+    // Byte range [0, end) of the header record
+    uint64_t headerEnd() const { return data_begin_; }
+    // Byte range [begin, end) of count consecutive records starting at
+    // first_row, delimiters included; false if the rows are out of range
+    bool rowRange(uint64_t first_row, uint64_t count, uint64_t& begin, uint64_t& end) const;
+
+private:
+    // Stat the CSV; the index is stale once its size or mtime changes
+    bool statSource(uint64_t& size, int64_t& mtime_sec, int64_t& mtime_nsec) const;
+    bool write() const;
+    void clear();
+    // Offset of a record, for row <= num_rows_ (num_rows_ gives the data end)
+    uint64_t offsetOf(uint64_t row) const;
+
+    std::string csv_filename_;
+    std::string index_path_;
+    uint64_t source_size_ = 0;
+    int64_t source_mtime_sec_ = 0;
+    int64_t source_mtime_nsec_ = 0;
+    uint64_t num_rows_ = 0;
+    uint64_t data_begin_ = 0;                   // Offset of the first data record
+    uint64_t data_end_ = 0;                     // Offset just after the last record
+    std::vector<uint64_t> checkpoint_offsets_;  // Offset of every CHECKPOINT_ROWS-th record
+    std::vector<uint64_t> checkpoint_positions_; // Position of its delta in deltas_
+    std::vector<uint8_t> deltas_;               // Varint record lengths
+};
+
+#endif // ROWOFFSETINDEX_H
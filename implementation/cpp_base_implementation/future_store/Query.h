@@ -3,6 +3,7 @@
 
 #include "Select.h"
 #include "CSVLoader.h"
+#include "NumericParse.h"
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -16,6 +17,15 @@ class QueryExecutor {
 public:
     QueryExecutor(const CSVLoader& loader) : loader_(loader) {}
 
+    // Numeric value of a cell; arithmetic and aggregates fail on any other text
+    static double numericCell(const std::string& col, const std::string& text) {
+        double value;
+        if (parseDouble(text, value) != ParseStatus::OK) {
+            throw std::runtime_error("Non-numeric value in column " + col + ": " + text);
+        }
+        return value;
+    }
+
     // Evaluate Operand
     double evaluateOperand(const std::shared_ptr<Operand>& operand, const std::unordered_map<std::string, std::string>& row) const {
         if (std::holds_alternative<std::string>(operand->value)) {
@@ -23,7 +33,7 @@ public:
             const std::string& col = std::get<std::string>(operand->value);
             auto it = row.find(col);
             if (it != row.end()) {
-                return std::stod(it->second);
+                return numericCell(col, it->second);
             } else {
                 throw std::runtime_error("Column not found: " + col);
             }
@@ -60,7 +70,7 @@ public:
             const std::string& col = pair.second;
             auto it = row.find(col);
             if (it != row.end()) {
-                return std::stod(it->second);
+                return numericCell(col, it->second);
             } else {
                 throw std::runtime_error("Column not found: " + col);
             }
@@ -181,7 +191,7 @@ public:
                     case GroupOperator::MAX: {
                         double max_val = -std::numeric_limits<double>::infinity();
                         for (const auto& row : rows) {
-                            double val = std::stod(row.at(col));
+                            double val = numericCell(col, row.at(col));
                             if (val > max_val) max_val = val;
                         }
                         aggregation_result = max_val;
@@ -190,7 +200,7 @@ public:
                     case GroupOperator::MIN: {
                         double min_val = std::numeric_limits<double>::infinity();
                         for (const auto& row : rows) {
-                            double val = std::stod(row.at(col));
+                            double val = numericCell(col, row.at(col));
                             if (val < min_val) min_val = val;
                         }
                         aggregation_result = min_val;
@@ -199,7 +209,7 @@ public:
                     case GroupOperator::AVG: {
                         double sum = 0.0;
                         for (const auto& row : rows) {
-                            sum += std::stod(row.at(col));
+                            sum += numericCell(col, row.at(col));
                         }
                         aggregation_result = sum / rows.size();
                         break;
@@ -13,20 +13,45 @@ using namespace std;
 int main(int argc, char* argv[]) {
     // Check if the CSV filename is provided as a command-line argument
     if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " <csv_filename>" << endl;
+        cerr << "Usage: " << argv[0] << " <csv_file|directory|'glob'> [--mmap] [--threads N] [--batch N] [--cache] [--memory-budget BYTES] [--profile]" << endl;
+        cerr << "Reads .csv.gz input; .csv.zst input needs a build with -DCSV_ZSTD -lzstd" << endl;
         return 1;
     }
 
     // Get the CSV file name from the first command-line argument
     string filename = argv[1];
 
-    // Create an instance of CSVLoader with the provided filename
-    CSVLoader loader(filename);
-
-    // Load the CSV data
-    if (!loader.load()) {
-        cerr << "Error: Failed to load the CSV file." << endl;
-        return 1;
+    // Optional loader flags
+    CSVLoadOptions options;
+    size_t batch_rows = 0;
+    bool profile = false;
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--mmap") {
+            options.mode = LoadMode::MMAP;
+        }
+        else if (arg == "--threads" && i + 1 < argc) {
+            options.num_threads = std::stoul(argv[++i]);
+        }
+        else if (arg == "--cache") {
+            options.use_cache = true;
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            // Spill cold columns to a temporary file past this many bytes
+            options.memory_budget = std::stoull(argv[++i]);
+        }
+        else if (arg == "--batch" && i + 1 < argc) {
+            // Stream the file in batches instead of loading it whole
+            batch_rows = std::stoul(argv[++i]);
+        }
+        else if (arg == "--profile") {
+            // Report the instructions the query executed
+            profile = true;
+        }
+        else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
     }
 
     // Define operands to select: 'name', 'salary', and an expression 'salary + 5000'
@@ -84,11 +109,41 @@ int main(int argc, char* argv[]) {
     // shared_ptr<ElementFilter> limitFilter = make_shared<LimitFilter>(2);
     // select.addFilter(limitFilter);
 
+    // Fold constants and leave each WHERE column alone on one side, so the
+    // conjuncts below can be pushed down
+    select.optimize();
+
+    // Only parse the columns the query reads, and only keep rows that can
+    // pass its WHERE conjuncts
+    options.columns = select.getRequiredColumns();
+    options.predicates = select.getScanPredicates();
+
+    // Create an instance of CSVLoader with the provided filename
+    CSVLoader loader(filename, options);
+
     // Create QueryExecutor
     QueryExecutor executor(loader);
 
+    if (batch_rows > 0) {
+        // Execute the query batch by batch
+        executor.executeBatches(select, batch_rows);
+        if (profile) {
+            executor.getProfile().print(cerr);
+        }
+        return 0;
+    }
+
+    // Load the CSV data
+    if (!loader.load()) {
+        cerr << "Error: Failed to load the CSV file." << endl;
+        return 1;
+    }
+
     // Execute the query
     executor.execute(select);
+    if (profile) {
+        executor.getProfile().print(cerr);
+    }
 
     return 0;
 }
@@ -0,0 +1,72 @@
+// BatchTest.cpp
+// Streaming batches give the rows, errors and DISTINCT values of a full load
+#include "TestSupport.h"
+
+// age is sampled as INT64 from the first two records and widens to DOUBLE on
+// row 5; tag is numeric overall, with a text cell in a later batch
+static const char* VISITS =
+    "id,age,tag,city\n"
+    "1,30,1,Oslo\n"
+    "2,25,2,Rome\n"
+    "3,30,x,Oslo\n"
+    "4,41,3,Lima\n"
+    "5,30.5,4,Rome\n"
+    "6,30,5,Oslo\n"
+    "7,25,6\n";
+
+static ElementSelect distinctAges(const std::string& table) {
+    std::vector<std::shared_ptr<Operand>> operands = { std::make_shared<ColumnOperand>("age") };
+    ElementSelect select(operands, table);
+    select.addFilter(std::make_shared<DistinctFilter>(operands));
+    return select;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/visits.csv";
+    writeFile(csv, VISITS);
+
+    const std::vector<std::string> all = { "id", "age", "tag", "city" };
+    std::vector<QueryBuilder> queries = {
+        selectWhere(all, {}),
+        distinctAges,
+        selectWhere(all, { where("age", Comparator::GREATER_EQUAL, 30) }),
+        selectWhere(all, { where("tag", Comparator::LESS, 4) }),
+        // Text against a numeric column is an error in every batch
+        selectWhere(all, { where("tag", Comparator::EQUAL, std::string("x")) }),
+        selectWhere({ "city" }, { where("city", Comparator::EQUAL, std::string("Oslo")) }),
+    };
+    std::vector<CSVLoadOptions> modes(3);
+    modes[1].schema_sample_rows = 2;
+    modes[2].infer_schema = false;
+    for (const auto& mode : modes) {
+        for (const auto& query : queries) {
+            QueryRun full;
+            full.options = mode;
+            std::string expected = runQuery(csv, query, full);
+            for (size_t batch_rows : { 1, 2, 3 }) {
+                QueryRun batched = full;
+                batched.batch_rows = batch_rows;
+                CHECK_EQ(runQuery(csv, query, batched), expected);
+                batched.pushdown = true;
+                CHECK_EQ(runQuery(csv, query, batched), expected);
+            }
+        }
+    }
+
+    // Every batch has the sampled types, and the stats count the records read
+    CSVLoadOptions sampled;
+    sampled.schema_sample_rows = 2;
+    CSVLoader loader(csv, sampled);
+    CHECK(loader.openBatches(2));
+    size_t batches = 0;
+    while (loader.nextBatch()) {
+        const ColumnTable& table = loader.getTable();
+        CHECK(table.getColumn(table.findColumn("tag")).getType() == ColumnType::INT64);
+        CHECK(table.getColumn(table.findColumn("city")).getType() == ColumnType::STRING);
+        batches++;
+        CHECK_EQ(loader.getStats().records, uint64_t(std::min<size_t>(2 * batches, 7)));
+    }
+    CHECK_EQ(batches, size_t(4));
+    return testResult();
+}
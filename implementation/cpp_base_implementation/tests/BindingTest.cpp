@@ -0,0 +1,163 @@
+// BindingTest.cpp
+// Operands and filters bound to column ordinals evaluate every row as they
+// do looking their columns up by name, in tables of any column layout, and
+// unknown columns are reported once, before any row
+#include "TestSupport.h"
+
+// int, double, text and bool columns with NULLs, stray text and short rows
+static std::string makeCSV(size_t records) {
+    std::string text = "id,amount,price,name,flag\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + "," + (r % 13 == 0 ? "" : r == 700 ? "n/a" : std::to_string(static_cast<int>(r % 40) - 20));
+        if (r % 31 == 0) {
+            text += "\n";
+            continue;
+        }
+        text += "," + std::to_string(r % 9) + ".5,name" + std::to_string(r % 6) + "," + (r % 3 ? "true" : "false") +
+                "\n";
+    }
+    return text;
+}
+
+// A value, NULL or error as the test compares them
+static std::string describe(const OperandValue& value) {
+    if (isNull(value)) {
+        return "NULL";
+    }
+    if (std::holds_alternative<int>(value)) {
+        return "int " + std::to_string(std::get<int>(value));
+    }
+    if (std::holds_alternative<double>(value)) {
+        std::ostringstream out;
+        out.precision(17);
+        out << "double " << std::get<double>(value);
+        return out.str();
+    }
+    if (std::holds_alternative<bool>(value)) {
+        return std::get<bool>(value) ? "true" : "false";
+    }
+    return "string " + std::get<std::string>(value);
+}
+
+static std::string evaluateRows(const Operand& operand, const ColumnTable& table) {
+    std::string result;
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        try {
+            result += describe(operand.evaluate(table, row)) + "\n";
+        }
+        catch (const std::exception& e) {
+            result += std::string("error ") + e.what() + "\n";
+        }
+    }
+    return result;
+}
+
+static std::string applyRows(const ElementFilter& filter, const ColumnTable& table) {
+    std::string result;
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        try {
+            result += filter.apply(table, row) ? "pass\n" : "fail\n";
+        }
+        catch (const std::exception& e) {
+            result += std::string("error ") + e.what() + "\n";
+        }
+    }
+    return result;
+}
+
+using OperandBuilder = std::function<std::shared_ptr<Operand>()>;
+
+static std::shared_ptr<Operand> column(const std::string& name) {
+    return std::make_shared<ColumnOperand>(name);
+}
+
+static std::shared_ptr<Operand> expression(std::shared_ptr<Operand> left, OperatorType op,
+                                           std::shared_ptr<Operand> right) {
+    return std::make_shared<ExpressionOperand>(left, op, right);
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/orders.csv";
+    writeFile(csv, makeCSV(3000));
+
+    // The full table, and one holding some of its columns at other ordinals
+    CSVLoader full_loader(csv);
+    CHECK(full_loader.load());
+    CSVLoadOptions projected_options;
+    projected_options.columns = { "name", "amount", "flag" };
+    CSVLoader projected_loader(csv, projected_options);
+    CHECK(projected_loader.load());
+    const ColumnTable& full = full_loader.getTable();
+    const ColumnTable& projected = projected_loader.getTable();
+    CHECK(projected.findColumn("amount") != full.findColumn("amount"));
+    CHECK(projected.findColumn("flag") != full.findColumn("flag"));
+
+    const std::vector<OperandBuilder> operands = {
+        [] { return column("amount"); },
+        [] { return column("name"); },
+        [] { return column("flag"); },
+        [] { return expression(column("amount"), OperatorType::MULTIPLY, std::make_shared<IntegerOperand>(3)); },
+        [] { return expression(column("amount"), OperatorType::DIVIDE, column("amount")); },
+        [] { return expression(column("amount"), OperatorType::ADD, column("name")); },
+        [] {
+            return expression(expression(column("amount"), OperatorType::SUBTRACT, std::make_shared<DoubleOperand>(0.5)),
+                              OperatorType::MULTIPLY, column("amount"));
+        },
+    };
+    for (const auto& build : operands) {
+        // Looked up by name on every row
+        std::shared_ptr<Operand> unbound = build();
+        std::string expected = evaluateRows(*unbound, full);
+        std::shared_ptr<Operand> bound = build();
+        bound->bind(full);
+        CHECK_EQ(evaluateRows(*bound, full), expected);
+        // The same rows in another layout, while bound to the first table and once rebound
+        std::string expected_projected = evaluateRows(*unbound, projected);
+        CHECK_EQ(expected_projected, expected);
+        CHECK_EQ(evaluateRows(*bound, projected), expected_projected);
+        bound->bind(projected);
+        CHECK_EQ(evaluateRows(*bound, projected), expected_projected);
+        CHECK_EQ(evaluateRows(*bound, full), expected);
+    }
+
+    const std::vector<FilterBuilder> filters = {
+        where("amount", Comparator::GREATER, 5),
+        where("amount", Comparator::EQUAL, std::string("n/a")),
+        where("name", Comparator::EQUAL, std::string("name3")),
+        where("name", Comparator::IN, std::string("name1,name4")),
+        where("flag", Comparator::NOT_EQUAL, true),
+        [] { return std::make_shared<WhereFilter>(column("amount"), Comparator::LESS, column("amount")); },
+        [] {
+            auto both = std::make_shared<CompositeElementFilter>();
+            both->addFilter(where("flag", Comparator::EQUAL, true)());
+            both->addFilter(where("amount", Comparator::LESS_EQUAL, -3)());
+            return both;
+        },
+        [] { return std::make_shared<DistinctFilter>(std::vector<std::shared_ptr<Operand>>{ column("name"), column("flag") }); },
+    };
+    for (const auto& build : filters) {
+        std::string expected = applyRows(*build(), full);
+        std::shared_ptr<ElementFilter> bound = build();
+        bound->bind(full);
+        CHECK_EQ(applyRows(*bound, full), expected);
+        std::string expected_projected = applyRows(*build(), projected);
+        CHECK_EQ(expected_projected, expected);
+        bound = build();
+        bound->bind(full);
+        CHECK_EQ(applyRows(*bound, projected), expected_projected);
+        bound = build();
+        bound->bind(projected);
+        CHECK_EQ(applyRows(*bound, projected), expected_projected);
+    }
+
+    // An unknown column stops the query before any row is evaluated
+    const char* unknown = "--\nError: Column 'missing' does not exist in CSV.\n";
+    CHECK_EQ(runQuery(csv, selectWhere({ "id", "missing" }, {})), std::string(unknown));
+    CHECK_EQ(runQuery(csv, selectWhere({ "id" }, { where("missing", Comparator::EQUAL, 1) })), std::string(unknown));
+    QueryRun batched;
+    batched.batch_rows = 500;
+    CHECK_EQ(runQuery(csv, selectWhere({ "missing" }, {}), batched), std::string(unknown));
+    return testResult();
+}
@@ -0,0 +1,73 @@
+// CacheTest.cpp
+// A table read from the sidecar cache matches a parse of the CSV, and any
+// change to the CSV makes the cache stale
+#include "TestSupport.h"
+#include <fcntl.h>
+
+static const char* SAMPLE =
+    "id,name,age,salary\n"
+    "1,Alice,30,70000\n"
+    "2,Bob,25,50000.5\n"
+    "3,Charlie,35,80000\n"
+    "4,Diana,x,60000\n"
+    "5,Eve,,6.0e4\n";
+
+// Load with the cache and report whether it was hit
+static bool loadCached(const std::string& csv) {
+    CSVLoadOptions options;
+    options.use_cache = true;
+    CSVLoader loader(csv, options);
+    CHECK(loader.load());
+    return loader.getStats().cache_hit;
+}
+
+// The cached and the parsed table answer the query alike, and give the same
+// compatibility view
+static void checkQuery(const std::string& csv) {
+    CSVLoadOptions options;
+    options.use_cache = true;
+    CSVLoader cached_loader(csv, options);
+    CSVLoader parsed_loader(csv);
+    CHECK(cached_loader.load() && parsed_loader.load());
+    CHECK(cached_loader.getData() == parsed_loader.getData());
+
+    QueryBuilder query = selectWhere({ "name", "age", "salary" }, { where("age", Comparator::GREATER, 26) });
+    QueryRun cached;
+    cached.options.use_cache = true;
+    CHECK_EQ(runQuery(csv, query, cached), runQuery(csv, query));
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/sample.csv";
+    writeFile(csv, SAMPLE);
+
+    CHECK(!loadCached(csv));
+    CHECK(loadCached(csv));
+    checkQuery(csv);
+
+    // A different size
+    writeFile(csv, std::string(SAMPLE) + "6,Frank,41,65000\n");
+    CHECK(!loadCached(csv));
+    CHECK(loadCached(csv));
+    checkQuery(csv);
+
+    // Same size and mtime, other contents: only the hash tells them apart
+    struct stat st;
+    CHECK(stat(csv.c_str(), &st) == 0);
+    std::string rewritten = std::string(SAMPLE) + "6,Frank,14,65000\n";
+    writeFile(csv, rewritten);
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    CHECK(utimensat(AT_FDCWD, csv.c_str(), times, 0) == 0);
+    CHECK(!loadCached(csv));
+    CHECK(loadCached(csv));
+    checkQuery(csv);
+
+    // Touched but unchanged: stale by mtime, then cached again
+    times[1].tv_sec -= 10;
+    CHECK(utimensat(AT_FDCWD, csv.c_str(), times, 0) == 0);
+    CHECK(!loadCached(csv));
+    CHECK(loadCached(csv));
+    checkQuery(csv);
+    return testResult();
+}
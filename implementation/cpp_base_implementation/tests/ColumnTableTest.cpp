@@ -0,0 +1,83 @@
+// ColumnTableTest.cpp
+// The columnar table against the map-based compatibility view it replaced
+#include "TestSupport.h"
+
+static const char* SAMPLE =
+    "id,name,age,salary\n"
+    "1,Alice,30,70000\n"
+    "2,Bob,25,50000\n"
+    "3,Charlie,35,80000\n"
+    "4,Diana,28,60000\n"
+    "5,Eve,41\n";
+
+static ElementSelect sampleQuery(const std::string& table) {
+    std::vector<std::shared_ptr<Operand>> operands = {
+        std::make_shared<ColumnOperand>("name"),
+        std::make_shared<ColumnOperand>("salary"),
+    };
+    ElementSelect select(operands, table);
+    select.addFilter(std::make_shared<WhereFilter>(std::make_shared<ColumnOperand>("age"), Comparator::GREATER,
+                                                   std::make_shared<IntegerOperand>(27)));
+    return select;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/sample.csv";
+    writeFile(csv, SAMPLE);
+
+    CSVLoader loader(csv);
+    CHECK(loader.load());
+    const ColumnTable& table = loader.getTable();
+    CHECK_EQ(table.numRows(), size_t(5));
+    CHECK_EQ(table.numColumns(), size_t(4));
+    CHECK(table.getColumn(table.findColumn("age")).getType() == ColumnType::INT64);
+    CHECK(table.getColumn(table.findColumn("name")).getType() == ColumnType::STRING);
+    // The short row's salary is NULL, and absent from its row map
+    const Column& salary = table.getColumn(table.findColumn("salary"));
+    CHECK(salary.isMissing(4));
+    CHECK_EQ(salary.nullCount(), size_t(1));
+
+    const auto& rows = loader.getData();
+    CHECK_EQ(rows.size(), size_t(5));
+    CHECK_EQ(rows[2].at("name"), std::string("Charlie"));
+    CHECK_EQ(rows[2].at("salary"), std::string("80000"));
+    CHECK(rows[4].count("salary") == 0);
+
+    // Every filter and operand gives the same answer on a row map and on the table
+    ElementSelect select = sampleQuery(csv);
+    select.bind(table);
+    std::shared_ptr<Operand> sum = std::make_shared<ExpressionOperand>(
+        std::make_shared<ColumnOperand>("age"), OperatorType::ADD, std::make_shared<ColumnOperand>("salary"));
+    sum->bind(table);
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        CHECK_EQ(select.getFilter()->apply(rows[row]), select.getFilter()->apply(table, row));
+        OperandValue from_map = sum->evaluate(rows[row]);
+        OperandValue from_table = sum->evaluate(table, row);
+        CHECK(from_map == from_table);
+    }
+
+    // Typed cells read back as the file wrote them
+    std::string typed = dir + "/typed.csv";
+    writeFile(typed, "id,price,flag\n007,1.50,TRUE\n2,,false\n3,1e3,true\n4,2,false\n");
+    CSVLoader typed_loader(typed);
+    CHECK(typed_loader.load());
+    const ColumnTable& typed_table = typed_loader.getTable();
+    CHECK(typed_table.getColumn(typed_table.findColumn("id")).getType() == ColumnType::INT64);
+    CHECK(typed_table.getColumn(typed_table.findColumn("price")).getType() == ColumnType::DOUBLE);
+    CHECK(typed_table.getColumn(typed_table.findColumn("flag")).getType() == ColumnType::BOOL);
+    const auto& typed_rows = typed_loader.getData();
+    CHECK_EQ(typed_rows[0].at("id"), std::string("007"));
+    CHECK_EQ(typed_rows[0].at("price"), std::string("1.50"));
+    CHECK_EQ(typed_rows[0].at("flag"), std::string("TRUE"));
+    // An empty cell is NULL, but still in the view
+    CHECK_EQ(typed_rows[1].at("price"), std::string(""));
+    CHECK_EQ(typed_rows[2].at("price"), std::string("1e3"));
+    CHECK_EQ(typed_rows[2].at("flag"), std::string("true"));
+    CHECK(typed_table.getColumn(typed_table.findColumn("price")).isMissing(1));
+
+    CHECK_EQ(runQuery(csv, sampleQuery),
+             std::string("name\tsalary\t\n----\t----\t\n"
+                         "Alice\t70000\t\nCharlie\t80000\t\nDiana\t60000\t\nEve\tNULL\t\n--\n"));
+    return testResult();
+}
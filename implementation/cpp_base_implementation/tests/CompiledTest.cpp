@@ -0,0 +1,209 @@
+// CompiledTest.cpp
+// Typed kernels for arithmetic and comparisons give the value, NULL or error
+// of evaluating each row on its own
+#include "TestSupport.h"
+#include "../CompiledExpression.h"
+#include <random>
+
+// int and double columns with NULLs, values past int range and zeros, and a
+// text and a bool column
+static std::string makeCSV(size_t records) {
+    std::string text = "i,d,z,s,b\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string i = r % 17 == 0 ? "" : std::to_string(static_cast<int>(r % 50) - 25);
+        if (r == 700) {
+            i = "3000000000";
+        }
+        else if (r == 1500) {
+            i = "-3000000000";
+        }
+        std::string d = r % 19 == 0 ? "" : std::to_string((static_cast<int>(r % 13) - 4) * 0.5);
+        text += i + "," + d + "," + std::to_string(r % 3) + ",name" + std::to_string(r % 7) + "," +
+                (r % 23 == 0 ? "" : r % 2 ? "true" : "false") + "\n";
+    }
+    return text;
+}
+
+// A value, NULL or error as the test compares them
+static std::string describe(const OperandValue& value) {
+    if (isNull(value)) {
+        return "NULL";
+    }
+    if (std::holds_alternative<int>(value)) {
+        return "int " + std::to_string(std::get<int>(value));
+    }
+    if (std::holds_alternative<double>(value)) {
+        std::ostringstream out;
+        out.precision(17);
+        out << "double " << std::get<double>(value);
+        return out.str();
+    }
+    if (std::holds_alternative<bool>(value)) {
+        return std::get<bool>(value) ? "true" : "false";
+    }
+    return "string " + std::get<std::string>(value);
+}
+
+static std::string evaluateRow(const Operand& operand, const ColumnTable& table, size_t row) {
+    try {
+        return describe(operand.evaluate(table, row));
+    }
+    catch (const std::exception& e) {
+        return std::string("error ") + e.what();
+    }
+}
+
+static std::string applyRow(const ElementFilter& filter, const ColumnTable& table, size_t row) {
+    try {
+        return filter.apply(table, row) ? "pass" : "fail";
+    }
+    catch (const std::exception& e) {
+        return std::string("error ") + e.what();
+    }
+}
+
+// Whole batches, and every third row of them from the second on
+static std::vector<SelectionVector> selections(const ColumnTable& table) {
+    std::vector<SelectionVector> result;
+    for (size_t begin = 0; begin < table.numRows(); begin += BATCH_ROWS) {
+        SelectionVector all;
+        all.selectAll(begin, std::min(BATCH_ROWS, table.numRows() - begin));
+        SelectionVector sparse = all;
+        sparse.offsets.clear();
+        for (size_t i = 1; i < all.size(); i += 3) {
+            sparse.offsets.push_back(all.offsets[i]);
+        }
+        result.push_back(all);
+        result.push_back(sparse);
+    }
+    return result;
+}
+
+// Whether a comparison side compiles: a numeric column or constant, or any
+// expression (whose non-numeric rows fail one by one)
+static bool isNumeric(const std::shared_ptr<Operand>& operand, const ColumnTable& table) {
+    if (std::dynamic_pointer_cast<ExpressionOperand>(operand)) {
+        return true;
+    }
+    if (auto column = std::dynamic_pointer_cast<ColumnOperand>(operand)) {
+        ColumnType type = table.getColumn(table.findColumn(column->getColumn())).getType();
+        return type == ColumnType::INT64 || type == ColumnType::DOUBLE;
+    }
+    return std::dynamic_pointer_cast<IntegerOperand>(operand) || std::dynamic_pointer_cast<DoubleOperand>(operand);
+}
+
+static void checkExpression(const std::shared_ptr<ExpressionOperand>& expression, const ColumnTable& table) {
+    expression->bind(table);
+    std::unique_ptr<CompiledExpression> compiled = CompiledExpression::compile(*expression, table);
+    CHECK(compiled != nullptr);
+    if (!compiled) {
+        return;
+    }
+    for (const auto& selection : selections(table)) {
+        ValueVector out;
+        compiled->evaluateBatch(table, selection, out);
+        CHECK_EQ(out.size, selection.size());
+        for (size_t i = 0; i < selection.size(); ++i) {
+            const std::string* error = out.errorAt(i);
+            std::string actual = error ? "error " + *error : describe(out.get(i));
+            CHECK_EQ(actual, evaluateRow(*expression, table, selection.row(i)));
+        }
+    }
+}
+
+static void checkComparison(const std::shared_ptr<Operand>& left, Comparator comparator,
+                            const std::shared_ptr<Operand>& right, const ColumnTable& table) {
+    WhereFilter filter(left, comparator, right);
+    filter.bind(table);
+    std::unique_ptr<CompiledComparison> compiled = CompiledComparison::compile(*left, comparator, *right, table);
+    CHECK_EQ(compiled != nullptr, isNumeric(left, table) && isNumeric(right, table));
+    if (!compiled) {
+        return;
+    }
+    for (auto selection : selections(table)) {
+        std::string expected, actual;
+        for (size_t i = 0; i < selection.size(); ++i) {
+            std::string outcome = applyRow(filter, table, selection.row(i));
+            if (outcome != "fail") {
+                expected += std::to_string(selection.row(i)) + " " + outcome + "\n";
+            }
+        }
+        std::vector<RowError> errors;
+        compiled->filter(table, selection, errors);
+        // Passing rows and errors, in row order
+        size_t next_error = 0;
+        for (size_t i = 0; i <= selection.size(); ++i) {
+            size_t row = i < selection.size() ? selection.row(i) : table.numRows();
+            for (; next_error < errors.size() && errors[next_error].row < row; ++next_error) {
+                actual += std::to_string(errors[next_error].row) + " error " + errors[next_error].message + "\n";
+            }
+            if (i < selection.size()) {
+                actual += std::to_string(row) + " pass\n";
+            }
+        }
+        CHECK_EQ(actual, expected);
+    }
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/values.csv";
+    writeFile(csv, makeCSV(3000));
+    CSVLoader loader(csv);
+    CHECK(loader.load());
+    const ColumnTable& table = loader.getTable();
+    CHECK(table.getColumn(table.findColumn("i")).getType() == ColumnType::INT64);
+    CHECK(table.getColumn(table.findColumn("d")).getType() == ColumnType::DOUBLE);
+
+    std::vector<std::shared_ptr<Operand>> leaves = {
+        std::make_shared<ColumnOperand>("i"),
+        std::make_shared<ColumnOperand>("d"),
+        std::make_shared<ColumnOperand>("z"),
+        std::make_shared<ColumnOperand>("s"),
+        std::make_shared<ColumnOperand>("b"),
+        std::make_shared<IntegerOperand>(3),
+        std::make_shared<IntegerOperand>(0),
+        std::make_shared<IntegerOperand>(-2147483647 - 1),
+        std::make_shared<DoubleOperand>(1.5),
+        std::make_shared<DoubleOperand>(0.0),
+        std::make_shared<StringOperand>("7"),
+    };
+    const OperatorType operators[] = { OperatorType::ADD, OperatorType::SUBTRACT, OperatorType::MULTIPLY,
+                                       OperatorType::DIVIDE };
+    const Comparator comparators[] = { Comparator::EQUAL, Comparator::NOT_EQUAL, Comparator::GREATER,
+                                       Comparator::LESS, Comparator::GREATER_EQUAL, Comparator::LESS_EQUAL };
+
+    // Every pair of leaves under every operator, then random nestings of them
+    std::vector<std::shared_ptr<Operand>> expressions;
+    for (OperatorType op : operators) {
+        for (const auto& left : leaves) {
+            for (const auto& right : leaves) {
+                expressions.push_back(std::make_shared<ExpressionOperand>(left, op, right));
+            }
+        }
+    }
+    std::mt19937 random(2520);
+    for (size_t n = 0; n < 200; ++n) {
+        const auto& left = expressions[random() % expressions.size()];
+        const auto& right = random() % 2 ? leaves[random() % leaves.size()] : expressions[random() % expressions.size()];
+        OperatorType op = operators[random() % 4];
+        expressions.push_back(random() % 2 ? std::make_shared<ExpressionOperand>(left, op, right)
+                                           : std::make_shared<ExpressionOperand>(right, op, left));
+    }
+    for (const auto& expression : expressions) {
+        checkExpression(std::static_pointer_cast<ExpressionOperand>(expression), table);
+    }
+
+    std::vector<std::shared_ptr<Operand>> sides = leaves;
+    for (size_t n = 0; n < 30; ++n) {
+        sides.push_back(expressions[random() % expressions.size()]);
+    }
+    for (Comparator comparator : comparators) {
+        for (const auto& left : sides) {
+            for (const auto& right : sides) {
+                checkComparison(left, comparator, right, table);
+            }
+        }
+    }
+    return testResult();
+}
@@ -0,0 +1,200 @@
+// CompressedTest.cpp
+// Gzip input, in one member, in several, or as BGZF blocks decompressed in
+// parallel, loads as the plain CSV does; so does zstd input in one frame or
+// several when built with -DCSV_ZSTD
+#include "TestSupport.h"
+#include "../CompressedReader.h"
+#include <zlib.h>
+
+static std::string makeCSV(size_t records) {
+    std::string text = "id,name,amount,flag\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + (r % 9 == 0 ? ",\"quoted, with\nbreak\"," : ",name" + id + ",");
+        text += (r % 4 == 0 ? std::to_string(r) + ".5" : std::to_string(r * 7)) + (r % 2 ? ",true\n" : ",false\r\n");
+    }
+    return text;
+}
+
+// One deflate stream: raw (window_bits -15) or with a gzip wrapper (31)
+static std::string deflateText(const std::string& text, int window_bits) {
+    z_stream stream = z_stream();
+    deflateInit2(&stream, 6, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
+    std::string out(deflateBound(&stream, text.size()) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+    stream.avail_in = static_cast<uInt>(text.size());
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>(out.size());
+    deflate(&stream, Z_FINISH);
+    out.resize(stream.total_out);
+    deflateEnd(&stream);
+    return out;
+}
+
+static void putLE(std::string& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+// Gzip members of at most piece bytes of text each
+static std::string gzipMembers(const std::string& text, size_t piece) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i += piece) {
+        out += deflateText(text.substr(i, piece), 31);
+    }
+    return out;
+}
+
+// BGZF: gzip members whose "BC" extra field holds the member size, ending
+// with an empty member
+static std::string bgzf(const std::string& text) {
+    const size_t piece = 0xff00;
+    std::string out;
+    for (size_t i = 0; i <= text.size(); i += piece) {
+        std::string chunk = i < text.size() ? text.substr(i, piece) : std::string();
+        std::string data = deflateText(chunk, -15);
+        out += std::string("\x1f\x8b\x08\x04\0\0\0\0\0\xff", 10);
+        putLE(out, 6, 2);
+        out += "BC";
+        putLE(out, 2, 2);
+        putLE(out, static_cast<uint32_t>(18 + data.size() + 8 - 1), 2);
+        out += data;
+        putLE(out, static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(chunk.data()), chunk.size())), 4);
+        putLE(out, static_cast<uint32_t>(chunk.size()), 4);
+        if (i == text.size()) {
+            break;
+        }
+    }
+    return out;
+}
+
+#ifdef CSV_ZSTD
+// zstd frames of at most piece bytes of text each, recording their sizes
+static std::string zstdFrames(const std::string& text, size_t piece) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i += piece) {
+        std::string chunk = text.substr(i, piece);
+        std::string frame(ZSTD_compressBound(chunk.size()), '\0');
+        frame.resize(ZSTD_compress(&frame[0], frame.size(), chunk.data(), chunk.size(), 3));
+        out += frame;
+    }
+    return out;
+}
+
+// One frame written by the streaming API, which leaves its size unknown
+static std::string zstdStreamed(const std::string& text) {
+    ZSTD_CStream* stream = ZSTD_createCStream();
+    ZSTD_initCStream(stream, 3);
+    std::string out(ZSTD_compressBound(text.size()) + 64, '\0');
+    ZSTD_inBuffer in = { text.data(), text.size(), 0 };
+    ZSTD_outBuffer buffer = { &out[0], out.size(), 0 };
+    ZSTD_compressStream(stream, &buffer, &in);
+    ZSTD_endStream(stream, &buffer);
+    ZSTD_freeCStream(stream);
+    out.resize(buffer.pos);
+    return out;
+}
+#endif
+
+// Every byte the reader hands out
+static std::string readAll(const std::string& path, size_t threads, bool& parallel) {
+    CompressedReader reader(1 << 16, threads);
+    CHECK(reader.open(path));
+    parallel = reader.isParallel();
+    std::vector<char> block(reader.blockSize());
+    std::string text;
+    while (size_t got = reader.read(block.data())) {
+        text.append(block.data(), got);
+    }
+    CHECK(!reader.failed());
+    return text;
+}
+
+static std::string loadAll(const std::string& path, const CSVLoadOptions& options, size_t batch_rows = 0) {
+    CSVLoader loader(path, options);
+    if (batch_rows == 0) {
+        CHECK(loader.load());
+        CHECK(loader.getStats().compressed == (detectCompression(path) != Compression::NONE));
+        return dumpRows(loader.getTable());
+    }
+    std::string rows;
+    CHECK(loader.openBatches(batch_rows));
+    bool first = true;
+    while (loader.nextBatch()) {
+        rows += dumpRows(loader.getTable(), first);
+        first = false;
+    }
+    return rows;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string text = makeCSV(50000);
+    std::string csv = dir + "/plain.csv";
+    writeFile(csv, text);
+    std::string expected = loadAll(csv, CSVLoadOptions());
+
+    struct Variant {
+        const char* name;
+        std::string data;
+        Compression format;
+        bool parallel;
+    };
+    std::vector<Variant> variants = {
+        { "single.csv.gz", gzipMembers(text, text.size()), Compression::GZIP, false },
+        { "members.csv.gz", gzipMembers(text, 100000), Compression::GZIP, false },
+        { "bgzf.csv.gz", bgzf(text), Compression::GZIP, true },
+#ifdef CSV_ZSTD
+        { "streamed.csv.zst", zstdStreamed(text), Compression::ZSTD, false },
+        { "single.csv.zst", zstdFrames(text, text.size()), Compression::ZSTD, false },
+        { "frames.csv.zst", zstdFrames(text, 100000), Compression::ZSTD, true },
+#endif
+    };
+    for (const auto& variant : variants) {
+        std::string path = dir + "/" + variant.name;
+        writeFile(path, variant.data);
+        CHECK(detectCompression(path) == variant.format);
+        for (size_t threads : { 1, 4 }) {
+            bool parallel;
+            CHECK(readAll(path, threads, parallel) == text);
+            CHECK_EQ(parallel, variant.parallel);
+
+            CSVLoadOptions options;
+            options.decompression_threads = threads;
+            CHECK_EQ(loadAll(path, options), expected);
+            // Compressed input is always streamed
+            options.mode = LoadMode::MMAP;
+            options.num_threads = 4;
+            CHECK_EQ(loadAll(path, options), expected);
+            CHECK_EQ(loadAll(path, options, 7000), expected);
+        }
+    }
+
+    // Compressed files cannot be seeked into
+    CSVLoader lookup(dir + "/bgzf.csv.gz");
+    CHECK(!lookup.loadRows({ 1 }));
+
+    // Corrupt input fails instead of loading part of the rows
+    std::string corrupt = bgzf(text);
+    corrupt[corrupt.size() / 2] ^= 0x55;
+    writeFile(dir + "/corrupt.csv.gz", corrupt);
+    // and reports the corruption, not an empty file
+    std::ostringstream errors;
+    std::streambuf* cerr_buf = std::cerr.rdbuf(errors.rdbuf());
+    CSVLoader broken(dir + "/corrupt.csv.gz");
+    CHECK(!broken.load());
+    CSVLoader broken_batches(dir + "/corrupt.csv.gz");
+    CHECK(!broken_batches.openBatches(100) || !broken_batches.nextBatch());
+#ifdef CSV_ZSTD
+    // A zstd file cut short inside its last frame
+    std::string cut = zstdFrames(text, 100000);
+    writeFile(dir + "/corrupt.csv.zst", cut.substr(0, cut.size() - 100));
+    CSVLoader broken_zstd(dir + "/corrupt.csv.zst");
+    CHECK(!broken_zstd.load());
+#endif
+    std::cerr.rdbuf(cerr_buf);
+    CHECK(errors.str().find("Corrupt compressed data") != std::string::npos);
+    CHECK(errors.str().find("Empty CSV file") == std::string::npos);
+    return testResult();
+}
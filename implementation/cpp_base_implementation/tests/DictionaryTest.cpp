@@ -0,0 +1,104 @@
+// DictionaryTest.cpp
+// Dictionary-encoded string columns hold, filter and DISTINCT the same
+// values as plain ones
+#include "TestSupport.h"
+
+// region and dept repeat a few values (region with empty cells), name is
+// distinct on every row, code mixes text with numeric-looking cells
+static std::string makeCSV(size_t records) {
+    static const char* regions[] = { "eu", "us", "apac", "", "latam" };
+    std::string text = "id,region,dept,name,code\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + "," + regions[r % 5] + ",dept" + std::to_string(r % 37) + ",\"name, " + id + "\"," +
+                (r % 9 == 0 ? std::to_string(r % 4) : "c" + std::to_string(r % 6));
+        text += r % 29 == 0 ? "\n" : ",x\n";
+    }
+    return text;
+}
+
+static ElementSelect distinct(const std::vector<std::string>& columns, const std::string& table) {
+    std::vector<std::shared_ptr<Operand>> operands;
+    for (const auto& column : columns) {
+        operands.push_back(std::make_shared<ColumnOperand>(column));
+    }
+    ElementSelect select(operands, table);
+    select.addFilter(std::make_shared<DistinctFilter>(operands));
+    return select;
+}
+
+// left <comparator> right for any two operands
+static FilterBuilder compare(std::shared_ptr<Operand> left, Comparator comparator, std::shared_ptr<Operand> right) {
+    return [=] { return std::make_shared<WhereFilter>(left, comparator, right); };
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/staff.csv";
+    writeFile(csv, makeCSV(8000));
+
+    CSVLoadOptions plain;
+    plain.dictionary_max_entries = 0;
+    CSVLoader encoded(csv);
+    CHECK(encoded.load());
+    CSVLoader unencoded(csv, plain);
+    CHECK(unencoded.load());
+    const ColumnTable& table = encoded.getTable();
+    CHECK(table.getColumn(table.findColumn("region")).isDictionaryEncoded());
+    CHECK(table.getColumn(table.findColumn("dept")).isDictionaryEncoded());
+    CHECK(table.getColumn(table.findColumn("code")).isDictionaryEncoded());
+    // Too many distinct values to pay off
+    CHECK(!table.getColumn(table.findColumn("name")).isDictionaryEncoded());
+    CHECK(!unencoded.getTable().getColumn(table.findColumn("region")).isDictionaryEncoded());
+    CHECK_EQ(dumpRows(table), dumpRows(unencoded.getTable()));
+    CHECK(encoded.getData() == unencoded.getData());
+
+    auto region = std::make_shared<ColumnOperand>("region");
+    auto dept = std::make_shared<ColumnOperand>("dept");
+    auto code = std::make_shared<ColumnOperand>("code");
+    const std::vector<std::string> all = { "id", "region", "dept", "name", "code" };
+    std::vector<QueryBuilder> queries = {
+        selectWhere(all, { where("region", Comparator::EQUAL, std::string("eu")) }),
+        selectWhere({ "id" }, { where("region", Comparator::NOT_EQUAL, std::string("us")) }),
+        selectWhere({ "id" }, { where("region", Comparator::IN, std::string("eu,latam")) }),
+        selectWhere({ "id", "region" }, { where("region", Comparator::GREATER, std::string("b")) }),
+        selectWhere({ "id" }, { where("region", Comparator::EQUAL, std::string("")) }),
+        // A value the dictionary does not hold
+        selectWhere({ "id" }, { where("dept", Comparator::EQUAL, std::string("dept99")) }),
+        selectWhere({ "id" }, { where("dept", Comparator::LESS_EQUAL, std::string("dept2")),
+                                where("region", Comparator::EQUAL, std::string("apac")) }),
+        // Text against a number, and numeric-looking text: errors on every row
+        selectWhere({ "id" }, { where("code", Comparator::EQUAL, 2) }),
+        selectWhere({ "id" }, { where("code", Comparator::EQUAL, std::string("2")) }),
+        selectWhere({ "id" }, { compare(std::make_shared<StringOperand>("us"), Comparator::EQUAL, region) }),
+        selectWhere({ "id" }, { compare(dept, Comparator::EQUAL, code) }),
+        selectWhere({ "id" }, { compare(region, Comparator::LESS, dept) }),
+        selectWhere({ "name" }, { where("name", Comparator::GREATER, std::string("name, 7990")) }),
+        [](const std::string& table) { return distinct({ "region" }, table); },
+        [](const std::string& table) { return distinct({ "region", "dept" }, table); },
+        [](const std::string& table) { return distinct({ "code", "name" }, table); },
+    };
+
+    std::vector<CSVLoadOptions> modes(4);
+    modes[1].mode = LoadMode::MMAP;
+    modes[2].num_threads = 4;
+    // Fewer entries than region has values
+    modes[3].dictionary_max_entries = 3;
+    for (const auto& mode : modes) {
+        for (const auto& query : queries) {
+            QueryRun reference;
+            reference.options = mode;
+            reference.options.dictionary_max_entries = 0;
+            std::string expected = runQuery(csv, query, reference);
+            QueryRun run;
+            run.options = mode;
+            CHECK_EQ(runQuery(csv, query, run), expected);
+            run.pushdown = true;
+            CHECK_EQ(runQuery(csv, query, run), expected);
+            // Each batch has dictionaries of its own
+            run.batch_rows = 700;
+            CHECK_EQ(runQuery(csv, query, run), expected);
+        }
+    }
+    return testResult();
+}
@@ -0,0 +1,220 @@
+// EvaluateBatchTest.cpp
+// Operands and filters evaluated a batch at a time give the value, NULL or
+// error, and keep the rows, that evaluating each row on its own does
+#include "TestSupport.h"
+
+// int (with values past int range and a stray), double, bool, plain and
+// dictionary-encoded text with NULLs, and short rows
+static std::string makeCSV(size_t records) {
+    std::string text = "i,d,b,s,tag\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string i = r % 17 == 0 ? "" : std::to_string(static_cast<int>(r % 50) - 25);
+        if (r == 900) {
+            i = "3000000000";
+        }
+        else if (r == 1800) {
+            i = "oops";
+        }
+        text += i + "," + (r % 19 == 0 ? "" : std::to_string((static_cast<int>(r % 13) - 4) * 0.5));
+        if (r % 41 == 0) {
+            text += "\n";
+            continue;
+        }
+        text += std::string(",") + (r % 23 == 0 ? "" : r % 2 ? "true" : "false") + ",text" + std::to_string(r) +
+                ",tag" + std::to_string(r % 5) + "\n";
+    }
+    return text;
+}
+
+// A value, NULL or error as the test compares them
+static std::string describe(const OperandValue& value) {
+    if (isNull(value)) {
+        return "NULL";
+    }
+    if (std::holds_alternative<int>(value)) {
+        return "int " + std::to_string(std::get<int>(value));
+    }
+    if (std::holds_alternative<double>(value)) {
+        std::ostringstream out;
+        out.precision(17);
+        out << "double " << std::get<double>(value);
+        return out.str();
+    }
+    if (std::holds_alternative<bool>(value)) {
+        return std::get<bool>(value) ? "true" : "false";
+    }
+    return "string " + std::get<std::string>(value);
+}
+
+// Whole batches, every third row of them, and an empty selection
+static std::vector<SelectionVector> selections(const ColumnTable& table) {
+    std::vector<SelectionVector> result;
+    for (size_t begin = 0; begin < table.numRows(); begin += BATCH_ROWS) {
+        SelectionVector all;
+        all.selectAll(begin, std::min(BATCH_ROWS, table.numRows() - begin));
+        SelectionVector sparse = all;
+        sparse.offsets.clear();
+        for (size_t i = 2; i < all.size(); i += 3) {
+            sparse.offsets.push_back(all.offsets[i]);
+        }
+        SelectionVector none = all;
+        none.offsets.clear();
+        result.push_back(all);
+        result.push_back(sparse);
+        result.push_back(none);
+    }
+    return result;
+}
+
+static void checkOperand(const Operand& operand, const ColumnTable& table) {
+    for (const auto& selection : selections(table)) {
+        ValueVector out;
+        operand.evaluateBatch(table, selection, out);
+        CHECK_EQ(out.size, selection.size());
+        std::string expected, actual;
+        for (size_t i = 0; i < selection.size(); ++i) {
+            try {
+                expected += describe(operand.evaluate(table, selection.row(i))) + "\n";
+            }
+            catch (const std::exception& e) {
+                expected += std::string("error ") + e.what() + "\n";
+            }
+            const std::string* error = out.errorAt(i);
+            actual += (error ? "error " + *error : describe(out.get(i))) + "\n";
+        }
+        CHECK_EQ(actual, expected);
+    }
+}
+
+// Rows that pass and rows that fail with an error, in row order
+static std::string applyRows(const ElementFilter& filter, const ColumnTable& table, const SelectionVector& selection) {
+    std::string result;
+    for (size_t i = 0; i < selection.size(); ++i) {
+        size_t row = selection.row(i);
+        try {
+            if (filter.apply(table, row)) {
+                result += std::to_string(row) + " pass\n";
+            }
+        }
+        catch (const std::exception& e) {
+            result += std::to_string(row) + " error " + e.what() + "\n";
+        }
+    }
+    return result;
+}
+
+static std::string applyBatch(const ElementFilter& filter, const ColumnTable& table, SelectionVector selection) {
+    std::vector<RowError> errors;
+    filter.applyBatch(table, selection, errors);
+    std::string result;
+    size_t next_error = 0;
+    for (size_t i = 0; i <= selection.size(); ++i) {
+        size_t row = i < selection.size() ? selection.row(i) : table.numRows();
+        for (; next_error < errors.size() && errors[next_error].row < row; ++next_error) {
+            result += std::to_string(errors[next_error].row) + " error " + errors[next_error].message + "\n";
+        }
+        if (i < selection.size()) {
+            result += std::to_string(row) + " pass\n";
+        }
+    }
+    return result;
+}
+
+// Filters keeping state (LIMIT, DISTINCT) are built afresh for each run
+static void checkFilter(const FilterBuilder& build, const ColumnTable& table, bool bind) {
+    std::shared_ptr<ElementFilter> by_row = build();
+    std::shared_ptr<ElementFilter> by_batch = build();
+    if (bind) {
+        by_row->bind(table);
+        by_batch->bind(table);
+    }
+    for (const auto& selection : selections(table)) {
+        CHECK_EQ(applyBatch(*by_batch, table, selection), applyRows(*by_row, table, selection));
+    }
+}
+
+static std::shared_ptr<Operand> column(const std::string& name) {
+    return std::make_shared<ColumnOperand>(name);
+}
+
+static std::shared_ptr<Operand> expression(std::shared_ptr<Operand> left, OperatorType op,
+                                           std::shared_ptr<Operand> right) {
+    return std::make_shared<ExpressionOperand>(left, op, right);
+}
+
+static FilterBuilder compare(std::shared_ptr<Operand> left, Comparator comparator, std::shared_ptr<Operand> right) {
+    return [=] { return std::make_shared<WhereFilter>(left, comparator, right); };
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/values.csv";
+    writeFile(csv, makeCSV(5000));
+    CSVLoader loader(csv);
+    CHECK(loader.load());
+    const ColumnTable& table = loader.getTable();
+    CHECK(table.getColumn(table.findColumn("i")).strayCount() > 0);
+    CHECK(table.getColumn(table.findColumn("tag")).isDictionaryEncoded());
+    // The same cells untyped
+    CSVLoadOptions untyped;
+    untyped.infer_schema = false;
+    CSVLoader text_loader(csv, untyped);
+    CHECK(text_loader.load());
+
+    std::vector<std::shared_ptr<Operand>> operands = {
+        column("i"), column("d"), column("b"), column("s"), column("tag"), column("missing"),
+        std::make_shared<IntegerOperand>(7),
+        std::make_shared<DoubleOperand>(-1.25),
+        std::make_shared<BooleanOperand>(true),
+        std::make_shared<StringOperand>("tag1"),
+        expression(column("i"), OperatorType::ADD, column("d")),
+        expression(column("i"), OperatorType::DIVIDE, std::make_shared<IntegerOperand>(0)),
+        expression(column("d"), OperatorType::MULTIPLY, column("d")),
+        // Text and bool sides fail on every row
+        expression(column("s"), OperatorType::ADD, std::make_shared<IntegerOperand>(1)),
+        expression(column("b"), OperatorType::SUBTRACT, column("i")),
+        expression(expression(column("i"), OperatorType::MULTIPLY, std::make_shared<IntegerOperand>(100000)),
+                   OperatorType::SUBTRACT, std::make_shared<DoubleOperand>(0.5)),
+    };
+    for (const auto& operand : operands) {
+        // Unbound, so the generic paths run, then bound (and compiled) to each table
+        for (const ColumnTable* target : { &table, &text_loader.getTable() }) {
+            checkOperand(*operand, *target);
+        }
+        for (const ColumnTable* target : { &table, &text_loader.getTable() }) {
+            operand->bind(*target);
+            checkOperand(*operand, *target);
+        }
+    }
+
+    std::vector<FilterBuilder> filters = {
+        where("i", Comparator::GREATER, 3),
+        where("i", Comparator::EQUAL, 3000000000.0),
+        where("d", Comparator::LESS_EQUAL, 0),
+        where("b", Comparator::EQUAL, true),
+        where("b", Comparator::GREATER, 1),
+        where("s", Comparator::LESS, std::string("text3")),
+        where("s", Comparator::EQUAL, 5),
+        where("tag", Comparator::EQUAL, std::string("tag2")),
+        where("tag", Comparator::IN, std::string("tag0,tag4")),
+        where("tag", Comparator::NOT_EQUAL, std::string("tag9")),
+        compare(std::make_shared<StringOperand>("tag3"), Comparator::EQUAL, column("tag")),
+        compare(column("i"), Comparator::LESS, column("d")),
+        compare(expression(column("i"), OperatorType::ADD, column("d")), Comparator::GREATER, std::make_shared<IntegerOperand>(4)),
+        [] {
+            auto both = std::make_shared<CompositeElementFilter>();
+            both->addFilter(where("tag", Comparator::EQUAL, std::string("tag1"))());
+            both->addFilter(where("i", Comparator::GREATER_EQUAL, 0)());
+            both->addFilter(std::make_shared<LimitFilter>(300, 20));
+            return both;
+        },
+        [] { return std::make_shared<DistinctFilter>(std::vector<std::shared_ptr<Operand>>{ column("tag"), column("b") }); },
+    };
+    for (const auto& filter : filters) {
+        for (const ColumnTable* target : { &table, &text_loader.getTable() }) {
+            checkFilter(filter, *target, false);
+            checkFilter(filter, *target, true);
+        }
+    }
+    return testResult();
+}
@@ -0,0 +1,68 @@
+// MultiFileTest.cpp
+// A directory of CSV files loads as the one CSV holding all their records
+#include "TestSupport.h"
+
+// code and flag are typed over every file: numeric and bool in the first,
+// text with the second; the second code column shadows the first
+static const char* HEADER = "id,code,flag,amount,code\n";
+static const char* PART1 = "1,007,TRUE,10,a\n2,12,false,20,b\n";
+static const char* PART2 = "3,abc,x,2.5,c\n4,zz,true,40,d\n5,,,,e\n";
+
+static std::string loadTable(const std::string& table, const CSVLoadOptions& options) {
+    CSVLoader loader(table, options);
+    CHECK(loader.load());
+    return dumpRows(loader.getTable());
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/all.csv";
+    std::string table = dir + "/parts";
+    writeFile(csv, std::string(HEADER) + PART1 + PART2);
+    mkdir(table.c_str(), 0755);
+    writeFile(table + "/part1.csv", std::string(HEADER) + PART1);
+    writeFile(table + "/part2.csv", std::string(HEADER) + PART2);
+
+    // Text keeps its raw form: "007" and "TRUE", not 7 and true
+    std::string whole = loadTable(table, CSVLoadOptions());
+    CHECK(whole.find("id:0,code:3,flag:3,amount:1,code:3\n") == 0);
+    CHECK(whole.find("\n0|1|007|TRUE|10|a\n") != std::string::npos);
+
+    const std::vector<std::string> all = { "id", "code", "flag", "amount" };
+    std::vector<QueryBuilder> queries = {
+        selectWhere(all, {}),
+        selectWhere(all, { where("amount", Comparator::GREATER, 15) }),
+        selectWhere(all, { where("amount", Comparator::LESS, 3) }),
+        selectWhere(all, { where("code", Comparator::EQUAL, std::string("c")) }),
+        selectWhere(all, { where("flag", Comparator::EQUAL, true) }),
+    };
+    std::vector<CSVLoadOptions> modes(5);
+    modes[1].schema_sample_rows = 2;
+    modes[2].infer_schema = false;
+    modes[3].num_threads = 4;
+    modes[4].use_cache = true;
+    for (const auto& mode : modes) {
+        CHECK_EQ(loadTable(table, mode), loadTable(csv, mode));
+        for (const auto& query : queries) {
+            QueryRun run;
+            run.options = mode;
+            std::string expected = runQuery(csv, query, run);
+            CHECK_EQ(runQuery(table, query, run), expected);
+            // The second pushed-down run skips files by the statistics of the first
+            run.pushdown = true;
+            CHECK_EQ(runQuery(table, query, run), expected);
+            CHECK_EQ(runQuery(table, query, run), expected);
+        }
+    }
+
+    // Statistics are taken from the typed table: amount is DOUBLE over both files
+    CSVLoadOptions filtered;
+    filtered.predicates = { { "amount", Comparator::GREATER, 100.0 } };
+    CSVLoader first(table, filtered);
+    CHECK(first.load());
+    CSVLoader second(table, filtered);
+    CHECK(second.load());
+    CHECK_EQ(second.getStats().files_skipped, size_t(2));
+    CHECK_EQ(second.getTable().numRows(), size_t(0));
+    return testResult();
+}
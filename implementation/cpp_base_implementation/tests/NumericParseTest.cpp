@@ -0,0 +1,153 @@
+// NumericParseTest.cpp
+// The from_chars parsers accept, reject and range-check every cell as the
+// std::stoi / std::stoll / std::stod calls on a whole cell they replaced do,
+// and parseCell types cells as the exception-driven parse did
+#include "TestSupport.h"
+#include "../NumericParse.h"
+#include <cmath>
+#include <random>
+
+// A parse outcome as the test compares them: the value, "range" or "rejected"
+static std::string describeDouble(double value) {
+    if (std::isnan(value)) {
+        return "nan";
+    }
+    std::ostringstream out;
+    out.precision(17);
+    out << value;
+    return out.str();
+}
+
+template <typename T>
+static std::string describeStatus(ParseStatus status, T value) {
+    if (status == ParseStatus::OUT_OF_RANGE) {
+        return "range";
+    }
+    if (status != ParseStatus::OK) {
+        return "rejected";
+    }
+    if constexpr (std::is_floating_point<T>::value) {
+        return describeDouble(value);
+    }
+    else {
+        return std::to_string(value);
+    }
+}
+
+// The conversion a cell used to get: the whole cell or nothing
+template <typename Convert>
+static std::string reference(const std::string& cell, Convert convert) {
+    try {
+        size_t pos;
+        auto value = convert(cell, &pos);
+        if (pos != cell.size()) {
+            return "rejected";
+        }
+        if constexpr (std::is_floating_point<decltype(value)>::value) {
+            return describeDouble(value);
+        }
+        else {
+            return std::to_string(value);
+        }
+    }
+    catch (const std::out_of_range&) {
+        return "range";
+    }
+    catch (const std::invalid_argument&) {
+        return "rejected";
+    }
+}
+
+static std::string describeValue(const OperandValue& value) {
+    if (std::holds_alternative<int>(value)) {
+        return "int " + std::to_string(std::get<int>(value));
+    }
+    if (std::holds_alternative<double>(value)) {
+        return "double " + describeDouble(std::get<double>(value));
+    }
+    if (std::holds_alternative<bool>(value)) {
+        return std::get<bool>(value) ? "true" : "false";
+    }
+    return "string " + std::get<std::string>(value);
+}
+
+// parseCell as it was written with stoi and stod: int, then double, then
+// bool, then the text
+static std::string referenceCell(const std::string& cell) {
+    try {
+        size_t pos;
+        int value = std::stoi(cell, &pos);
+        if (pos == cell.size()) {
+            return "int " + std::to_string(value);
+        }
+    }
+    catch (...) {
+    }
+    try {
+        size_t pos;
+        double value = std::stod(cell, &pos);
+        if (pos == cell.size()) {
+            return "double " + describeDouble(value);
+        }
+    }
+    catch (...) {
+    }
+    std::string lower = cell;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (lower == "true" || lower == "false") {
+        return lower;
+    }
+    return "string " + cell;
+}
+
+static void checkCell(const std::string& cell) {
+    // The cell is appended so that a failure names it
+    int64_t wide = 0;
+    ParseStatus status = parseInt64(cell, wide);
+    CHECK_EQ(describeStatus(status, wide) + " <" + cell + ">",
+             reference(cell, [](const std::string& s, size_t* pos) { return std::stoll(s, pos); }) + " <" + cell + ">");
+    int32_t narrow = 0;
+    status = parseInt32(cell, narrow);
+    CHECK_EQ(describeStatus(status, narrow) + " <" + cell + ">",
+             reference(cell, [](const std::string& s, size_t* pos) { return std::stoi(s, pos); }) + " <" + cell + ">");
+    double real = 0;
+    status = parseDouble(cell, real);
+    CHECK_EQ(describeStatus(status, real) + " <" + cell + ">",
+             reference(cell, [](const std::string& s, size_t* pos) { return std::stod(s, pos); }) + " <" + cell + ">");
+    CHECK_EQ(describeValue(parseCell(cell)) + " <" + cell + ">", referenceCell(cell) + " <" + cell + ">");
+}
+
+int main() {
+    const std::vector<std::string> cells = {
+        "", " ", "0", "-0", "+0", "7", "007", " 42", "\t-42", "\n5", "42 ", "4 2", "+", "-", "+-1", "-+1", "++1",
+        "--1", "2147483647", "2147483648", "-2147483648", "-2147483649", "9223372036854775807",
+        "9223372036854775808", "-9223372036854775808", "-9223372036854775809", "99999999999999999999",
+        "1.5", "1.50", ".5", "5.", "-.5", "1e3", "1E3", "1e+3", "1e-3", "+1.5e2", "1e", "1e+", "e3", ".", "..5",
+        "1.5.2", "1e400", "-1e400", "1e-400", "1.7976931348623157e308", "0x10", "0X1F", "-0x10", "+0x10",
+        "0x1p3", "0x1.8p1", "0x.8", "0x", "0x-1", "0xg", "inf", "-inf", "INF", "Infinity", "infinit", "nan",
+        "NaN", "-nan", "nan(1)", "true", "TRUE", "False", "yes", "1,5", "١٢", "12abc", "abc",
+    };
+    for (const auto& cell : cells) {
+        checkCell(cell);
+    }
+
+    // Random short cells over the characters numbers are made of
+    const std::string alphabet = "0123456789+-.eExXpPinfaINFA \t";
+    std::mt19937 random(2520);
+    for (size_t n = 0; n < 50000; ++n) {
+        std::string cell;
+        for (size_t length = random() % 9; cell.size() < length;) {
+            cell += alphabet[random() % alphabet.size()];
+        }
+        checkCell(cell);
+    }
+
+    // Booleans are exactly "true" and "false" in any case
+    bool flag;
+    CHECK(parseBool("tRuE", flag) == ParseStatus::OK && flag);
+    CHECK(parseBool("FALSE", flag) == ParseStatus::OK && !flag);
+    CHECK(parseBool("1", flag) == ParseStatus::INVALID);
+    CHECK(parseBool(" true", flag) == ParseStatus::INVALID);
+    CHECK(parseBool("", flag) == ParseStatus::EMPTY);
+    return testResult();
+}
@@ -0,0 +1,97 @@
+// OptimizerTest.cpp
+// A WHERE clause rewritten by the optimizer keeps, drops and reports errors
+// for exactly the rows the clause as written does
+#include "TestSupport.h"
+#include "../QueryOptimizer.h"
+
+// x is INT64, d DOUBLE with values next to the rewritten bounds, s text and b bool
+static const char* VALUES =
+    "id,x,d,s,b\n"
+    "1,1,0.9999999999995,abc,true\n"
+    "2,0,4e-16,5,false\n"
+    "3,-1,5e-16,,true\n"
+    "4,5000,-1e-16,x,\n"
+    "5,,7e-15,7,false\n"
+    "6,2,1e308,1,true\n"
+    "7,-100,-0.0,y,false\n"
+    "8,6,1.5,z,true\n";
+
+// Operands and filters are built afresh for each run
+using OperandBuilder = std::function<std::shared_ptr<Operand>()>;
+
+static OperandBuilder column(const std::string& name) {
+    return [=] { return std::make_shared<ColumnOperand>(name); };
+}
+
+static OperandBuilder constant(const OperandValue& value) {
+    return [=] { return constantOperand(value); };
+}
+
+static OperandBuilder arith(OperandBuilder left, OperatorType op, OperandBuilder right) {
+    return [=] { return std::make_shared<ExpressionOperand>(left(), op, right()); };
+}
+
+static FilterBuilder compare(OperandBuilder left, Comparator comparator, OperandBuilder right) {
+    return [=] { return std::make_shared<WhereFilter>(left(), comparator, right()); };
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/values.csv";
+    writeFile(csv, VALUES);
+
+    OperandBuilder x = column("x"), d = column("d"), s = column("s"), b = column("b");
+    // Cases whose bound lies many doubles away from the algebraic answer
+    std::vector<FilterBuilder> far_bounds = {
+        compare(arith(x, OperatorType::ADD, constant(5000)), Comparator::GREATER_EQUAL, constant(5001)),
+        compare(arith(x, OperatorType::ADD, constant(5000)), Comparator::GREATER_EQUAL, constant(5000)),
+        compare(arith(x, OperatorType::ADD, arith(constant(2), OperatorType::MULTIPLY, constant(3))),
+                Comparator::GREATER, constant(6)),
+        compare(arith(x, OperatorType::SUBTRACT, constant(100)), Comparator::LESS, constant(-100)),
+    };
+    for (const auto& build : far_bounds) {
+        std::shared_ptr<WhereFilter> rewritten = std::dynamic_pointer_cast<WhereFilter>(optimizeFilter(build()));
+        CHECK(rewritten && std::dynamic_pointer_cast<ColumnOperand>(rewritten->getLeft()));
+    }
+
+    std::vector<FilterBuilder> filters = far_bounds;
+    std::vector<FilterBuilder> more = {
+        compare(arith(d, OperatorType::ADD, constant(5000)), Comparator::GREATER_EQUAL, constant(5001)),
+        compare(arith(d, OperatorType::ADD, constant(5000)), Comparator::GREATER_EQUAL, constant(5000)),
+        compare(arith(d, OperatorType::ADD, arith(constant(2), OperatorType::MULTIPLY, constant(3))),
+                Comparator::GREATER, constant(6)),
+        compare(arith(d, OperatorType::SUBTRACT, constant(100)), Comparator::LESS, constant(-100)),
+        compare(arith(constant(2), OperatorType::MULTIPLY, x), Comparator::GREATER, constant(3)),
+        compare(arith(d, OperatorType::MULTIPLY, constant(-3)), Comparator::LESS_EQUAL, constant(1.5)),
+        compare(arith(x, OperatorType::DIVIDE, constant(4)), Comparator::EQUAL, constant(0.25)),
+        compare(arith(constant(10), OperatorType::SUBTRACT, d), Comparator::GREATER, constant(9)),
+        compare(constant(5), Comparator::LESS, arith(d, OperatorType::MULTIPLY, constant(1e10))),
+        compare(arith(x, OperatorType::MULTIPLY, constant(0.1)), Comparator::EQUAL, constant(0.2)),
+        compare(arith(x, OperatorType::ADD, constant(1)), Comparator::NOT_EQUAL, constant(3)),
+        compare(arith(arith(x, OperatorType::ADD, constant(1)), OperatorType::MULTIPLY, constant(2)),
+                Comparator::GREATER_EQUAL, constant(4)),
+        compare(arith(d, OperatorType::MULTIPLY, constant(2)), Comparator::GREATER, constant(1e308)),
+        // Text and bool values report the arithmetic's error, rewritten or not
+        compare(arith(s, OperatorType::ADD, constant(1)), Comparator::GREATER, constant(2)),
+        compare(arith(s, OperatorType::MULTIPLY, constant(2)), Comparator::EQUAL, constant(10)),
+        compare(arith(b, OperatorType::ADD, constant(1)), Comparator::EQUAL, constant(2)),
+    };
+    filters.insert(filters.end(), more.begin(), more.end());
+
+    std::vector<QueryRun> runs(5);
+    runs[1].options.num_threads = 4;
+    runs[2].batch_rows = 3;
+    runs[3].pushdown = true;
+    runs[4].options.infer_schema = false;
+    for (const auto& filter : filters) {
+        QueryBuilder query = selectWhere({ "id", "x", "d" }, { filter });
+        for (QueryRun run : runs) {
+            std::string expected = runQuery(csv, query, run);
+            run.optimize = true;
+            CHECK_EQ(runQuery(csv, query, run), expected);
+        }
+    }
+    CHECK(runQuery(csv, selectWhere({ "id" }, { more[13] }), QueryRun{ CSVLoadOptions(), false, true })
+              .find("Operands must be numeric") != std::string::npos);
+    return testResult();
+}
@@ -0,0 +1,101 @@
+// PartitionTest.cpp
+// Pruning key=value directories keeps exactly the rows, and reports exactly
+// the errors, of the same query over every file
+#include "TestSupport.h"
+
+static void writePart(const std::string& table, const std::string& dirs, const std::string& file,
+                      const std::string& rows) {
+    std::string path = table;
+    size_t begin = 0;
+    while (begin < dirs.size()) {
+        size_t slash = dirs.find('/', begin);
+        slash = slash == std::string::npos ? dirs.size() : slash;
+        path += "/" + dirs.substr(begin, slash - begin);
+        mkdir(path.c_str(), 0755);
+        begin = slash + 1;
+    }
+    writeFile(path + "/" + file, "amount,note\n" + rows);
+}
+
+// Row ids only count the files left after pruning, so errors name other rows
+static std::string withoutRowIds(const std::string& output) {
+    const std::string prefix = "Error processing row ";
+    std::string text = output;
+    for (size_t at = text.find(prefix); at != std::string::npos; at = text.find(prefix, at + prefix.size())) {
+        size_t end = text.find(':', at);
+        text.erase(at + prefix.size(), end - at - prefix.size());
+    }
+    return text;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string table = dir + "/sales";
+    mkdir(table.c_str(), 0755);
+    writePart(table, "year=2025/region=eu", "part.csv", "10,a\n20,\"b, c\"\n");
+    writePart(table, "year=2025/region=us", "part.csv", "30,x\n5,y\n");
+    writePart(table, "year=2026/region=eu", "part-0.csv", "40,\n17,x\r\n");
+    writePart(table, "year=2026/region=eu", "part-1.csv", "8,q\n");
+    writePart(table, "year=2026/region=__HIVE_DEFAULT_PARTITION__", "part.csv", "50,n\n");
+    writePart(table, "year=2026/region=a%2Fb", "part.csv", "60,x\n2,z\n");
+    writePart(table, "year=2026/_temporary", "part.csv", "999,junk\n");
+    writePart(table, "year=2027", "part.csv", "70,x\n");
+
+    const std::vector<std::string> all = { "year", "region", "amount", "note" };
+    std::vector<QueryBuilder> queries = {
+        selectWhere(all, {}),
+        selectWhere(all, { where("region", Comparator::EQUAL, std::string("eu")) }),
+        // The NULL partition and the file outside any region fail both ways
+        selectWhere(all, { where("region", Comparator::NOT_EQUAL, std::string("eu")) }),
+        selectWhere(all, { where("region", Comparator::EQUAL, std::string("a/b")) }),
+        selectWhere(all, { where("year", Comparator::GREATER_EQUAL, 2026) }),
+        selectWhere(all, { where("year", Comparator::LESS, 2026.5) }),
+        selectWhere(all, { where("year", Comparator::EQUAL, 2026), where("region", Comparator::EQUAL, std::string("eu")) }),
+        // Errors on every row: nothing may be pruned
+        selectWhere(all, { where("region", Comparator::GREATER, 5) }),
+        selectWhere(all, { where("year", Comparator::EQUAL, std::string("2026")) }),
+        // A predicate on a CSV column first only lets pruning on if it cannot fail with an error
+        selectWhere(all, { where("amount", Comparator::GREATER, 15), where("region", Comparator::EQUAL, std::string("us")) }),
+        selectWhere(all, { where("note", Comparator::EQUAL, std::string("x")), where("year", Comparator::EQUAL, 2025) }),
+        selectWhere(all, { where("note", Comparator::GREATER, 1), where("year", Comparator::EQUAL, 2025) }),
+        selectWhere({ "amount" }, { where("region", Comparator::EQUAL, std::string("us")) }),
+    };
+
+    std::vector<QueryRun> runs(6);
+    runs[1].options.parallel_files = 1;
+    runs[2].options.mode = LoadMode::MMAP;
+    runs[2].options.num_threads = 2;
+    runs[3].options.schema_sample_rows = 1;
+    runs[4].options.infer_schema = false;
+    runs[5].batch_rows = 2;
+    for (const std::string& source : { table, table + "/*/*/*.csv" }) {
+        for (size_t q = 0; q < queries.size(); ++q) {
+            for (const auto& run : runs) {
+                QueryRun plain = run;
+                plain.batch_rows = 0;
+                std::string expected = withoutRowIds(runQuery(source, queries[q], plain));
+                QueryRun pushed = run;
+                pushed.pushdown = true;
+                CHECK_EQ(withoutRowIds(runQuery(source, queries[q], pushed)), expected);
+            }
+        }
+    }
+    CHECK(runQuery(table, queries[0]).find("999") == std::string::npos);
+    CHECK(runQuery(table, queries[7]).find("Error processing row 1:") != std::string::npos);
+
+    // The pruned directories are counted and their files never parsed
+    CSVLoadOptions pruned;
+    pruned.predicates = { { "region", Comparator::EQUAL, std::string("eu") } };
+    CSVLoader eu(table, pruned);
+    CHECK(eu.load());
+    CHECK_EQ(eu.getStats().partitions_pruned, size_t(3));
+    CHECK_EQ(eu.getStats().files_loaded, size_t(4));
+    // The file outside any region directory is left to the WHERE clause
+    CHECK_EQ(eu.getTable().numRows(), size_t(6));
+
+    pruned.predicates = { { "note", Comparator::GREATER, 1 }, { "region", Comparator::EQUAL, std::string("eu") } };
+    CSVLoader unpruned(table, pruned);
+    CHECK(unpruned.load());
+    CHECK_EQ(unpruned.getStats().partitions_pruned, size_t(0));
+    return testResult();
+}
@@ -0,0 +1,195 @@
+// ProgramTest.cpp
+// A query lowered to a register program filters, projects and fails each
+// row as the query's filter and operands do one row at a time
+#include "TestSupport.h"
+#include "../QueryProgram.h"
+
+static std::string makeCSV(size_t records) {
+    std::string text = "i,d,z,s,b\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string i = r % 17 == 0 ? "" : std::to_string(static_cast<int>(r % 50) - 25);
+        if (r == 700) {
+            i = "3000000000";
+        }
+        std::string d = r % 19 == 0 ? "" : std::to_string((static_cast<int>(r % 13) - 4) * 0.5);
+        text += i + "," + d + "," + std::to_string(r % 3) + ",name" + std::to_string(r % 7) + "," +
+                (r % 23 == 0 ? "" : r % 2 ? "true" : "false") + "\n";
+    }
+    return text;
+}
+
+static std::shared_ptr<Operand> column(const std::string& name) {
+    return std::make_shared<ColumnOperand>(name);
+}
+
+static std::shared_ptr<Operand> expression(std::shared_ptr<Operand> left, OperatorType op,
+                                           std::shared_ptr<Operand> right) {
+    return std::make_shared<ExpressionOperand>(left, op, right);
+}
+
+static FilterBuilder compare(std::function<std::shared_ptr<Operand>()> left, Comparator comparator,
+                             std::function<std::shared_ptr<Operand>()> right) {
+    return [=] { return std::make_shared<WhereFilter>(left(), comparator, right()); };
+}
+
+// SELECT operands FROM table WHERE every filter
+static QueryBuilder query(std::function<std::vector<std::shared_ptr<Operand>>()> operands,
+                          const std::vector<FilterBuilder>& filters) {
+    return [=](const std::string& table) {
+        ElementSelect select(operands(), table);
+        for (const auto& filter : filters) {
+            select.addFilter(filter());
+        }
+        return select;
+    };
+}
+
+static std::string describe(const OperandValue& value) {
+    if (isNull(value)) {
+        return "NULL";
+    }
+    std::ostringstream out;
+    out.precision(17);
+    std::visit([&out](const auto& v) {
+        if constexpr (!std::is_same_v<std::decay_t<decltype(v)>, NullValue>) {
+            out << v;
+        }
+    }, value);
+    return std::to_string(value.index()) + ":" + out.str();
+}
+
+// Each row that passes or fails with an error, filtered and evaluated a row at a time
+static std::string runRows(const ElementSelect& select, const ColumnTable& table) {
+    select.bind(table);
+    std::string rows;
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        std::string line = std::to_string(row);
+        try {
+            if (!select.getFilter()->apply(table, row)) {
+                continue;
+            }
+            for (const auto& operand : select.getOperands()) {
+                line += "|" + describe(operand->evaluate(table, row));
+            }
+        }
+        catch (const std::exception& e) {
+            line = std::to_string(row) + " error " + e.what();
+        }
+        rows += line + "\n";
+    }
+    return rows;
+}
+
+// The same, by the program over batches as QueryExecutor runs it
+static std::string runProgram(const ElementSelect& select, const ColumnTable& table, ProgramProfile& profile) {
+    select.bind(table);
+    QueryProgram program(select, table);
+    std::string rows;
+    SelectionVector selection;
+    std::vector<RowError> errors;
+    for (size_t begin = 0; begin < table.numRows(); begin += BATCH_ROWS) {
+        selection.selectAll(begin, std::min(BATCH_ROWS, table.numRows() - begin));
+        errors.clear();
+        program.run(table, selection, errors);
+        std::stable_sort(errors.begin(), errors.end(),
+                         [](const RowError& a, const RowError& b) { return a.row < b.row; });
+        size_t next_error = 0;
+        for (size_t i = 0; i <= selection.size(); ++i) {
+            size_t row = i < selection.size() ? selection.row(i) : table.numRows();
+            for (; next_error < errors.size() && errors[next_error].row < row; ++next_error) {
+                rows += std::to_string(errors[next_error].row) + " error " + errors[next_error].message + "\n";
+            }
+            if (i == selection.size()) {
+                break;
+            }
+            std::string line = std::to_string(row);
+            for (size_t k = 0; k < select.getOperands().size(); ++k) {
+                if (const std::string* error = program.output(k).errorAt(i)) {
+                    line = std::to_string(row) + " error " + *error;
+                    break;
+                }
+                line += "|" + describe(program.output(k).get(i));
+            }
+            rows += line + "\n";
+        }
+    }
+    profile = program.getProfile();
+    return rows;
+}
+
+static size_t executed(const ProgramProfile& profile, OpCode opcode) {
+    return profile.instructions[static_cast<size_t>(opcode)];
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/values.csv";
+    writeFile(csv, makeCSV(3000));
+    CSVLoader loader(csv);
+    CHECK(loader.load());
+    const ColumnTable& table = loader.getTable();
+
+    auto i = [] { return column("i"); };
+    auto d = [] { return column("d"); };
+    auto z = [] { return column("z"); };
+    auto s = [] { return column("s"); };
+    auto b = [] { return column("b"); };
+    auto number = [](int value) { return [value] { return std::make_shared<IntegerOperand>(value); }; };
+    auto real = [](double value) { return [value] { return std::make_shared<DoubleOperand>(value); }; };
+    auto text = [](const std::string& value) { return [value] { return std::make_shared<StringOperand>(value); }; };
+    auto ratio = [] { return expression(column("d"), OperatorType::DIVIDE, column("z")); };
+    auto scaled = [] {
+        return expression(expression(column("i"), OperatorType::MULTIPLY, std::make_shared<DoubleOperand>(1.5)),
+                          OperatorType::SUBTRACT, column("d"));
+    };
+
+    // Numeric queries lower to typed kernels only
+    std::vector<QueryBuilder> numeric = {
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ i(), d(), scaled() }; },
+              { compare(i, Comparator::GREATER, number(3)) }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ ratio(), scaled(), z() }; },
+              { compare(scaled, Comparator::LESS_EQUAL, real(10.25)), compare(d, Comparator::NOT_EQUAL, number(0)) }),
+        // Division by zero in the filter, then in a projection of the rows left
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ i(), ratio() }; },
+              { compare(ratio, Comparator::GREATER, real(-1.0)) }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ expression(i(), OperatorType::DIVIDE, z()) }; },
+              { compare(i, Comparator::EQUAL, d) }),
+    };
+    // Queries that keep instructions calling the filter or operand
+    std::vector<QueryBuilder> mixed = {
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ s(), b(), i() }; },
+              { compare(s, Comparator::EQUAL, text("name3")), compare(i, Comparator::LESS, number(0)) }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ s(), expression(s(), OperatorType::ADD, i()) }; },
+              { compare(b, Comparator::EQUAL, [] { return std::make_shared<BooleanOperand>(true); }) }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ i(), scaled() }; },
+              { compare(s, Comparator::GREATER, number(1)), compare(i, Comparator::GREATER, number(0)) }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ z(), s() }; },
+              { [] { return std::make_shared<DistinctFilter>(std::vector<std::shared_ptr<Operand>>{ column("z"), column("s") }); } }),
+        query([=] { return std::vector<std::shared_ptr<Operand>>{ i(), d() }; },
+              { compare(d, Comparator::GREATER, number(0)), [] { return std::make_shared<LimitFilter>(40, 1500); } }),
+    };
+
+    ProgramProfile profile;
+    for (const auto& build : numeric) {
+        CHECK_EQ(runProgram(build(csv), table, profile), runRows(build(csv), table));
+        CHECK(executed(profile, OpCode::COMPARE) > 0);
+        CHECK_EQ(executed(profile, OpCode::EVALUATE) + executed(profile, OpCode::FILTER), size_t(0));
+    }
+    for (const auto& build : mixed) {
+        CHECK_EQ(runProgram(build(csv), table, profile), runRows(build(csv), table));
+        CHECK(executed(profile, OpCode::EVALUATE) + executed(profile, OpCode::FILTER) > 0);
+    }
+
+    // The profile counts one instruction per batch, and the rows it ran over
+    ElementSelect select = numeric[0](csv);
+    runProgram(select, table, profile);
+    QueryProgram program(select, table);
+    size_t batches = (table.numRows() + BATCH_ROWS - 1) / BATCH_ROWS;
+    size_t total = 0;
+    for (size_t op = 0; op < ProgramProfile::NUM_OPCODES; ++op) {
+        total += profile.instructions[op];
+    }
+    CHECK_EQ(total, program.numInstructions() * batches);
+    CHECK_EQ(profile.rows[static_cast<size_t>(OpCode::COMPARE)], uint64_t(table.numRows()));
+    return testResult();
+}
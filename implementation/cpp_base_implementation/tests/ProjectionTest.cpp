@@ -0,0 +1,125 @@
+// ProjectionTest.cpp
+// Loading only the columns a query reads gives those columns exactly as a
+// load of every column does, and the query the same rows and errors
+#include "TestSupport.h"
+
+// Quoted text with separators and line breaks, numbers, bools, a sparse
+// column, short rows and rows with extra fields, between the projected ones
+static std::string makeCSV(size_t records) {
+    std::string text = "id,note,amount,flag,sparse,city,code,tail\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + ",";
+        text += r % 7 == 0 ? "\"a, \"\"quoted\"\"\nnote " + id + "\"" : "note" + id;
+        text += "," + (r % 5 == 0 ? id + ".25" : std::to_string(r * 3)) + "," + (r % 2 ? "true" : "false");
+        if (r % 13 == 0) {
+            text += "\n";   // Short row: the remaining cells are missing
+            continue;
+        }
+        text += "," + std::string(r % 11 == 0 ? id : "") + "," + (r % 3 ? "Oslo" : "\"Rome\"") + "," +
+                (r == 4000 ? "n/a" : std::to_string(r % 100)) + ",t" + id;
+        text += r % 17 == 0 ? ",extra,fields\r\n" : "\n";
+    }
+    return text;
+}
+
+// Row ids, then the named columns of the table (skipping names it does not
+// have), with their types and cells
+static std::string dumpColumns(const ColumnTable& table, const std::vector<std::string>& names) {
+    std::ostringstream out;
+    for (const auto& name : names) {
+        int idx = table.findColumn(name);
+        if (idx >= 0) {
+            out << name << ":" << static_cast<int>(table.getColumn(idx).getType()) << ",";
+        }
+    }
+    out << "\n";
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        out << table.getRowId(row);
+        for (const auto& name : names) {
+            int idx = table.findColumn(name);
+            if (idx < 0) {
+                continue;
+            }
+            const Column& column = table.getColumn(idx);
+            std::string_view text;
+            out << "|" << (column.isMissing(row) && !column.strayText(row, text) ? "NULL" : column.toString(row));
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+static std::string loadColumns(const std::string& path, const CSVLoadOptions& options,
+                               const std::vector<std::string>& names, size_t batch_rows = 0) {
+    CSVLoader loader(path, options);
+    if (batch_rows == 0) {
+        CHECK(loader.load());
+        return dumpColumns(loader.getTable(), names);
+    }
+    std::string rows;
+    CHECK(loader.openBatches(batch_rows));
+    while (loader.nextBatch()) {
+        rows += dumpColumns(loader.getTable(), names);
+    }
+    return rows;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/wide.csv";
+    writeFile(csv, makeCSV(6000));
+
+    const std::vector<std::vector<std::string>> projections = {
+        { "amount" },
+        { "id", "note" },
+        { "sparse", "code" },
+        { "tail", "flag", "city" },
+        { "id", "missing" },
+    };
+    std::vector<CSVLoadOptions> modes(6);
+    modes[1].mode = LoadMode::MMAP;
+    modes[2].num_threads = 4;
+    modes[3].read_ahead_blocks = 0;
+    modes[4].infer_schema = false;
+    modes[5].schema_sample_rows = 0;
+    for (const auto& mode : modes) {
+        CSVLoader full(csv, mode);
+        CHECK(full.load());
+        for (const auto& names : projections) {
+            CSVLoadOptions projected = mode;
+            projected.columns = std::unordered_set<std::string>(names.begin(), names.end());
+            CSVLoader loader(csv, projected);
+            CHECK(loader.load());
+            // Only the requested columns that exist are stored
+            size_t known = 0;
+            for (const auto& name : names) {
+                known += full.getTable().findColumn(name) >= 0;
+            }
+            CHECK_EQ(loader.getTable().numColumns(), known);
+            CHECK_EQ(dumpColumns(loader.getTable(), names), dumpColumns(full.getTable(), names));
+            CHECK_EQ(loader.getStats().rows_loaded, full.getStats().rows_loaded);
+            CHECK(loader.getStats().bytes_skipped > 0);
+            CHECK_EQ(loadColumns(csv, projected, names, 1000), loadColumns(csv, mode, names, 1000));
+        }
+    }
+
+    // Queries over the columns they read, with no predicate pushed down
+    const std::vector<QueryBuilder> queries = {
+        selectWhere({ "id", "note" }, { where("amount", Comparator::GREATER, 9000) }),
+        selectWhere({ "city" }, { where("flag", Comparator::EQUAL, true), where("sparse", Comparator::LESS, 3000) }),
+        // "n/a" in code is reported in both runs
+        selectWhere({ "tail" }, { where("code", Comparator::GREATER_EQUAL, 98) }),
+        selectWhere({ "missing" }, {}),
+    };
+    for (const auto& query : queries) {
+        QueryRun plain;
+        QueryRun projected;
+        projected.options.columns = query(csv).getRequiredColumns();
+        CHECK_EQ(runQuery(csv, query, projected), runQuery(csv, query, plain));
+        projected.batch_rows = 1000;
+        CHECK_EQ(runQuery(csv, query, projected), runQuery(csv, query, plain));
+    }
+    CHECK(runQuery(csv, queries[2]).find("Error processing row 4001:") != std::string::npos);
+    return testResult();
+}
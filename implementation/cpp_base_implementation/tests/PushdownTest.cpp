@@ -0,0 +1,100 @@
+// PushdownTest.cpp
+// Predicates checked while scanning keep exactly the rows the WHERE clause
+// passes or reports errors for
+#include "TestSupport.h"
+
+// name is text with a numeric-looking cell, age and code are mostly numbers,
+// active is bool, score double, note is empty in the leading records
+static const char* PEOPLE =
+    "id,name,age,active,code,score,note\n"
+    "1,Alice,30,true,007,1.5,\n"
+    "2,42,25,false,7,2,\n"
+    "3,Charlie,x,TRUE,abc,,\n"
+    "4,Diana,28,,8,3.25,1\n"
+    "5,Eve,41,false,7,-0.5,2\n"
+    "6,\"Frank, Jr\",,true,\"07\",4,y\n"
+    "7,Gus,35\n"
+    "8,7,19,maybe,9,1e1,3\n";
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/people.csv";
+    writeFile(csv, PEOPLE);
+
+    const std::vector<std::string> all = { "id", "name", "age", "active", "code", "score", "note" };
+    std::vector<QueryBuilder> queries = {
+        // A STRING column against a number: an error for every row, even "42"
+        selectWhere(all, { where("name", Comparator::GREATER, 5) }),
+        selectWhere(all, { where("name", Comparator::EQUAL, std::string("42")) }),
+        selectWhere(all, { where("age", Comparator::GREATER, 30) }),
+        selectWhere(all, { where("age", Comparator::LESS_EQUAL, 28) }),
+        selectWhere(all, { where("age", Comparator::NOT_EQUAL, 25) }),
+        // NULL cells fail quietly, the others report the type mismatch
+        selectWhere(all, { where("age", Comparator::EQUAL, std::string("x")) }),
+        selectWhere(all, { where("active", Comparator::EQUAL, true) }),
+        selectWhere(all, { where("active", Comparator::GREATER, true) }),
+        selectWhere(all, { where("code", Comparator::EQUAL, 7) }),
+        selectWhere(all, { where("score", Comparator::GREATER_EQUAL, 2.0) }),
+        selectWhere(all, { where("score", Comparator::LESS, 3) }),
+        selectWhere(all, { where("note", Comparator::GREATER, 1) }),
+        selectWhere(all, { where("note", Comparator::EQUAL, std::string("y")) }),
+        selectWhere({ "name" }, { where("age", Comparator::GREATER, 26), where("active", Comparator::EQUAL, true) }),
+        selectWhere({ "name" }, { where("missing", Comparator::EQUAL, 1) }),
+    };
+
+    std::vector<CSVLoadOptions> modes(5);
+    modes[1].mode = LoadMode::MMAP;
+    modes[2].num_threads = 4;
+    modes[3].schema_sample_rows = 3;
+    modes[4].infer_schema = false;
+    for (size_t m = 0; m < modes.size(); ++m) {
+        for (size_t q = 0; q < queries.size(); ++q) {
+            QueryRun plain;
+            plain.options = modes[m];
+            QueryRun pushed = plain;
+            pushed.pushdown = true;
+            std::string expected = runQuery(csv, queries[q], plain);
+            CHECK_EQ(runQuery(csv, queries[q], pushed), expected);
+        }
+    }
+
+    // A digit-only cell of a text column is not a number
+    CHECK(runQuery(csv, queries[0]).find("Error processing row 2:") != std::string::npos);
+    // The scan does drop rows: NULL ages and those not over 30, but not the
+    // stray "x", which the WHERE clause reports
+    CSVLoadOptions filtered;
+    filtered.predicates = { { "age", Comparator::GREATER, 30 } };
+    CSVLoader loader(csv, filtered);
+    CHECK(loader.load());
+    CHECK_EQ(loader.getStats().rows_filtered, uint64_t(5));
+
+    // Partition directories are typed from their values; "7" does not make
+    // region numeric, and pruning on it agrees with the loaded rows
+    std::string table = dir + "/sales";
+    mkdir(table.c_str(), 0755);
+    const char* regions[] = { "eu", "us", "7" };
+    for (const char* region : regions) {
+        std::string partition = table + "/region=" + region;
+        mkdir(partition.c_str(), 0755);
+        writeFile(partition + "/part.csv", std::string("amount\n10\n") + region + "\n30\n");
+    }
+    std::vector<QueryBuilder> partition_queries = {
+        selectWhere({ "region", "amount" }, { where("region", Comparator::EQUAL, std::string("eu")) }),
+        selectWhere({ "region", "amount" }, { where("region", Comparator::GREATER, 5) }),
+        selectWhere({ "region", "amount" }, { where("amount", Comparator::GREATER, 15) }),
+    };
+    CSVLoadOptions pruned;
+    pruned.predicates = { { "region", Comparator::EQUAL, std::string("eu") } };
+    CSVLoader partitioned(table, pruned);
+    CHECK(partitioned.load());
+    CHECK_EQ(partitioned.getStats().partitions_pruned, size_t(2));
+    for (const auto& query : partition_queries) {
+        QueryRun pushed;
+        pushed.pushdown = true;
+        std::string expected = runQuery(table, query);
+        CHECK_EQ(runQuery(table, query, pushed), expected);
+        pushed.batch_rows = 2;
+        CHECK_EQ(runQuery(table, query, pushed), expected);
+    }
+    return testResult();
+}
@@ -0,0 +1,96 @@
+// QuotingTest.cpp
+// Quoted fields, escaped quotes, line breaks inside quotes and CRLF record
+// ends load alike in every mode: streamed, mapped, chunked over threads and
+// in batches
+#include "TestSupport.h"
+
+// Cells that end up in one column as text, with their decoded form
+static const char* QUOTED[][2] = {
+    { "plain", "plain" },
+    { "\"a,b\"", "a,b" },
+    { "\"say \"\"hi\"\"\"", "say \"hi\"" },
+    { "\"two\nlines\"", "two\nlines" },
+    { "\"crlf\r\ninside\"", "crlf\r\ninside" },
+    { "\"\"", "" },
+    { "\"\"\"\"", "\"" },
+};
+static const size_t NUM_QUOTED = sizeof(QUOTED) / sizeof(QUOTED[0]);
+
+// Enough records for several 1 MiB parse chunks and read blocks, so that
+// their boundaries fall inside quoted fields
+static std::string makeCSV(size_t records) {
+    std::string text = "id,\"note, quoted\",amount,flag\r\n";
+    for (size_t r = 0; r < records; ++r) {
+        text += std::to_string(r) + "," + QUOTED[r % NUM_QUOTED][0] + ",";
+        text += r % 5 == 0 ? "\"" + std::to_string(r) + ".5\"" : std::to_string(r * 3);
+        text += r % 2 == 0 ? ",true" : ",\"false\"";
+        text += r % 3 == 0 ? "\r\n" : "\n";
+    }
+    // The last record has no delimiter
+    return text + "999999,\"end\",1,true";
+}
+
+static std::string loadAll(const std::string& csv, const CSVLoadOptions& options, size_t batch_rows = 0) {
+    CSVLoader loader(csv, options);
+    if (batch_rows == 0) {
+        CHECK(loader.load());
+        return dumpRows(loader.getTable());
+    }
+    std::string rows;
+    CHECK(loader.openBatches(batch_rows));
+    bool first = true;
+    while (loader.nextBatch()) {
+        rows += dumpRows(loader.getTable(), first);
+        first = false;
+    }
+    return rows;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/quoted.csv";
+    writeFile(csv, makeCSV(120000));
+
+    CSVLoader plain(csv);
+    CHECK(plain.load());
+    const ColumnTable& table = plain.getTable();
+    CHECK_EQ(table.numRows(), size_t(120001));
+    const Column& note = table.getColumn(table.findColumn("note, quoted"));
+    for (size_t row = 0; row < 2 * NUM_QUOTED; ++row) {
+        CHECK_EQ(std::string(note.getString(row)), std::string(QUOTED[row % NUM_QUOTED][1]));
+    }
+    CHECK(table.getColumn(table.findColumn("amount")).getType() == ColumnType::DOUBLE);
+    CHECK(table.getColumn(table.findColumn("flag")).getType() == ColumnType::BOOL);
+    CHECK_EQ(std::string(note.getString(120000)), std::string("end"));
+    std::string expected = dumpRows(table);
+
+    std::vector<CSVLoadOptions> modes(6);
+    modes[0].mode = LoadMode::MMAP;
+    modes[1].num_threads = 4;
+    modes[2].mode = LoadMode::MMAP;
+    modes[2].num_threads = 3;
+    modes[3].read_ahead_blocks = 0;
+    modes[4].infer_schema = false;
+    modes[5].dictionary_max_entries = 0;
+    for (size_t m = 0; m < modes.size(); ++m) {
+        CSVLoadOptions reference;
+        reference.infer_schema = modes[m].infer_schema;
+        std::string want = m == 4 ? loadAll(csv, reference) : expected;
+        CHECK_EQ(loadAll(csv, modes[m]), want);
+    }
+    CSVLoadOptions threaded;
+    threaded.num_threads = 4;
+    CSVLoader chunked(csv, threaded);
+    CHECK(chunked.load());
+    CHECK(chunked.getStats().chunks_parsed > 1);
+
+    for (size_t batch_rows : { 1000, 4099, 200000 }) {
+        CHECK_EQ(loadAll(csv, CSVLoadOptions(), batch_rows), expected);
+    }
+
+    // The map view decodes the same cells
+    const auto& rows = plain.getData();
+    CHECK_EQ(rows[2].at("note, quoted"), std::string("say \"hi\""));
+    CHECK_EQ(rows[4].at("note, quoted"), std::string("crlf\r\ninside"));
+    return testResult();
+}
@@ -0,0 +1,98 @@
+// ReadAheadTest.cpp
+// Blocks read ahead of the parser, through io_uring or a reader thread, are
+// the bytes of the file in order, and load as reading each block on demand does
+#include "TestSupport.h"
+#include "../ReadAheadReader.h"
+
+// Records with quoted line breaks and separators, so that records and
+// quoted fields straddle block boundaries
+static std::string makeCSV(size_t records) {
+    std::string text = "id,note,amount\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + "," + (r % 6 == 0 ? "\"line one\nline, two " + id + "\"" : "note" + id) + "," +
+                std::to_string(r % 1000) + (r % 4 == 0 ? ".5" : "") + (r % 10 == 0 ? "\r\n" : "\n");
+    }
+    return text;
+}
+
+// Every byte the reader hands out, and whether it ended without an error
+static std::string readAll(const std::string& path, size_t block_size, size_t depth, bool& ok) {
+    ReadAheadReader reader(block_size, depth);
+    ok = reader.open(path);
+    std::vector<char> block(reader.blockSize());
+    std::string text;
+    bool short_block = false;
+    while (size_t got = reader.read(block.data())) {
+        // Only the last block may be short
+        ok = ok && !short_block;
+        short_block = got < block_size;
+        text.append(block.data(), got);
+    }
+    ok = ok && !reader.failed();
+    return text;
+}
+
+static std::string loadAll(const std::string& path, const CSVLoadOptions& options, size_t batch_rows = 0) {
+    CSVLoader loader(path, options);
+    if (batch_rows == 0) {
+        CHECK(loader.load());
+        return dumpRows(loader.getTable());
+    }
+    std::string rows;
+    CHECK(loader.openBatches(batch_rows));
+    bool first = true;
+    while (loader.nextBatch()) {
+        rows += dumpRows(loader.getTable(), first);
+        first = false;
+    }
+    return rows;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+
+    // Empty, single-block, exact-multiple and ragged files, at every depth
+    const size_t block_size = 4096;
+    std::string bytes;
+    for (size_t i = 0; bytes.size() < 9 * block_size; ++i) {
+        bytes += static_cast<char>('a' + i % 26);
+    }
+    for (size_t size : { size_t(0), size_t(1), block_size - 1, block_size, block_size + 1, 3 * block_size,
+                         7 * block_size + 17 }) {
+        std::string path = dir + "/bytes" + std::to_string(size);
+        writeFile(path, bytes.substr(0, size));
+        for (size_t depth : { 0, 1, 2, 3, 8 }) {
+            bool ok;
+            std::string text = readAll(path, block_size, depth, ok);
+            CHECK(ok);
+            CHECK_EQ(text.size(), size);
+            CHECK(text == bytes.substr(0, size));
+        }
+    }
+    ReadAheadReader missing;
+    CHECK(!missing.open(dir + "/missing.csv"));
+
+    // Loads over several 1 MiB blocks, streamed and in batches, with and
+    // without blocks in flight
+    std::string csv = dir + "/blocks.csv";
+    writeFile(csv, makeCSV(150000));
+    CSVLoadOptions on_demand;
+    on_demand.read_ahead_blocks = 0;
+    std::string expected = loadAll(csv, on_demand);
+    std::string expected_batches = loadAll(csv, on_demand, 20000);
+    on_demand.infer_schema = false;
+    std::string expected_text = loadAll(csv, on_demand);
+    for (size_t depth : { 1, 2, 3, 6 }) {
+        CSVLoadOptions options;
+        options.read_ahead_blocks = depth;
+        CSVLoader loader(csv, options);
+        CHECK(loader.load());
+        CHECK_EQ(dumpRows(loader.getTable()), expected);
+        CHECK_EQ(loader.getStats().bytes_read, uint64_t(makeCSV(150000).size()));
+        CHECK_EQ(loadAll(csv, options, 20000), expected_batches);
+        options.infer_schema = false;
+        CHECK_EQ(loadAll(csv, options), expected_text);
+    }
+    return testResult();
+}
@@ -0,0 +1,75 @@
+// RefreshTest.cpp
+// A table refreshed with appended records is the table a full load of the
+// file gives
+#include "TestSupport.h"
+
+static const char* HEAD =
+    "id,name,age,score\n"
+    "1,Alice,30,1.5\n"
+    "2,\"Bob, Jr\",25,2\n"
+    "3,Charlie,35,\n"
+    "4,\"multi\nline\",28,3.25\n";
+
+static void appendFile(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out << text;
+}
+
+static std::string fullLoad(const std::string& path, const CSVLoadOptions& options) {
+    CSVLoader loader(path, options);
+    CHECK(loader.load());
+    return dumpRows(loader.getTable());
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/tail.csv";
+    std::string copy = dir + "/copy.csv";
+
+    CSVLoadOptions sampled;
+    sampled.schema_sample_rows = 4;
+    CSVLoadOptions pushed = sampled;
+    pushed.columns = { "name", "age" };
+    pushed.predicates = { { "age", Comparator::GREATER, 26 } };
+    CSVLoadOptions untyped;
+    untyped.infer_schema = false;
+    for (const CSVLoadOptions& options : { sampled, pushed, untyped }) {
+        writeFile(csv, HEAD);
+        CSVLoader loader(csv, options);
+        CHECK(loader.load());
+
+        // Complete records, one with a quoted line break and CRLF
+        appendFile(csv, "5,Eve,41,4\r\n6,\"new\nline\",33,5.5\n");
+        CHECK(loader.refresh());
+        CHECK(loader.getStats().appended);
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(csv, options));
+
+        // A record still being written waits for the next refresh
+        appendFile(csv, "7,Gus,5");
+        CHECK(loader.refresh());
+        writeFile(copy, std::string(HEAD) + "5,Eve,41,4\r\n6,\"new\nline\",33,5.5\n");
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(copy, options));
+        appendFile(csv, "0,7\n");
+        CHECK(loader.refresh());
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(csv, options));
+
+        // Nothing new
+        CHECK(loader.refresh());
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(csv, options));
+
+        // A cell that does not fit its column falls back to a full load
+        appendFile(csv, "8,Hal,old,6\n");
+        CHECK(loader.refresh());
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(csv, options));
+
+        // So does a rewritten prefix
+        std::ifstream in(csv, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        text.replace(text.find("Alice"), 5, "Alina");
+        writeFile(csv, text);
+        appendFile(csv, "9,Ida,50,7\n");
+        CHECK(loader.refresh());
+        CHECK_EQ(dumpRows(loader.getTable()), fullLoad(csv, options));
+    }
+    return testResult();
+}
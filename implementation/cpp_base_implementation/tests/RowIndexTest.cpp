@@ -0,0 +1,81 @@
+// RowIndexTest.cpp
+// Rows fetched through the row offset index are the rows of a full load
+#include "TestSupport.h"
+#include <set>
+
+// Records span several index checkpoints; some have quoted line breaks,
+// CRLF ends or missing cells
+static std::string makeCSV(size_t records) {
+    std::string text = "id,name,age,score\n";
+    for (size_t r = 0; r < records; ++r) {
+        std::string id = std::to_string(r);
+        if (r % 11 == 0) {
+            text += id + ",\"multi\nline " + id + "\"," + std::to_string(r % 70) + ",1.5\r\n";
+        }
+        else if (r % 13 == 0) {
+            text += id + ",short\n";
+        }
+        else {
+            text += id + ",name" + id + "," + std::to_string(r % 70) + "," + std::to_string(r) + ".25\n";
+        }
+    }
+    return text;
+}
+
+// The rows of a full load whose row id is in ids
+static std::string selectRows(const ColumnTable& table, const std::set<uint64_t>& ids) {
+    std::string rows;
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        if (ids.count(table.getRowId(row))) {
+            rows += dumpRow(table, row);
+        }
+    }
+    return rows;
+}
+
+static std::string lookup(const std::string& csv, const std::vector<uint64_t>& ids,
+                          const CSVLoadOptions& options = CSVLoadOptions()) {
+    CSVLoader loader(csv, options);
+    if (!loader.loadRows(ids)) {
+        return "failed";
+    }
+    return dumpRows(loader.getTable(), false);
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/rows.csv";
+    writeFile(csv, makeCSV(300));
+
+    CSVLoadOptions projected;
+    projected.columns = { "name", "score" };
+    std::vector<CSVLoadOptions> modes = { CSVLoadOptions(), projected };
+    std::vector<std::vector<uint64_t>> lookups = {
+        { 0 }, { 299 }, { 63, 64, 65 }, { 130, 2, 2, 11, 143 }, { 12, 13, 14, 26 },
+    };
+    std::vector<uint64_t> all(300);
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    lookups.push_back(all);
+    for (const auto& options : modes) {
+        CSVLoader full(csv, options);
+        CHECK(full.load());
+        for (const auto& ids : lookups) {
+            std::string expected = selectRows(full.getTable(), std::set<uint64_t>(ids.begin(), ids.end()));
+            // The first lookup builds the index, the second reads it back
+            CHECK_EQ(lookup(csv, ids, options), expected);
+            CHECK_EQ(lookup(csv, ids, options), expected);
+        }
+    }
+    struct stat st;
+    CHECK(stat((csv + ".rowidx").c_str(), &st) == 0);
+    CHECK_EQ(lookup(csv, { 300 }), std::string("failed"));
+
+    // A changed file makes the index stale
+    writeFile(csv, makeCSV(400));
+    CSVLoader full(csv);
+    CHECK(full.load());
+    CHECK_EQ(lookup(csv, { 5, 299, 300, 399 }), selectRows(full.getTable(), { 5, 299, 300, 399 }));
+    return testResult();
+}
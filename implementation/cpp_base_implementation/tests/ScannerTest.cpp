@@ -0,0 +1,118 @@
+// ScannerTest.cpp
+// Every scanner kernel splits CSV input exactly as a byte-at-a-time reading
+// of RFC 4180 does
+#include "TestSupport.h"
+#include "../CSVScanner.h"
+#include <random>
+
+using Records = std::vector<std::vector<std::string>>;
+
+// Raw cells of every record, one byte at a time: quotes toggle the quoted
+// state, and ',' and '\n' outside quotes end a cell and a record
+static Records referenceTokenize(const std::string& text, std::vector<size_t>& record_ends) {
+    Records records(1);
+    size_t cell = 0;
+    bool in_quotes = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '"') {
+            in_quotes = !in_quotes;
+        }
+        else if (!in_quotes && text[i] == ',') {
+            records.back().push_back(text.substr(cell, i - cell));
+            cell = i + 1;
+        }
+        else if (!in_quotes && text[i] == '\n') {
+            size_t end = i > cell && text[i - 1] == '\r' ? i - 1 : i;
+            records.back().push_back(text.substr(cell, end - cell));
+            records.emplace_back();
+            record_ends.push_back(i + 1);
+            cell = i + 1;
+        }
+    }
+    if (cell < text.size() || !records.back().empty()) {
+        records.back().push_back(text.substr(cell));
+    }
+    else {
+        records.pop_back();
+    }
+    return records;
+}
+
+static Records scannerTokenize(const CSVScanner& scanner, const std::string& text) {
+    Records records(1);
+    const char* begin = text.data();
+    scanner.tokenize(begin, begin + text.size(),
+        [&](const char* cell_begin, const char* cell_end) { records.back().emplace_back(cell_begin, cell_end); },
+        [&](const char* cell_begin, const char* cell_end) {
+            records.back().emplace_back(cell_begin, cell_end);
+            records.emplace_back();
+        });
+    records.pop_back();
+    return records;
+}
+
+// CSV text of random records: plain, quoted with commas, line breaks and
+// escaped quotes, empty cells, and LF or CRLF record ends
+static std::string randomCSV(std::mt19937& random, size_t records) {
+    static const char* cells[] = { "a", "12", "", "\"x,y\"", "\"line\nbreak\"", "\"say \"\"hi\"\"\"", "\"\"",
+                                   "long cell text that spans more bytes", "\"quoted\r\nCRLF\"" };
+    std::string text;
+    for (size_t r = 0; r < records; ++r) {
+        size_t fields = 1 + random() % 6;
+        for (size_t f = 0; f < fields; ++f) {
+            text += (f > 0 ? "," : "");
+            text += cells[random() % (sizeof(cells) / sizeof(cells[0]))];
+        }
+        text += random() % 3 == 0 ? "\r\n" : "\n";
+    }
+    return text;
+}
+
+int main() {
+    const ScannerKernel kernels[] = { ScannerKernel::SCALAR, ScannerKernel::SSE42, ScannerKernel::AVX2 };
+    CSVScanner scalar(ScannerKernel::SCALAR);
+    std::mt19937 random(2520);
+
+    for (ScannerKernel kernel : kernels) {
+        if (!CSVScanner::isSupported(kernel)) {
+            continue;
+        }
+        CSVScanner scanner(kernel);
+
+        // Raw masks of arbitrary bytes match the scalar kernel's
+        for (int trial = 0; trial < 200; ++trial) {
+            char block[CSVScanner::BLOCK_SIZE];
+            for (char& c : block) {
+                c = "ab,\n\"\r\x80\xff"[random() % 8];
+            }
+            StructuralMasks expected = scalar.scanBlock(block);
+            StructuralMasks masks = scanner.scanBlock(block);
+            CHECK(masks.field == expected.field && masks.record == expected.record && masks.quote == expected.quote);
+        }
+
+        for (size_t records : { 0, 1, 3, 40, 300 }) {
+            std::string text = randomCSV(random, records);
+            // With and without the final record delimiter
+            for (const std::string& input : { text, text.substr(0, text.empty() ? 0 : text.size() - 1) }) {
+                std::vector<size_t> record_ends;
+                Records expected = referenceTokenize(input, record_ends);
+                CHECK(scannerTokenize(scanner, input) == expected);
+
+                std::vector<size_t> ends;
+                scanner.forEachRecordEnd(input.data(), input.data() + input.size(),
+                                         [&](const char* pos) { ends.push_back(pos - input.data()); });
+                CHECK(ends == record_ends);
+                size_t last = record_ends.empty() ? 0 : record_ends.back();
+                CHECK_EQ(size_t(scanner.findLastRecordEnd(input.data(), input.data() + input.size()) - input.data()),
+                         last);
+                for (size_t count = 1; count <= record_ends.size(); count += 7) {
+                    size_t found = count;
+                    const char* end = scanner.findRecordEnd(input.data(), input.data() + input.size(), found);
+                    CHECK_EQ(found, count);
+                    CHECK_EQ(size_t(end - input.data()), record_ends[count - 1]);
+                }
+            }
+        }
+    }
+    return testResult();
+}
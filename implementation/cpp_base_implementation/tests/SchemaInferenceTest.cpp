@@ -0,0 +1,178 @@
+// SchemaInferenceTest.cpp
+// Column types inferred from dirty cells
+#include "TestSupport.h"
+#include "../SchemaInference.h"
+
+static const char* SAMPLE =
+    "id,name,age,salary\n"
+    "1,Alice,30,70000\n"
+    "2,Bob,25,50000\n"
+    "3,Charlie,35,80000\n"
+    "4,Diana,28,60000\n"
+    "5,Eve,41,65000.5\n"
+    "6,Frank,x,90000\n";
+
+static ColumnType typeOf(std::initializer_list<const char*> cells) {
+    CellCounts counts;
+    for (const char* cell : cells) {
+        counts.add(cell);
+    }
+    return counts.type();
+}
+
+// A file of about 3 MiB whose leading records sample as INT64, BOOL and
+// DOUBLE columns and whose later records widen, stray from or re-render them
+static std::string dirtyFile() {
+    std::string text = "id,count,flag,price\n";
+    for (int row = 0; row < 120000; ++row) {
+        text += std::to_string(row) + ",";
+        if (row == 90000) {
+            text += "2.5";
+        }
+        else if (row == 100000) {
+            text += "3000000000";
+        }
+        else if (row % 5000 == 4999) {
+            text += "n/a";
+        }
+        else {
+            text += std::to_string(row % 977);
+        }
+        text += row % 7 == 0 ? ",TRUE," : (row % 11 == 0 ? ",," : ",false,");
+        text += row % 3 == 0 ? "1.50" : (row % 13 == 0 ? "1e3" : std::to_string(row % 100) + ".25");
+        if (row % 17 != 0) {
+            text += row % 19 == 0 ? ",extra\n" : "\n";
+        }
+        else {
+            text += "\n";
+        }
+    }
+    return text;
+}
+
+static ElementSelect olderThan30(const std::string& table) {
+    std::vector<std::shared_ptr<Operand>> operands = {
+        std::make_shared<ColumnOperand>("name"),
+        std::make_shared<ColumnOperand>("age"),
+    };
+    ElementSelect select(operands, table);
+    select.addFilter(std::make_shared<WhereFilter>(std::make_shared<ColumnOperand>("age"), Comparator::GREATER,
+                                                   std::make_shared<IntegerOperand>(30)));
+    return select;
+}
+
+int main() {
+    CHECK(typeOf({"1", "2", ""}) == ColumnType::INT64);
+    CHECK(typeOf({"1", "2.5"}) == ColumnType::DOUBLE);
+    CHECK(typeOf({"true", "FALSE"}) == ColumnType::BOOL);
+    CHECK(typeOf({"1", "2", "n/a"}) == ColumnType::INT64);
+    CHECK(typeOf({"1", "n/a"}) == ColumnType::STRING);
+    CHECK(typeOf({"a", "b", "3"}) == ColumnType::STRING);
+    CHECK(typeOf({"", ""}) == ColumnType::STRING);
+
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/sample.csv";
+    writeFile(csv, SAMPLE);
+
+    CSVLoader loader(csv);
+    CHECK(loader.load());
+    const ColumnTable& table = loader.getTable();
+    // A stray cell keeps its text rather than making the column text
+    const Column& age = table.getColumn(table.findColumn("age"));
+    CHECK(age.getType() == ColumnType::INT64);
+    CHECK(age.isMissing(5));
+    CHECK_EQ(age.strayCount(), size_t(1));
+    CHECK_EQ(age.toString(5), std::string("x"));
+    CHECK_EQ(age.getInt(4), int64_t(41));
+    CHECK_EQ(loader.getData()[5].at("age"), std::string("x"));
+    // One non-integral number widens the column to DOUBLE
+    const Column& salary = table.getColumn(table.findColumn("salary"));
+    CHECK(salary.getType() == ColumnType::DOUBLE);
+    CHECK_EQ(salary.getDouble(4), 65000.5);
+    CHECK_EQ(salary.nullCount(), size_t(0));
+
+    // Numeric comparisons still work, and report the stray cell as a row map would
+    std::string expected = "name\tage\t\n----\t----\t\nCharlie\t35\t\nEve\t41\t\n--\n"
+                           "Error processing row 6: Type mismatch between operands in WhereFilter.\n";
+    CHECK_EQ(runQuery(csv, olderThan30), expected);
+    QueryRun pushed;
+    pushed.pushdown = true;
+    CHECK_EQ(runQuery(csv, olderThan30, pushed), expected);
+    QueryRun batched;
+    batched.batch_rows = 2;
+    CHECK_EQ(runQuery(csv, olderThan30, batched), expected);
+    // Arithmetic on the stray cell reports it too
+    QueryBuilder plus_one = selectWhere({ "name" }, { FilterBuilder([]() {
+        return std::make_shared<WhereFilter>(
+            std::make_shared<ExpressionOperand>(std::make_shared<ColumnOperand>("age"), OperatorType::ADD,
+                                                std::make_shared<IntegerOperand>(1)),
+            Comparator::GREATER, std::make_shared<IntegerOperand>(36));
+    }) });
+    CHECK_EQ(runQuery(csv, plus_one), std::string("name\t\n----\t\nEve\t\n--\n"
+                                                  "Error processing row 6: Operands must be numeric (int or double) "
+                                                  "for expressions.\n"));
+    // The same answer as evaluating every row map
+    ElementSelect select = olderThan30(csv);
+    select.bind(table);
+    const auto& rows = loader.getData();
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        bool map_pass = false, table_pass = false;
+        std::string map_error, table_error;
+        try {
+            map_pass = select.getFilter()->apply(rows[row]);
+        }
+        catch (const std::exception& e) {
+            map_error = e.what();
+        }
+        try {
+            table_pass = select.getFilter()->apply(table, row);
+        }
+        catch (const std::exception& e) {
+            table_error = e.what();
+        }
+        CHECK_EQ(map_pass, table_pass);
+        CHECK_EQ(map_error, table_error);
+    }
+
+    // Cells are parsed straight into their sampled types, and a later cell
+    // that does not fit widens the column or stays a stray. Whichever path
+    // parsed them, the table reads back as the text of the file.
+    std::string dirty = dir + "/dirty.csv";
+    writeFile(dirty, dirtyFile());
+    CSVLoadOptions text_options;
+    text_options.infer_schema = false;
+    CSVLoader text_loader(dirty, text_options);
+    CHECK(text_loader.load());
+    std::vector<CSVLoadOptions> modes(4);
+    modes[1].mode = LoadMode::MMAP;
+    modes[2].num_threads = 4;
+    modes[3].schema_sample_rows = 0;
+    std::string typed_rows;
+    for (size_t m = 0; m < modes.size(); ++m) {
+        CSVLoader typed_loader(dirty, modes[m]);
+        CHECK(typed_loader.load());
+        const ColumnTable& typed = typed_loader.getTable();
+        CHECK(typed.getColumn(typed.findColumn("count")).getType() == ColumnType::DOUBLE);
+        CHECK(typed.getColumn(typed.findColumn("flag")).getType() == ColumnType::BOOL);
+        CHECK(typed.getColumn(typed.findColumn("price")).getType() == ColumnType::DOUBLE);
+        CHECK_EQ(typed.getColumn(typed.findColumn("count")).strayCount(), size_t(24));
+        CHECK(typed_loader.getData() == text_loader.getData());
+        if (m == 0) {
+            typed_rows = dumpRows(typed);
+        }
+        CHECK_EQ(dumpRows(typed), typed_rows);
+    }
+    // Batches widen on their own, but read back alike
+    CSVLoader batch_loader(dirty);
+    CHECK(batch_loader.openBatches(7000));
+    size_t batch_first = 0;
+    while (batch_loader.nextBatch()) {
+        const auto& batch_rows = batch_loader.getData();
+        for (size_t row = 0; row < batch_rows.size(); ++row) {
+            CHECK(batch_rows[row] == text_loader.getData()[batch_first + row]);
+        }
+        batch_first += batch_rows.size();
+    }
+    CHECK_EQ(batch_first, size_t(120000));
+    return testResult();
+}
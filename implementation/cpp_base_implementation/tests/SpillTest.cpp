@@ -0,0 +1,110 @@
+// SpillTest.cpp
+// A load over its memory budget, with columns moved to the spill file,
+// holds and answers the same as an unlimited one
+#include "TestSupport.h"
+
+// Columns of every type, a dictionary-encoded one and a sparse one
+static std::string makeCSV(size_t first, size_t records) {
+    std::string text;
+    for (size_t r = first; r < first + records; ++r) {
+        std::string id = std::to_string(r);
+        text += id + ",name" + id + (r % 5 == 0 ? "x\"\"y" : "") + "," + std::to_string(r % 97) + "." +
+                std::to_string(r % 10) + "," + (r % 3 ? "true" : "false") + "," + (r % 2 ? "eu" : "us") + "," +
+                (r % 11 == 0 ? id : "") + "\n";
+    }
+    return text;
+}
+
+static const char* HEADER = "id,name,score,flag,region,sparse\n";
+
+static CSVLoadOptions budgeted(CSVLoadOptions options, const std::string& spill_directory) {
+    options.memory_budget = 64 * 1024;
+    options.spill_directory = spill_directory;
+    return options;
+}
+
+int main() {
+    std::string dir = makeTestDir();
+    std::string csv = dir + "/big.csv";
+    writeFile(csv, HEADER + makeCSV(0, 60000));
+    std::string spill = dir + "/spill";
+    mkdir(spill.c_str(), 0755);
+
+    std::vector<CSVLoadOptions> modes(5);
+    modes[1].mode = LoadMode::MMAP;
+    modes[2].num_threads = 4;
+    modes[3].infer_schema = false;
+    modes[4].dictionary_max_entries = 0;
+    for (const auto& mode : modes) {
+        CSVLoader unlimited(csv, mode);
+        CHECK(unlimited.load());
+        CSVLoader limited(csv, budgeted(mode, spill));
+        CHECK(limited.load());
+        CHECK(limited.getStats().columns_spilled > 0);
+        CHECK(limited.getStats().spilled_bytes > 0);
+        CHECK(limited.getStats().memory_bytes < unlimited.getStats().memory_bytes);
+        CHECK_EQ(dumpRows(limited.getTable()), dumpRows(unlimited.getTable()));
+    }
+
+    std::vector<QueryBuilder> queries = {
+        selectWhere({ "id", "name", "sparse" }, { where("score", Comparator::GREATER, 90.5) }),
+        selectWhere({ "name", "flag" }, { where("region", Comparator::EQUAL, std::string("eu")),
+                                          where("sparse", Comparator::LESS, 2000) }),
+        selectWhere({ "id" }, { where("name", Comparator::EQUAL, 3) }),
+    };
+    for (const auto& query : queries) {
+        QueryRun plain;
+        std::string expected = runQuery(csv, query, plain);
+        QueryRun limited = plain;
+        limited.options = budgeted(plain.options, spill);
+        CHECK_EQ(runQuery(csv, query, limited), expected);
+        limited.pushdown = true;
+        CHECK_EQ(runQuery(csv, query, limited), expected);
+        limited.batch_rows = 25000;
+        CHECK_EQ(runQuery(csv, query, limited), expected);
+    }
+
+    // Files loaded in parallel share the budget
+    std::string table = dir + "/parts";
+    mkdir(table.c_str(), 0755);
+    for (size_t part = 0; part < 4; ++part) {
+        writeFile(table + "/part-" + std::to_string(part) + ".csv", HEADER + makeCSV(part * 15000, 15000));
+    }
+    CSVLoader parts(table, budgeted(CSVLoadOptions(), spill));
+    CHECK(parts.load());
+    CHECK(parts.getStats().columns_spilled > 0);
+    CSVLoader whole(csv);
+    CHECK(whole.load());
+    CHECK_EQ(dumpRows(parts.getTable()), dumpRows(whole.getTable()));
+
+    // Rows appended to spilled columns
+    std::string grown = dir + "/grown.csv";
+    writeFile(grown, HEADER + makeCSV(0, 60000));
+    CSVLoader tail(grown, budgeted(CSVLoadOptions(), spill));
+    CHECK(tail.load());
+    std::ofstream(grown, std::ios::app) << makeCSV(60000, 500);
+    CHECK(tail.refresh());
+    CHECK(tail.getStats().appended);
+    CSVLoader reloaded(grown);
+    CHECK(reloaded.load());
+    CHECK_EQ(dumpRows(tail.getTable()), dumpRows(reloaded.getTable()));
+
+    // Row ids and dictionaries are counted with the cells: 2000 long distinct
+    // values repeated over 60000 rows are mostly dictionary bytes
+    std::string labels = dir + "/labels.csv";
+    std::string text = "id,label\n";
+    for (size_t r = 0; r < 60000; ++r) {
+        text += std::to_string(r) + ",label-" + std::string(100, 'a' + r % 2000 % 26) + std::to_string(r % 2000) + "\n";
+    }
+    writeFile(labels, text);
+    CSVLoader encoded(labels);
+    CHECK(encoded.load());
+    const ColumnTable& encoded_table = encoded.getTable();
+    CHECK(encoded_table.getColumn(1).isDictionaryEncoded());
+    size_t cells = encoded_table.getColumn(0).memoryUsage() + encoded_table.getColumn(1).memoryUsage();
+    CHECK(encoded.getStats().memory_bytes >= cells + 60000 * sizeof(uint64_t) + 2000 * 100);
+
+    // The spill file is unlinked once created
+    CHECK(rmdir(spill.c_str()) == 0);
+    return testResult();
+}
@@ -0,0 +1,192 @@
+// TestSupport.h
+#ifndef TESTSUPPORT_H
+#define TESTSUPPORT_H
+
+#include "../CSVLoader.h"
+#include "../ElementSelect.h"
+#include "../QueryExecutor.h"
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Each test is a program of its own: checks that fail are reported and
+// counted, and main returns testResult()
+
+inline int& failedChecks() {
+    static int failed = 0;
+    return failed;
+}
+
+inline void reportFailure(const char* file, int line, const std::string& message) {
+    std::cerr << file << ":" << line << ": " << message << std::endl;
+    failedChecks()++;
+}
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            reportFailure(__FILE__, __LINE__, "CHECK(" #condition ") failed");  \
+        }                                                                       \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                              \
+    do {                                                                        \
+        const auto& actual_value = (actual);                                    \
+        const auto& expected_value = (expected);                                \
+        if (!(actual_value == expected_value)) {                                \
+            std::ostringstream message;                                         \
+            message << "CHECK_EQ(" #actual ", " #expected ") failed\n"          \
+                    << "--- actual ---\n" << actual_value << "\n"              \
+                    << "--- expected ---\n" << expected_value;                  \
+            reportFailure(__FILE__, __LINE__, message.str());                   \
+        }                                                                       \
+    } while (0)
+
+inline int testResult() {
+    if (failedChecks() > 0) {
+        std::cerr << failedChecks() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// A fresh directory under $TMPDIR (or /tmp) for the files of one test
+inline std::string makeTestDir() {
+    const char* tmp = std::getenv("TMPDIR");
+    std::string pattern = std::string(tmp != nullptr && *tmp != '\0' ? tmp : "/tmp") + "/csvtest.XXXXXX";
+    if (mkdtemp(&pattern[0]) == nullptr) {
+        std::cerr << "Failed to create a test directory" << std::endl;
+        std::exit(1);
+    }
+    return pattern;
+}
+
+inline void writeFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << contents;
+}
+
+// The row id and cells of one row on a line
+inline std::string dumpRow(const ColumnTable& table, size_t row) {
+    std::ostringstream out;
+    out << table.getRowId(row);
+    for (size_t idx = 0; idx < table.numColumns(); ++idx) {
+        const Column& column = table.getColumn(idx);
+        std::string_view text;
+        out << "|" << (column.isMissing(row) && !column.strayText(row, text) ? "NULL" : column.toString(row));
+    }
+    out << "\n";
+    return out.str();
+}
+
+// Column names and types, then every row as dumpRow prints it
+inline std::string dumpRows(const ColumnTable& table, bool with_header = true) {
+    std::ostringstream out;
+    for (size_t idx = 0; with_header && idx < table.numColumns(); ++idx) {
+        const Column& column = table.getColumn(idx);
+        out << column.getName() << ":" << static_cast<int>(column.getType()) << (idx + 1 < table.numColumns() ? "," : "\n");
+    }
+    for (size_t row = 0; row < table.numRows(); ++row) {
+        out << dumpRow(table, row);
+    }
+    return out.str();
+}
+
+// A query built from scratch for each run, since filters such as DISTINCT
+// and LIMIT keep state
+using QueryBuilder = std::function<ElementSelect(const std::string& table)>;
+
+// A filter built afresh for each run
+using FilterBuilder = std::function<std::shared_ptr<ElementFilter>()>;
+
+inline std::shared_ptr<Operand> constantOperand(const OperandValue& value) {
+    if (std::holds_alternative<int>(value)) {
+        return std::make_shared<IntegerOperand>(std::get<int>(value));
+    }
+    if (std::holds_alternative<double>(value)) {
+        return std::make_shared<DoubleOperand>(std::get<double>(value));
+    }
+    if (std::holds_alternative<bool>(value)) {
+        return std::make_shared<BooleanOperand>(std::get<bool>(value));
+    }
+    return std::make_shared<StringOperand>(std::get<std::string>(value));
+}
+
+// column <comparator> constant
+inline FilterBuilder where(const std::string& column, Comparator comparator, const OperandValue& constant) {
+    return [=] {
+        return std::make_shared<WhereFilter>(std::make_shared<ColumnOperand>(column), comparator,
+                                             constantOperand(constant));
+    };
+}
+
+// SELECT columns FROM table WHERE every filter
+inline QueryBuilder selectWhere(const std::vector<std::string>& columns, const std::vector<FilterBuilder>& filters) {
+    return [=](const std::string& table) {
+        std::vector<std::shared_ptr<Operand>> operands;
+        for (const auto& column : columns) {
+            operands.push_back(std::make_shared<ColumnOperand>(column));
+        }
+        ElementSelect select(operands, table);
+        for (const auto& filter : filters) {
+            select.addFilter(filter());
+        }
+        return select;
+    };
+}
+
+// How a query is run
+struct QueryRun {
+    CSVLoadOptions options;
+    bool pushdown = false;          // Pass the query's columns and scan predicates to the loader
+    bool optimize = false;          // Call ElementSelect::optimize first
+    size_t batch_rows = 0;          // Stream batches of this many rows instead of loading the table
+};
+
+// The rows a query prints followed by the row errors it reports, as the
+// command-line tool would show them
+inline std::string runQuery(const std::string& table, const QueryBuilder& build, const QueryRun& run = QueryRun()) {
+    ElementSelect select = build(table);
+    if (run.optimize) {
+        select.optimize();
+    }
+    CSVLoadOptions options = run.options;
+    if (run.pushdown) {
+        options.columns = select.getRequiredColumns();
+        options.predicates = select.getScanPredicates();
+    }
+    CSVLoader loader(table, options);
+    QueryExecutor executor(loader);
+
+    std::ostringstream out, err;
+    std::streambuf* cout_buf = std::cout.rdbuf(out.rdbuf());
+    std::streambuf* cerr_buf = std::cerr.rdbuf(err.rdbuf());
+    if (run.batch_rows > 0) {
+        executor.executeBatches(select, run.batch_rows);
+    }
+    else if (loader.load()) {
+        executor.execute(select);
+    }
+    else {
+        err << "Error: Failed to load the CSV file." << std::endl;
+    }
+    std::cout.rdbuf(cout_buf);
+    std::cerr.rdbuf(cerr_buf);
+
+    // Loader notes and statistics messages differ between runs; errors do not
+    std::istringstream lines(err.str());
+    std::string line, errors;
+    while (std::getline(lines, line)) {
+        if (line.compare(0, 6, "Error ") == 0 || line.compare(0, 6, "Error:") == 0) {
+            errors += line + "\n";
+        }
+    }
+    return out.str() + "--\n" + errors;
+}
+
+#endif // TESTSUPPORT_H